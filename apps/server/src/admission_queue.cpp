@@ -0,0 +1,168 @@
+#include "admission_queue.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+namespace {
+
+constexpr double kEwmaWeight = 0.2;
+// Used until the first completion has been observed.
+constexpr double kDefaultRequestSeconds = 30.0;
+constexpr int kMaxRetryAfterSeconds = 3600;
+
+void run_all(std::vector<std::function<void()>> &actions) {
+  for (auto &action : actions) {
+    action();
+  }
+}
+
+}  // namespace
+
+AdmissionTicket::~AdmissionTicket() { queue_.release(id_); }
+
+AdmissionQueue::AdmissionQueue(std::size_t max_queued, std::size_t max_running)
+    : max_queued_(max_queued), max_running_(std::max<std::size_t>(max_running, 1)) {}
+
+std::shared_ptr<AdmissionTicket> AdmissionQueue::try_admit() {
+  std::lock_guard<std::mutex> lock(mu_);
+  // Free slots cover the requests about to run, so max_queued == 0 still
+  // admits requests while a slot is idle.
+  const auto capacity = max_queued_ + (max_running_ - running_ids_.size());
+  if (waiting_.size() >= capacity) {
+    return nullptr;
+  }
+  Waiter waiter;
+  waiter.id = next_id_++;
+  waiting_.push_back(std::move(waiter));
+  return std::shared_ptr<AdmissionTicket>(new AdmissionTicket(*this, waiting_.back().id));
+}
+
+void AdmissionQueue::dispatch(const AdmissionTicket &ticket, PositionCallback on_position,
+                              StartCallback start, RejectCallback reject) {
+  std::vector<std::function<void()>> actions;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    const auto it = std::find_if(waiting_.begin(), waiting_.end(),
+                                 [&](const Waiter &w) { return w.id == ticket.id(); });
+    if (!closed_ && it != waiting_.end()) {
+      it->on_position = std::move(on_position);
+      it->start = std::move(start);
+      it->reject = std::move(reject);
+      actions = advance_locked();
+      reject = nullptr;
+    }
+  }
+  run_all(actions);
+  // Refused callbacks are parameters, so they die after the lock is gone.
+  if (reject) {
+    reject();
+  }
+}
+
+void AdmissionQueue::withdraw(std::uint64_t ticket_id) {
+  std::vector<std::function<void()>> actions;
+  std::optional<Waiter> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    const auto it = std::find_if(waiting_.begin(), waiting_.end(),
+                                 [&](const Waiter &w) { return w.id == ticket_id; });
+    if (it == waiting_.end()) {
+      return;
+    }
+    dropped = std::move(*it);
+    waiting_.erase(it);
+    actions = advance_locked();
+  }
+  run_all(actions);
+  // Destroying the work may release the ticket, which re-enters release().
+  dropped.reset();
+}
+
+void AdmissionQueue::shutdown() {
+  std::deque<Waiter> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    closed_ = true;
+    dropped.swap(waiting_);
+  }
+  for (auto &waiter : dropped) {
+    if (waiter.reject) {
+      waiter.reject();
+    }
+  }
+  // Destroying the callbacks may release tickets, which re-enters release().
+  dropped.clear();
+}
+
+void AdmissionQueue::release(std::uint64_t id) {
+  std::vector<std::function<void()>> actions;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (running_ids_.erase(id) == 0) {
+      const auto it = std::find_if(waiting_.begin(), waiting_.end(),
+                                   [&](const Waiter &w) { return w.id == id; });
+      if (it != waiting_.end()) {
+        waiting_.erase(it);
+      }
+    }
+    actions = advance_locked();
+  }
+  run_all(actions);
+}
+
+std::vector<std::function<void()>> AdmissionQueue::advance_locked() {
+  std::vector<std::function<void()>> actions;
+  // The head can only start once its work has been attached by dispatch().
+  while (running_ids_.size() < max_running_ && !waiting_.empty() && waiting_.front().start) {
+    running_ids_.insert(waiting_.front().id);
+    actions.push_back(std::move(waiting_.front().start));
+    waiting_.pop_front();
+  }
+
+  std::size_t position = 1;
+  for (auto &waiter : waiting_) {
+    if (waiter.on_position && waiter.reported_position != position) {
+      waiter.reported_position = position;
+      actions.push_back([cb = waiter.on_position, position]() { cb(position); });
+    }
+    ++position;
+  }
+  return actions;
+}
+
+void AdmissionQueue::record_completion(int completion_tokens, double tokens_per_second) {
+  if (completion_tokens <= 0 || tokens_per_second <= 0.0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  if (avg_tokens_per_second_ <= 0.0) {
+    avg_completion_tokens_ = completion_tokens;
+    avg_tokens_per_second_ = tokens_per_second;
+    return;
+  }
+  avg_completion_tokens_ += kEwmaWeight * (completion_tokens - avg_completion_tokens_);
+  avg_tokens_per_second_ += kEwmaWeight * (tokens_per_second - avg_tokens_per_second_);
+}
+
+int AdmissionQueue::estimate_wait_seconds() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  const double per_request = avg_tokens_per_second_ > 0.0
+                                 ? avg_completion_tokens_ / avg_tokens_per_second_
+                                 : kDefaultRequestSeconds;
+  // Requests ahead drain max_running_ at a time.
+  const auto ahead = waiting_.size() + running_ids_.size();
+  const auto seconds = std::ceil(per_request * static_cast<double>(ahead) /
+                                 static_cast<double>(max_running_));
+  return static_cast<int>(std::clamp(seconds, 1.0, static_cast<double>(kMaxRetryAfterSeconds)));
+}
+
+std::size_t AdmissionQueue::running() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return running_ids_.size();
+}
+
+std::size_t AdmissionQueue::queued() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return waiting_.size();
+}
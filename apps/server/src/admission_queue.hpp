@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+class AdmissionQueue;
+
+// A reserved place in an AdmissionQueue. Releasing the last reference leaves
+// the queue (if still waiting) or frees the agent for the next ticket (if
+// running).
+class AdmissionTicket {
+ public:
+  ~AdmissionTicket();
+
+  AdmissionTicket(const AdmissionTicket &) = delete;
+  AdmissionTicket &operator=(const AdmissionTicket &) = delete;
+
+  std::uint64_t id() const { return id_; }
+
+ private:
+  friend class AdmissionQueue;
+  AdmissionTicket(AdmissionQueue &queue, std::uint64_t id) : queue_(queue), id_(id) {}
+
+  AdmissionQueue &queue_;
+  std::uint64_t id_;
+};
+
+// FIFO admission control in front of the agent. At most `max_running` tickets
+// run at a time (one per agent slot) and at most `max_queued` tickets may wait
+// behind them; further requests are rejected so callers can answer 429
+// instead of piling up threads.
+//
+// Admission is two-phase: try_admit() reserves a place (so the HTTP handler
+// can reject before committing to a response) and dispatch() attaches the
+// work. Nothing blocks while waiting; `start` is invoked on whichever thread
+// frees the agent, so it should only hand the work to an executor. Work that
+// will never start because the queue shut down has its `reject` invoked
+// instead, so the client is still answered.
+class AdmissionQueue {
+ public:
+  // Called with the 1-based position among waiting requests whenever it changes.
+  using PositionCallback = std::function<void(std::size_t position)>;
+  using StartCallback = std::function<void()>;
+  using RejectCallback = std::function<void()>;
+
+  explicit AdmissionQueue(std::size_t max_queued, std::size_t max_running = 1);
+
+  // Reserves a place at the back of the queue, or returns nullptr when full.
+  std::shared_ptr<AdmissionTicket> try_admit();
+
+  // Attaches work to a reserved ticket. `start` runs once the ticket reaches
+  // the head of the queue and a slot is free (possibly immediately, on the
+  // calling thread). The ticket counts as running until it is released.
+  // After shutdown(), `reject` runs on the calling thread instead.
+  void dispatch(const AdmissionTicket &ticket, PositionCallback on_position, StartCallback start,
+                RejectCallback reject = {});
+
+  // Removes a waiting ticket whose client has gone away, dropping its attached
+  // work so the requests behind it move up immediately. No-op once running.
+  void withdraw(std::uint64_t ticket_id);
+
+  // Rejects the work attached to every waiting ticket, outside the lock.
+  // Later dispatches are rejected the same way.
+  void shutdown();
+
+  // Feeds the throughput estimate used for Retry-After hints.
+  void record_completion(int completion_tokens, double tokens_per_second);
+
+  // Estimated seconds until a newly admitted request would start running.
+  int estimate_wait_seconds() const;
+
+  std::size_t queued() const;
+  std::size_t running() const;
+  std::size_t max_queued() const { return max_queued_; }
+  std::size_t max_running() const { return max_running_; }
+
+ private:
+  friend class AdmissionTicket;
+
+  struct Waiter {
+    std::uint64_t id = 0;
+    PositionCallback on_position;
+    StartCallback start;
+    RejectCallback reject;
+    std::size_t reported_position = 0;
+  };
+
+  void release(std::uint64_t id);
+  // Promotes head waiters into free slots and collects position
+  // updates; the returned actions must be run without holding mu_.
+  std::vector<std::function<void()>> advance_locked();
+
+  mutable std::mutex mu_;
+  std::deque<Waiter> waiting_;
+  std::uint64_t next_id_ = 1;
+  std::unordered_set<std::uint64_t> running_ids_;
+  bool closed_ = false;
+  const std::size_t max_queued_;
+  const std::size_t max_running_;
+
+  // Exponentially weighted moving averages of recent completions.
+  double avg_completion_tokens_ = 0.0;
+  double avg_tokens_per_second_ = 0.0;
+};
@@ -0,0 +1,188 @@
+#include "agent_cache.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::uintmax_t kWeightBytesPerKvTokenByte = 8192;
+
+}  // namespace
+
+std::uintmax_t estimate_resident_bytes(std::uintmax_t file_size_bytes, int context_size,
+                                       std::optional<std::uint64_t> kv_bytes_per_token,
+                                       int sequences) {
+  const auto tokens = static_cast<std::uintmax_t>(context_size > 0 ? context_size : 0);
+  const auto per_token =
+      kv_bytes_per_token.value_or(file_size_bytes / kWeightBytesPerKvTokenByte);
+  return (file_size_bytes + tokens * per_token) *
+         static_cast<std::uintmax_t>(std::max(sequences, 1));
+}
+
+namespace {
+
+std::vector<std::unique_ptr<AgentSlot>> make_slots(
+    std::vector<std::shared_ptr<zoo::Agent>> loaded, int ctx_size) {
+  std::vector<std::unique_ptr<AgentSlot>> slots;
+  slots.reserve(loaded.size());
+  for (auto &agent : loaded) {
+    slots.push_back(std::make_unique<AgentSlot>(std::move(agent), ctx_size));
+  }
+  return slots;
+}
+
+}  // namespace
+
+SlotLease::~SlotLease() {
+  if (resident_ != nullptr) {
+    resident_->release_slot(index_);
+  }
+}
+
+AgentSlot &SlotLease::slot() const { return *resident_->slots[index_]; }
+
+ResidentAgent::ResidentAgent(std::string id, std::vector<std::shared_ptr<zoo::Agent>> loaded,
+                             int ctx_size, std::uintmax_t bytes, std::size_t max_queued)
+    : model_id(std::move(id)),
+      slots(make_slots(std::move(loaded), ctx_size)),
+      context_size(ctx_size),
+      estimated_bytes(bytes),
+      admission(max_queued, std::max<std::size_t>(slots.size(), 1)),
+      slot_use_(slots.size()) {}
+
+SlotLease ResidentAgent::acquire_slot(std::uint64_t key, bool pinned,
+                                      std::optional<std::uint64_t> avoid) {
+  std::lock_guard<std::mutex> lock(slots_mu_);
+  const auto index = choose_slot_locked(key, pinned, avoid);
+  auto &use = slot_use_[index];
+  ++use.leases;
+  use.conversation = key;
+  use.last_used = ++use_clock_;
+  return SlotLease(*this, index);
+}
+
+void ResidentAgent::record_stateless_turn(const std::string &message, const std::string &reply,
+                                          std::size_t keep_chars) {
+  std::lock_guard<std::mutex> lock(stateless_mu_);
+  stateless_turns_.push_back({"user", message});
+  stateless_turns_.push_back({"assistant", reply});
+  stateless_chars_ += message.size() + reply.size();
+  // Whole turns go, oldest first; the newest always stays.
+  std::size_t drop = 0;
+  while (stateless_chars_ > keep_chars && stateless_turns_.size() - drop > 2) {
+    stateless_chars_ -= stateless_turns_[drop].content.size() +
+                        stateless_turns_[drop + 1].content.size();
+    drop += 2;
+  }
+  stateless_turns_.erase(stateless_turns_.begin(),
+                         stateless_turns_.begin() + static_cast<std::ptrdiff_t>(drop));
+}
+
+std::vector<SessionMessage> ResidentAgent::stateless_transcript() const {
+  std::lock_guard<std::mutex> lock(stateless_mu_);
+  return stateless_turns_;
+}
+
+void ResidentAgent::clear_stateless_transcript() {
+  std::lock_guard<std::mutex> lock(stateless_mu_);
+  stateless_turns_.clear();
+  stateless_chars_ = 0;
+}
+
+std::size_t ResidentAgent::choose_slot_locked(std::uint64_t key, bool pinned,
+                                              std::optional<std::uint64_t> avoid) const {
+  if (pinned) {
+    for (std::size_t i = 0; i < slot_use_.size(); ++i) {
+      if (slot_use_[i].conversation == key) {
+        return i;
+      }
+    }
+  }
+  std::optional<std::size_t> chosen;
+  std::optional<std::size_t> busy;  // Least recently used of the busy slots
+  for (std::size_t i = 0; i < slot_use_.size(); ++i) {
+    const auto &use = slot_use_[i];
+    if (avoid.has_value() && use.conversation == avoid) {
+      continue;
+    }
+    if (use.leases > 0) {
+      if (!busy || use.last_used < slot_use_[*busy].last_used) {
+        busy = i;
+      }
+      continue;
+    }
+    if (use.conversation == key) {
+      chosen = i;
+      break;
+    }
+    if (!chosen || use.last_used < slot_use_[*chosen].last_used) {
+      chosen = i;
+    }
+  }
+  // Only reachable if more chats run than admission allows, or every other
+  // slot is avoided; share the least recently used slot, whose mutex then
+  // serializes them.
+  return chosen.value_or(busy.value_or(0));
+}
+
+void ResidentAgent::release_slot(std::size_t index) {
+  std::lock_guard<std::mutex> lock(slots_mu_);
+  --slot_use_[index].leases;
+}
+
+AgentCache::AgentCache(std::uintmax_t budget_bytes) : budget_bytes_(budget_bytes) {}
+
+std::shared_ptr<ResidentAgent> AgentCache::get(const std::string &model_id) {
+  const auto it = index_.find(model_id);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return *it->second;
+}
+
+std::shared_ptr<ResidentAgent> AgentCache::peek(const std::string &model_id) const {
+  const auto it = index_.find(model_id);
+  return it == index_.end() ? nullptr : *it->second;
+}
+
+std::vector<std::shared_ptr<ResidentAgent>> AgentCache::make_room(
+    std::uintmax_t bytes, const std::vector<std::string> &pinned) {
+  std::vector<std::shared_ptr<ResidentAgent>> evicted;
+  auto it = lru_.end();
+  while (it != lru_.begin() && used_bytes_ + bytes > budget_bytes_) {
+    --it;
+    if (std::find(pinned.begin(), pinned.end(), (*it)->model_id) != pinned.end()) {
+      continue;
+    }
+    auto victim = std::move(*it);
+    it = lru_.erase(it);
+    index_.erase(victim->model_id);
+    used_bytes_ -= victim->estimated_bytes;
+    evicted.push_back(std::move(victim));
+  }
+  return evicted;
+}
+
+std::shared_ptr<ResidentAgent> AgentCache::insert(std::shared_ptr<ResidentAgent> resident) {
+  auto replaced = erase(resident->model_id);
+  used_bytes_ += resident->estimated_bytes;
+  lru_.push_front(std::move(resident));
+  index_[lru_.front()->model_id] = lru_.begin();
+  return replaced;
+}
+
+std::shared_ptr<ResidentAgent> AgentCache::erase(const std::string &model_id) {
+  const auto it = index_.find(model_id);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  auto resident = *it->second;
+  lru_.erase(it->second);
+  index_.erase(it);
+  used_bytes_ -= resident->estimated_bytes;
+  return resident;
+}
+
+std::vector<std::shared_ptr<ResidentAgent>> AgentCache::entries() const {
+  return {lru_.begin(), lru_.end()};
+}
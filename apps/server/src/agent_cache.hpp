@@ -0,0 +1,171 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "admission_queue.hpp"
+#include "model_memory.hpp"
+#include "prefix_cache.hpp"
+#include "session_store.hpp"
+
+namespace zoo {
+class Agent;
+}
+
+// Estimated resident size of a model loaded with `context_size` tokens per
+// sequence. Every sequence is its own agent, so each is counted with the
+// weights and an fp16 KV cache: the engine may share mapped weights between
+// them, but not once layers are offloaded or repacked, and the budget must
+// hold either way. Without GGUF shape metadata the KV cost per token is
+// approximated as file_size / 8192, which lands close to the real figure for
+// common 7B-13B quantizations.
+std::uintmax_t estimate_resident_bytes(std::uintmax_t file_size_bytes, int context_size,
+                                       std::optional<std::uint64_t> kv_bytes_per_token = {},
+                                       int sequences = 1);
+
+// One independent context (sequence) of a resident model.
+struct AgentSlot {
+  AgentSlot(std::shared_ptr<zoo::Agent> loaded, int ctx_size)
+      : agent(std::move(loaded)), prefix_cache(static_cast<std::uint64_t>(ctx_size)) {}
+
+  const std::shared_ptr<zoo::Agent> agent;
+  std::mutex mu;  // Serializes operations on this agent (chat, reset, MCP)
+  // Which conversation the agent's history (and KV cache) holds. Guarded by mu.
+  PrefixCache prefix_cache;
+};
+
+struct ResidentAgent;
+
+// Exclusive use of one slot for a chat turn; frees it on destruction.
+class SlotLease {
+ public:
+  SlotLease(ResidentAgent &resident, std::size_t index) : resident_(&resident), index_(index) {}
+  ~SlotLease();
+  SlotLease(SlotLease &&other) noexcept
+      : resident_(std::exchange(other.resident_, nullptr)), index_(other.index_) {}
+  SlotLease(const SlotLease &) = delete;
+  SlotLease &operator=(const SlotLease &) = delete;
+  SlotLease &operator=(SlotLease &&) = delete;
+
+  AgentSlot &slot() const;
+  std::size_t index() const { return index_; }
+
+ private:
+  ResidentAgent *resident_;
+  std::size_t index_;
+};
+
+// A loaded model kept resident in memory, plus the state that serializes
+// access to it. Requests hold a shared_ptr for their whole lifetime, so an
+// evicted agent is only destroyed once its in-flight work has drained.
+//
+// The model may run several independent sequences, each in its own agent
+// context: up to that many admitted chats run in parallel, one per slot.
+struct ResidentAgent {
+  ResidentAgent(std::string id, std::vector<std::shared_ptr<zoo::Agent>> loaded, int ctx_size,
+                std::uintmax_t bytes, std::size_t max_queued);
+  ~ResidentAgent() {
+    if (on_released) {
+      on_released();
+    }
+  }
+
+  // Claims a free slot for a turn of conversation `key`: the slot that last
+  // ran that conversation if it is free, otherwise the least recently used.
+  // Admission runs at most one chat per slot, so a slot is always free for an
+  // admitted chat. A `pinned` conversation has one history shared by every
+  // caller, so it never forks onto a second slot: while the slot holding it is
+  // busy, the lease shares that slot and its mutex serializes the turns. A
+  // slot holding conversation `avoid` is never chosen while another exists.
+  SlotLease acquire_slot(std::uint64_t key, bool pinned = false,
+                         std::optional<std::uint64_t> avoid = std::nullopt);
+
+  // The stateless conversation has no session to rebuild it from, so the
+  // model keeps its finished turns: a slot that lost the conversation (to a
+  // session, or a cut-short turn) replays them. Only the newest `keep_chars`
+  // of transcript are kept, about what a replay can fit in the context.
+  void record_stateless_turn(const std::string &message, const std::string &reply,
+                             std::size_t keep_chars);
+  std::vector<SessionMessage> stateless_transcript() const;
+  void clear_stateless_transcript();
+
+  const std::string model_id;
+  // Fixed at construction; never empty for a loaded model.
+  const std::vector<std::unique_ptr<AgentSlot>> slots;
+  const int context_size;
+  const std::uintmax_t estimated_bytes;
+
+  // One per model file; set before publishing when mlock is on.
+  std::vector<std::unique_ptr<PinnedMapping>> pinned_weights;
+  // Runs when the last request holding this agent lets go (ends a drain).
+  std::function<void()> on_released;
+
+  AdmissionQueue admission;     // FIFO of chat requests routed to this agent
+
+ private:
+  friend class SlotLease;
+  void release_slot(std::size_t index);
+  std::size_t choose_slot_locked(std::uint64_t key, bool pinned,
+                                 std::optional<std::uint64_t> avoid) const;
+
+  struct SlotUse {
+    std::size_t leases = 0;
+    std::optional<std::uint64_t> conversation;  // Last conversation run in the slot
+    std::uint64_t last_used = 0;
+  };
+  std::mutex slots_mu_;
+  std::vector<SlotUse> slot_use_;  // Guarded by slots_mu_
+  std::uint64_t use_clock_ = 0;    // Guarded by slots_mu_
+
+  mutable std::mutex stateless_mu_;
+  std::vector<SessionMessage> stateless_turns_;  // Guarded by stateless_mu_
+  std::size_t stateless_chars_ = 0;              // Guarded by stateless_mu_
+};
+
+// LRU set of resident agents bounded by an estimated memory budget. Not
+// internally synchronized; RuntimeState guards it with its registry mutex.
+class AgentCache {
+ public:
+  explicit AgentCache(std::uintmax_t budget_bytes);
+
+  // Returns the agent for `model_id` and marks it most recently used.
+  std::shared_ptr<ResidentAgent> get(const std::string &model_id);
+  // Same lookup without touching the LRU order.
+  std::shared_ptr<ResidentAgent> peek(const std::string &model_id) const;
+
+  // Evicts least recently used agents until `bytes` more fit in the budget,
+  // never touching the `pinned` ids. A model larger than the whole budget
+  // evicts everything unpinned and is still admitted. Evicted agents are
+  // returned so the caller can drop them outside its locks.
+  std::vector<std::shared_ptr<ResidentAgent>> make_room(
+      std::uintmax_t bytes, const std::vector<std::string> &pinned = {});
+
+  // Inserts (or replaces) an agent as most recently used. Returns the entry
+  // it replaced, if any.
+  std::shared_ptr<ResidentAgent> insert(std::shared_ptr<ResidentAgent> resident);
+
+  std::shared_ptr<ResidentAgent> erase(const std::string &model_id);
+
+  // Most recently used first.
+  std::vector<std::shared_ptr<ResidentAgent>> entries() const;
+
+  std::uintmax_t used_bytes() const { return used_bytes_; }
+  std::uintmax_t budget_bytes() const { return budget_bytes_; }
+
+ private:
+  using Lru = std::list<std::shared_ptr<ResidentAgent>>;
+
+  Lru lru_;
+  std::unordered_map<std::string, Lru::iterator> index_;
+  std::uintmax_t used_bytes_ = 0;
+  const std::uintmax_t budget_bytes_;
+};
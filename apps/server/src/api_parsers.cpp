@@ -1,5 +1,33 @@
 #include "api_parsers.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace {
+
+std::optional<std::uint64_t> parse_sequence(const std::string &text) {
+  std::uint64_t value = 0;
+  const auto *end = text.data() + text.size();
+  const auto [ptr, ec] = std::from_chars(text.data(), end, value);
+  if (text.empty() || ec != std::errc() || ptr != end) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+constexpr const char *kInvalidRequestId =
+    "Field 'request_id' must be 1-64 letters, digits, '-', '_' or '.'";
+
+bool is_valid_request_id(const std::string &id) {
+  const auto valid_char = [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == '.';
+  };
+  return !id.empty() && id.size() <= 64 && std::all_of(id.begin(), id.end(), valid_char);
+}
+
+}  // namespace
+
 std::optional<std::string> parse_model_register_request(const JsonPtr &json,
                                                         ParsedModelRegisterRequest &out,
                                                         Json::Value &details) {
@@ -29,6 +57,33 @@ std::optional<std::string> parse_model_register_request(const JsonPtr &json,
     }
   }
 
+  if (obj.isMember("load_options")) {
+    const auto &options = obj["load_options"];
+    if (!options.isObject()) {
+      details["field"] = "load_options";
+      return "Field 'load_options' must be an object";
+    }
+    ModelLoadOptions parsed;
+    if (options.isMember("prefetch")) {
+      const auto mode = options["prefetch"].isString()
+                            ? parse_prefetch_mode(options["prefetch"].asString())
+                            : std::nullopt;
+      if (!mode.has_value()) {
+        details["field"] = "load_options.prefetch";
+        return "Field 'load_options.prefetch' must be one of: none, read, madvise";
+      }
+      parsed.prefetch = *mode;
+    }
+    if (options.isMember("mlock")) {
+      if (!options["mlock"].isBool()) {
+        details["field"] = "load_options.mlock";
+        return "Field 'load_options.mlock' must be a boolean";
+      }
+      parsed.mlock = options["mlock"].asBool();
+    }
+    out.load_options = parsed;
+  }
+
   return std::nullopt;
 }
 
@@ -69,7 +124,7 @@ std::optional<std::string> parse_model_select_request(const JsonPtr &json,
 }
 
 std::optional<std::string> parse_chat_complete_request(const JsonPtr &json,
-                                                       std::string &message,
+                                                       ParsedChatRequest &out,
                                                        Json::Value &details) {
   if (!json || !json->isObject()) {
     return "Body must be a JSON object";
@@ -81,11 +136,205 @@ std::optional<std::string> parse_chat_complete_request(const JsonPtr &json,
     return "Field 'message' is required and must be a string";
   }
 
-  message = obj["message"].asString();
-  if (message.empty()) {
+  out.message = obj["message"].asString();
+  if (out.message.empty()) {
+    details["field"] = "message";
+    return "Field 'message' cannot be empty";
+  }
+
+  if (obj.isMember("model_id")) {
+    if (!obj["model_id"].isString() || obj["model_id"].asString().empty()) {
+      details["field"] = "model_id";
+      return "Field 'model_id' must be a non-empty string";
+    }
+    out.model_id = obj["model_id"].asString();
+  }
+
+  if (obj.isMember("isolated")) {
+    if (!obj["isolated"].isBool()) {
+      details["field"] = "isolated";
+      return "Field 'isolated' must be a boolean";
+    }
+    out.isolated = obj["isolated"].asBool();
+  }
+
+  if (obj.isMember("stream_options")) {
+    const auto &options = obj["stream_options"];
+    if (!options.isObject()) {
+      details["field"] = "stream_options";
+      return "Field 'stream_options' must be an object";
+    }
+    if (options.isMember("flush_interval_ms")) {
+      const auto &value = options["flush_interval_ms"];
+      if (!value.isInt() || value.asInt() < 0 || value.asInt() > 1000) {
+        details["field"] = "stream_options.flush_interval_ms";
+        return "Field 'stream_options.flush_interval_ms' must be an integer between 0 and 1000";
+      }
+      out.flush_interval_ms = value.asInt();
+    }
+    if (options.isMember("flush_bytes")) {
+      const auto &value = options["flush_bytes"];
+      if (!value.isInt() || value.asInt() < 1 || value.asInt() > 65536) {
+        details["field"] = "stream_options.flush_bytes";
+        return "Field 'stream_options.flush_bytes' must be an integer between 1 and 65536";
+      }
+      out.flush_bytes = value.asInt();
+    }
+    if (options.isMember("resumable")) {
+      if (!options["resumable"].isBool()) {
+        details["field"] = "stream_options.resumable";
+        return "Field 'stream_options.resumable' must be a boolean";
+      }
+      out.resumable = options["resumable"].asBool();
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<std::string> parse_session_create_request(const JsonPtr &json,
+                                                        ParsedSessionCreateRequest &out,
+                                                        Json::Value &details) {
+  if (!json || json->isNull()) {
+    return std::nullopt;
+  }
+  if (!json->isObject()) {
+    return "Body must be a JSON object";
+  }
+
+  const auto &obj = *json;
+  if (obj.isMember("title")) {
+    if (!obj["title"].isString() || obj["title"].asString().size() > 160) {
+      details["field"] = "title";
+      return "Field 'title' must be a string of at most 160 characters";
+    }
+    out.title = obj["title"].asString();
+  }
+  if (obj.isMember("model_id")) {
+    if (!obj["model_id"].isString() || obj["model_id"].asString().empty()) {
+      details["field"] = "model_id";
+      return "Field 'model_id' must be a non-empty string";
+    }
+    out.model_id = obj["model_id"].asString();
+  }
+  if (obj.isMember("system_prompt")) {
+    if (!obj["system_prompt"].isString()) {
+      details["field"] = "system_prompt";
+      return "Field 'system_prompt' must be a string";
+    }
+    out.system_prompt = obj["system_prompt"].asString();
+  }
+
+  return std::nullopt;
+}
+
+std::optional<std::string> parse_chat_send_request(const JsonPtr &json,
+                                                   ParsedChatSendRequest &out,
+                                                   Json::Value &details) {
+  if (!json || !json->isObject()) {
+    return "Body must be a JSON object";
+  }
+
+  const auto &obj = *json;
+  if (!obj.isMember("message") || !obj["message"].isString()) {
+    details["field"] = "message";
+    return "Field 'message' is required and must be a string";
+  }
+  out.message = obj["message"].asString();
+  if (out.message.empty()) {
     details["field"] = "message";
     return "Field 'message' cannot be empty";
   }
 
+  if (obj.isMember("request_id")) {
+    const auto id = obj["request_id"].isString() ? obj["request_id"].asString() : "";
+    if (!is_valid_request_id(id)) {
+      details["field"] = "request_id";
+      return kInvalidRequestId;
+    }
+    out.request_id = id;
+  }
+
+  if (obj.isMember("options")) {
+    const auto &options = obj["options"];
+    if (!options.isObject()) {
+      details["field"] = "options";
+      return "Field 'options' must be an object";
+    }
+    if (options.isMember("stream")) {
+      if (!options["stream"].isBool()) {
+        details["field"] = "options.stream";
+        return "Field 'options.stream' must be a boolean";
+      }
+      out.stream = options["stream"].asBool();
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<std::string> parse_chat_socket_message(const JsonPtr &json,
+                                                     ParsedChatSocketMessage &out,
+                                                     Json::Value &details) {
+  if (!json || !json->isObject()) {
+    return "Message must be a JSON object";
+  }
+
+  const auto &obj = *json;
+  if (!obj["type"].isString()) {
+    details["field"] = "type";
+    return "Field 'type' is required and must be a string";
+  }
+  out.type = obj["type"].asString();
+  if (out.type == "ping") {
+    return std::nullopt;
+  }
+  if (out.type == "send") {
+    return parse_chat_send_request(json, out.send, details);
+  }
+  if (out.type != "subscribe" && out.type != "cancel") {
+    details["field"] = "type";
+    return "Field 'type' must be one of send, subscribe, cancel, ping";
+  }
+
+  out.request_id = obj["request_id"].isString() ? obj["request_id"].asString() : "";
+  // Stream ids are valid request ids too.
+  if (!is_valid_request_id(out.request_id)) {
+    details["field"] = "request_id";
+    return kInvalidRequestId;
+  }
+  if (out.type == "subscribe" && obj.isMember("from_seq")) {
+    const auto &from_seq = obj["from_seq"];
+    if (!from_seq.isUInt64() || from_seq.asUInt64() == 0) {
+      details["field"] = "from_seq";
+      return "Field 'from_seq' must be a positive integer";
+    }
+    out.after_seq = from_seq.asUInt64() - 1;
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> parse_stream_resume_position(const std::string &last_event_id,
+                                                        const std::string &from_seq,
+                                                        std::uint64_t &after_seq,
+                                                        Json::Value &details) {
+  after_seq = 0;
+  if (!last_event_id.empty()) {
+    const auto seq = parse_sequence(last_event_id);
+    if (!seq.has_value()) {
+      details["field"] = "Last-Event-ID";
+      return "Header 'Last-Event-ID' must be an event sequence number";
+    }
+    after_seq = *seq;
+    return std::nullopt;
+  }
+  if (!from_seq.empty()) {
+    const auto seq = parse_sequence(from_seq);
+    if (!seq.has_value() || *seq == 0) {
+      details["field"] = "from_seq";
+      return "Query parameter 'from_seq' must be a positive integer";
+    }
+    after_seq = *seq - 1;
+  }
   return std::nullopt;
 }
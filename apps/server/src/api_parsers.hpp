@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <memory>
@@ -20,5 +21,28 @@ std::optional<std::string> parse_model_select_request(const JsonPtr &json,
                                                       Json::Value &details);
 
 std::optional<std::string> parse_chat_complete_request(const JsonPtr &json,
-                                                       std::string &message,
+                                                       ParsedChatRequest &out,
                                                        Json::Value &details);
+
+// The body is optional; every field has a default.
+std::optional<std::string> parse_session_create_request(const JsonPtr &json,
+                                                        ParsedSessionCreateRequest &out,
+                                                        Json::Value &details);
+
+std::optional<std::string> parse_chat_send_request(const JsonPtr &json,
+                                                   ParsedChatSendRequest &out,
+                                                   Json::Value &details);
+
+// A message sent on the chat WebSocket. `send` takes the fields of a session
+// send request (the turn always streams to the socket).
+std::optional<std::string> parse_chat_socket_message(const JsonPtr &json,
+                                                     ParsedChatSocketMessage &out,
+                                                     Json::Value &details);
+
+// Where a reconnecting stream client resumes: after the `Last-Event-ID` header
+// value or, failing that, at the `from_seq` query parameter (the first
+// sequence number wanted). Neither means from the first event.
+std::optional<std::string> parse_stream_resume_position(const std::string &last_event_id,
+                                                        const std::string &from_seq,
+                                                        std::uint64_t &after_seq,
+                                                        Json::Value &details);
@@ -1,5 +1,53 @@
 #include "api_serialization.hpp"
 
+#include "http_helpers.hpp"
+
+namespace {
+
+constexpr std::size_t kPreviewChars = 120;
+
+// Truncates to at most `max_bytes` without splitting a UTF-8 sequence.
+std::string utf8_prefix(const std::string &text, std::size_t max_bytes) {
+  if (text.size() <= max_bytes) {
+    return text;
+  }
+  auto end = max_bytes;
+  while (end > 0 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+    --end;
+  }
+  return text.substr(0, end);
+}
+
+void put_optional(Json::Value &out, const char *key, const std::optional<std::uint64_t> &value) {
+  if (value.has_value()) {
+    out[key] = static_cast<Json::UInt64>(*value);
+  }
+}
+
+Json::Value gguf_metadata_to_json(const GgufMetadata &meta) {
+  Json::Value out(Json::objectValue);
+  out["gguf_version"] = meta.version;
+  out["architecture"] = meta.architecture;
+  out["tensor_count"] = static_cast<Json::UInt64>(meta.tensor_count);
+  if (meta.name.has_value()) {
+    out["name"] = *meta.name;
+  }
+  if (meta.quantization.has_value()) {
+    out["quantization"] = *meta.quantization;
+  }
+  put_optional(out, "parameter_count", meta.parameter_count);
+  put_optional(out, "trained_context_length", meta.context_length);
+  put_optional(out, "block_count", meta.block_count);
+  put_optional(out, "embedding_length", meta.embedding_length);
+  put_optional(out, "head_count", meta.head_count);
+  put_optional(out, "head_count_kv", meta.head_count_kv);
+  put_optional(out, "vocab_size", meta.vocab_size);
+  put_optional(out, "kv_bytes_per_token", meta.kv_bytes_per_token());
+  return out;
+}
+
+}  // namespace
+
 Json::Value model_to_json(const ModelEntry &model) {
   Json::Value out(Json::objectValue);
   out["id"] = model.id;
@@ -8,5 +56,147 @@ Json::Value model_to_json(const ModelEntry &model) {
   out["status"] = model.status;
   out["context_size"] = model.context_size;
   out["file_size_bytes"] = static_cast<Json::UInt64>(model.file_size_bytes);
+  if (!model.shard_paths.empty()) {
+    Json::Value shards(Json::arrayValue);
+    for (const auto &shard : model.shard_paths) {
+      shards.append(shard);
+    }
+    out["shard_paths"] = shards;
+  }
+  out["resident"] = model.resident;
+  if (model.metadata.has_value()) {
+    out["metadata"] = gguf_metadata_to_json(*model.metadata);
+  }
+  out["estimated_resident_bytes"] = static_cast<Json::UInt64>(estimate_resident_bytes(
+      model.file_size_bytes, model.context_size,
+      model.metadata ? model.metadata->kv_bytes_per_token() : std::nullopt,
+      model.parallel_sequences));
+  Json::Value load_options(Json::objectValue);
+  load_options["prefetch"] = std::string(prefetch_mode_name(model.load_options.prefetch));
+  load_options["mlock"] = model.load_options.mlock;
+  out["load_options"] = load_options;
+  if (model.load_job_id.has_value()) {
+    out["load_job_id"] = *model.load_job_id;
+  }
+  if (model.load_progress_percent.has_value()) {
+    out["load_progress_percent"] = *model.load_progress_percent;
+  }
+  return out;
+}
+
+Json::Value model_list_to_json(const std::vector<ModelEntry> &models,
+                               const std::optional<std::string> &active_model_id,
+                               const std::vector<std::string> &draining_model_ids) {
+  Json::Value body(Json::objectValue);
+  Json::Value list(Json::arrayValue);
+  for (const auto &model : models) {
+    list.append(model_to_json(model));
+  }
+  body["models"] = list;
+  if (active_model_id.has_value()) {
+    body["active_model_id"] = *active_model_id;
+  } else {
+    body["active_model_id"] = Json::nullValue;
+  }
+  Json::Value draining(Json::arrayValue);
+  for (const auto &model_id : draining_model_ids) {
+    draining.append(model_id);
+  }
+  body["draining_model_ids"] = draining;
+  return body;
+}
+
+std::string serialize_json(const Json::Value &json) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, json);
+}
+
+Json::Value model_load_to_json(const ModelLoadStatus &load) {
+  Json::Value out(Json::objectValue);
+  out["id"] = load.id;
+  out["model_id"] = load.model_id;
+  out["context_size"] = load.context_size;
+  out["state"] = load.state;
+  out["phase"] = load.phase;
+  out["bytes_total"] = static_cast<Json::UInt64>(load.bytes_total);
+  out["bytes_loaded"] = static_cast<Json::UInt64>(load.bytes_loaded);
+  out["progress_percent"] = load.progress_percent;
+  out["cancel_requested"] = load.cancel_requested;
+  out["activate"] = load.activate;
+  out["elapsed_ms"] = static_cast<Json::Int64>(load.elapsed_ms);
+  Json::Value timings(Json::objectValue);
+  for (const auto &[step, ms] : load.timings_ms) {
+    timings[step + "_ms"] = static_cast<Json::Int64>(ms);
+  }
+  out["timings"] = timings;
+  if (!load.error_code.empty()) {
+    Json::Value error(Json::objectValue);
+    error["code"] = load.error_code;
+    error["message"] = load.error_message;
+    out["error"] = error;
+  }
+  return out;
+}
+
+Json::Value chat_response_to_json(const ChatResult &result) {
+  const auto &response = result.response;
+  Json::Value usage(Json::objectValue);
+  usage["prompt_tokens"] = response.usage.prompt_tokens;
+  usage["completion_tokens"] = response.usage.completion_tokens;
+  usage["total_tokens"] = response.usage.total_tokens;
+
+  Json::Value metrics(Json::objectValue);
+  metrics["latency_ms"] = static_cast<Json::Int64>(response.metrics.latency_ms.count());
+  metrics["time_to_first_token_ms"] =
+      static_cast<Json::Int64>(response.metrics.time_to_first_token_ms.count());
+  metrics["tokens_per_second"] = response.metrics.tokens_per_second;
+  const auto &prefix = result.prefix_cache;
+  metrics["prefix_cache_hit"] = prefix.hit;
+  metrics["prefix_tokens_reused"] = static_cast<Json::UInt64>(prefix.reused_tokens);
+  metrics["prefix_cache_hit_rate"] = prefix.totals.hit_rate();
+  metrics["prefill_tokens_saved"] = static_cast<Json::UInt64>(prefix.totals.prefill_tokens_saved);
+  if (!result.cache.empty()) {
+    metrics["cache"] = result.cache;
+  }
+
+  Json::Value out(Json::objectValue);
+  out["text"] = response.text;
+  out["usage"] = usage;
+  out["metrics"] = metrics;
+  return out;
+}
+
+Json::Value session_summary_to_json(const ChatSession &session) {
+  Json::Value out(Json::objectValue);
+  out["id"] = session.id;
+  out["title"] = session.title;
+  if (session.model_id.has_value()) {
+    out["model_id"] = *session.model_id;
+  } else {
+    out["model_id"] = Json::nullValue;
+  }
+  out["created_at"] = format_rfc3339_utc(session.created_at_ms);
+  out["updated_at"] = format_rfc3339_utc(session.updated_at_ms);
+  out["message_count"] = static_cast<Json::UInt64>(session.messages.size());
+  if (session.messages.empty()) {
+    out["last_message_preview"] = Json::nullValue;
+  } else {
+    out["last_message_preview"] = utf8_prefix(session.messages.back().content, kPreviewChars);
+  }
+  return out;
+}
+
+Json::Value session_to_json(const ChatSession &session) {
+  auto out = session_summary_to_json(session);
+  out["system_prompt"] = session.system_prompt;
+  Json::Value messages(Json::arrayValue);
+  for (const auto &message : session.messages) {
+    Json::Value item(Json::objectValue);
+    item["role"] = message.role;
+    item["content"] = message.content;
+    messages.append(item);
+  }
+  out["messages"] = messages;
   return out;
 }
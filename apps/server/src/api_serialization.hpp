@@ -5,3 +5,22 @@
 #include "runtime_state.hpp"
 
 Json::Value model_to_json(const ModelEntry &model);
+
+// The GET /api/models body.
+Json::Value model_list_to_json(const std::vector<ModelEntry> &models,
+                               const std::optional<std::string> &active_model_id,
+                               const std::vector<std::string> &draining_model_ids);
+
+// Compact (unindented) JSON text.
+std::string serialize_json(const Json::Value &json);
+
+Json::Value model_load_to_json(const ModelLoadStatus &load);
+
+// {text, usage, metrics} body shared by /api/chat/complete and the SSE `done`
+// event. `metrics` includes the agent's prefix cache figures.
+Json::Value chat_response_to_json(const ChatResult &result);
+
+// SessionSummary: metadata plus a preview of the latest message.
+Json::Value session_summary_to_json(const ChatSession &session);
+// The summary plus the system prompt and full transcript.
+Json::Value session_to_json(const ChatSession &session);
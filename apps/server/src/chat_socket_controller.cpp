@@ -0,0 +1,298 @@
+#include "chat_socket_controller.hpp"
+
+#include <drogon/drogon.h>
+
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+#include "api_parsers.hpp"
+#include "chat_stream_task.hpp"
+#include "http_helpers.hpp"
+#include "routes.hpp"
+#include "sse_writer.hpp"
+
+namespace {
+
+constexpr std::string_view kPathPrefix = "/api/chat/";
+constexpr std::string_view kPathSuffix = "/stream";
+
+// Sends one generation's events as WebSocket text frames: each event object
+// with the generation's request_id and seq added (no seq on the slow-consumer
+// error, which is not logged). Frames are queued length-prefixed so a drain
+// can send them as separate messages. Ending the subscription leaves the
+// socket open.
+class WebSocketStreamSubscriber final : public LoopStreamSubscriber {
+ public:
+  WebSocketStreamSubscriber(const drogon::WebSocketConnectionPtr &conn, trantor::EventLoop *loop,
+                            std::size_t buffer_bytes, const std::string &request_id)
+      : LoopStreamSubscriber(loop, buffer_bytes), conn_(conn) {
+    tags_ = "{\"request_id\":";
+    append_json_string(tags_, request_id);
+  }
+
+ protected:
+  void frame(std::string &out, const StreamEvent &event) override {
+    const auto start = out.size();
+    out.append(sizeof(std::uint32_t), '\0');
+    out += tags_;
+    if (event.seq != 0) {
+      char digits[24];
+      const auto result = std::to_chars(digits, digits + sizeof(digits), event.seq);
+      out.append(",\"seq\":").append(digits, result.ptr);
+    }
+    // Every event object opens with "{"type":", so the tags go in front.
+    out += ',';
+    out.append(event.json.substr(1));
+    const auto length =
+        static_cast<std::uint32_t>(out.size() - start - sizeof(std::uint32_t));
+    std::memcpy(out.data() + start, &length, sizeof(length));
+  }
+
+  bool send(const std::string &batch) override {
+    const auto conn = conn_.lock();
+    if (!conn || !conn->connected()) {
+      return false;
+    }
+    for (std::size_t offset = 0; offset + sizeof(std::uint32_t) <= batch.size();) {
+      std::uint32_t length = 0;
+      std::memcpy(&length, batch.data() + offset, sizeof(length));
+      offset += sizeof(length);
+      conn->send(batch.data() + offset, length);
+      offset += length;
+    }
+    return true;
+  }
+
+  void end() override {}
+
+ private:
+  // Weak: the socket's context owns its subscribers.
+  const std::weak_ptr<drogon::WebSocketConnection> conn_;
+  std::string tags_;  // The frame's opening brace and request_id
+};
+
+void send_json(const drogon::WebSocketConnectionPtr &conn, const Json::Value &frame) {
+  static const auto builder = [] {
+    Json::StreamWriterBuilder b;
+    b["indentation"] = "";
+    return b;
+  }();
+  conn->send(Json::writeString(builder, frame));
+}
+
+// An error frame. Without a seq, unlike the error events of a generation.
+void send_error(const drogon::WebSocketConnectionPtr &conn, const std::string &request_id,
+                const std::string &code, const std::string &message,
+                const Json::Value &details = Json::Value()) {
+  Json::Value frame(Json::objectValue);
+  frame["type"] = "error";
+  if (!request_id.empty()) {
+    frame["request_id"] = request_id;
+  }
+  frame["code"] = code;
+  frame["message"] = message;
+  if (details.isObject() && !details.empty()) {
+    frame["details"] = details;
+  }
+  send_json(conn, frame);
+}
+
+}  // namespace
+
+// Per-connection state, only touched from the connection's IO loop (which runs
+// every handler for it).
+struct ChatSocketController::Socket {
+  std::string session_id;
+  std::unordered_map<std::string, std::shared_ptr<WebSocketStreamSubscriber>> subscriptions;
+};
+
+ChatSocketController::ChatSocketController(RuntimeState &runtime_state,
+                                           StreamHubRegistry &stream_hubs)
+    : runtime_state_(runtime_state), stream_hubs_(stream_hubs) {}
+
+void ChatSocketController::handleNewConnection(const drogon::HttpRequestPtr &req,
+                                               const drogon::WebSocketConnectionPtr &conn) {
+  auto socket = std::make_shared<Socket>();
+  const std::string_view path = req->path();
+  if (path.size() > kPathPrefix.size() + kPathSuffix.size()) {
+    socket->session_id = std::string(
+        path.substr(kPathPrefix.size(), path.size() - kPathPrefix.size() - kPathSuffix.size()));
+  }
+  conn->setContext(socket);
+  if (!runtime_state_.session(socket->session_id).has_value()) {
+    send_error(conn, "", "APP-SESSION-404", "Session not found");
+    conn->shutdown(drogon::CloseCode::kViolation, "Session not found");
+    return;
+  }
+
+  const auto heartbeat = runtime_state_.ws_heartbeat_interval();
+  if (heartbeat.count() > 0) {
+    conn->setPingMessage("", heartbeat);
+  }
+  LOG_INFO << "Chat socket opened for session " << socket->session_id;
+  Json::Value ready(Json::objectValue);
+  ready["type"] = "ready";
+  ready["session_id"] = socket->session_id;
+  send_json(conn, ready);
+
+  // Reconnecting clients name the generation to pick up in the handshake.
+  const auto &request_id = req->getParameter("request_id");
+  if (request_id.empty()) {
+    return;
+  }
+  std::uint64_t after_seq = 0;
+  Json::Value details(Json::objectValue);
+  if (const auto parse_error =
+          parse_stream_resume_position("", req->getParameter("from_seq"), after_seq, details);
+      parse_error.has_value()) {
+    send_error(conn, request_id, "APP-VAL-001", *parse_error, details);
+    return;
+  }
+  subscribe(conn, *socket, request_id, after_seq);
+}
+
+void ChatSocketController::handleNewMessage(const drogon::WebSocketConnectionPtr &conn,
+                                            std::string &&message,
+                                            const drogon::WebSocketMessageType &type) {
+  // Ping and pong frames are answered by Drogon.
+  if (type == drogon::WebSocketMessageType::Binary) {
+    send_error(conn, "", "APP-VAL-001", "Messages must be JSON text frames");
+    return;
+  }
+  const auto socket = conn->getContext<Socket>();
+  if (type != drogon::WebSocketMessageType::Text || !socket) {
+    return;
+  }
+
+  auto json = std::make_shared<Json::Value>();
+  if (!Json::Reader().parse(message, *json, false)) {
+    json.reset();
+  }
+  ParsedChatSocketMessage parsed;
+  Json::Value details(Json::objectValue);
+  if (const auto parse_error = parse_chat_socket_message(json, parsed, details);
+      parse_error.has_value()) {
+    send_error(conn, "", "APP-VAL-001", *parse_error, details);
+    return;
+  }
+
+  if (parsed.type == "send") {
+    submit(conn, *socket, std::move(parsed.send));
+  } else if (parsed.type == "subscribe") {
+    subscribe(conn, *socket, parsed.request_id, parsed.after_seq);
+  } else if (parsed.type == "cancel") {
+    cancel(conn, parsed.request_id);
+  } else {
+    Json::Value pong(Json::objectValue);
+    pong["type"] = "pong";
+    send_json(conn, pong);
+  }
+}
+
+void ChatSocketController::handleConnectionClosed(const drogon::WebSocketConnectionPtr &conn) {
+  const auto socket = conn->getContext<Socket>();
+  if (!socket) {
+    return;
+  }
+  // The generations keep running; they are detached.
+  for (const auto &[request_id, subscriber] : socket->subscriptions) {
+    subscriber->disconnect();
+  }
+  socket->subscriptions.clear();
+  LOG_INFO << "Chat socket closed for session " << socket->session_id;
+}
+
+void ChatSocketController::submit(const drogon::WebSocketConnectionPtr &conn, Socket &socket,
+                                  ParsedChatSendRequest request) {
+  const auto request_id = request.request_id.value_or("");
+  std::string error_code;
+  std::string error_message;
+  int retry_after_seconds = 0;
+  const auto hub = submit_detached_session_chat(runtime_state_, stream_hubs_, socket.session_id,
+                                                std::move(request), error_code, error_message,
+                                                retry_after_seconds);
+  if (!hub) {
+    Json::Value details(Json::objectValue);
+    if (error_code == "APP-RATE-429") {
+      details["retry_after_seconds"] = retry_after_seconds;
+    }
+    send_error(conn, request_id, error_code, error_message, details);
+    return;
+  }
+
+  Json::Value accepted(Json::objectValue);
+  accepted["type"] = "accepted";
+  accepted["request_id"] = hub->id();
+  accepted["status"] = hub->finished() ? "finished" : "queued";
+  send_json(conn, accepted);
+  attach(conn, socket, hub, 0);
+}
+
+void ChatSocketController::subscribe(const drogon::WebSocketConnectionPtr &conn, Socket &socket,
+                                     const std::string &request_id, std::uint64_t after_seq) {
+  const auto hub = stream_hubs_.find(request_id);
+  if (!hub) {
+    send_error(conn, request_id, "APP-STREAM-404", "Stream not found or no longer resumable");
+    return;
+  }
+  attach(conn, socket, hub, after_seq);
+}
+
+void ChatSocketController::cancel(const drogon::WebSocketConnectionPtr &conn,
+                                  const std::string &request_id) {
+  const auto hub = stream_hubs_.find(request_id);
+  if (!hub) {
+    send_error(conn, request_id, "APP-STREAM-404", "Stream not found or no longer resumable");
+    return;
+  }
+  if (!hub->cancel()) {
+    send_error(conn, request_id, "APP-STATE-409", "Generation has already finished");
+    return;
+  }
+  LOG_INFO << "Cancelling chat stream " << request_id;
+  Json::Value cancelling(Json::objectValue);
+  cancelling["type"] = "cancelling";
+  cancelling["request_id"] = request_id;
+  send_json(conn, cancelling);
+}
+
+void ChatSocketController::attach(const drogon::WebSocketConnectionPtr &conn, Socket &socket,
+                                  const std::shared_ptr<StreamHub> &hub,
+                                  std::uint64_t after_seq) {
+  std::erase_if(socket.subscriptions,
+                [](const auto &entry) { return entry.second->gone(); });
+  auto &subscriber = socket.subscriptions[hub->id()];
+  if (subscriber) {
+    subscriber->disconnect();  // Subscribing again restarts the replay
+  }
+  subscriber = std::make_shared<WebSocketStreamSubscriber>(
+      conn, trantor::EventLoop::getEventLoopOfCurrentThread(),
+      runtime_state_.stream_buffer_bytes(), hub->id());
+  std::string error_code;
+  std::string error_message;
+  if (!hub->attach(subscriber, after_seq, error_code, error_message)) {
+    send_error(conn, hub->id(), error_code, error_message);
+    socket.subscriptions.erase(hub->id());
+  }
+}
+
+void register_chat_socket(RuntimeState &runtime_state, StreamHubRegistry &stream_hubs) {
+  drogon::app().registerController(
+      std::make_shared<ChatSocketController>(runtime_state, stream_hubs));
+
+  // The socket's path without an upgrade.
+  drogon::app().registerHandler(
+      "/api/chat/{1}/stream",
+      [](const drogon::HttpRequestPtr &req,
+         std::function<void(const drogon::HttpResponsePtr &)> &&cb, const std::string &) {
+        auto resp = make_error_response(req, drogon::k426UpgradeRequired, "APP-VAL-001",
+                                        "validation",
+                                        "This endpoint only accepts WebSocket connections",
+                                        false, Json::Value(Json::objectValue));
+        resp->addHeader("Upgrade", "websocket");
+        cb(resp);
+      },
+      {drogon::Get});
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <drogon/WebSocketController.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "runtime_state.hpp"
+#include "stream_hub.hpp"
+
+// The chat WebSocket at /api/chat/{session_id}/stream (docs/api/ws-events.md).
+// One connection submits turns to its session, follows any number of
+// generations and cancels them; events arrive as JSON text frames tagged with
+// their generation's request_id and sequence number. Generations run detached
+// on the same hubs as /api/chat/stream/{id}, so a dropped socket loses
+// nothing: the client reconnects and subscribes again with `from_seq`.
+class ChatSocketController
+    : public drogon::WebSocketController<ChatSocketController, /*AutoCreation=*/false> {
+ public:
+  ChatSocketController(RuntimeState &runtime_state, StreamHubRegistry &stream_hubs);
+
+  void handleNewConnection(const drogon::HttpRequestPtr &req,
+                           const drogon::WebSocketConnectionPtr &conn) override;
+  void handleNewMessage(const drogon::WebSocketConnectionPtr &conn, std::string &&message,
+                        const drogon::WebSocketMessageType &type) override;
+  void handleConnectionClosed(const drogon::WebSocketConnectionPtr &conn) override;
+
+  WS_PATH_LIST_BEGIN
+  WS_ADD_PATH_VIA_REGEX("/api/chat/[^/]+/stream");
+  WS_PATH_LIST_END
+
+ private:
+  struct Socket;
+
+  void submit(const drogon::WebSocketConnectionPtr &conn, Socket &socket,
+              ParsedChatSendRequest request);
+  void subscribe(const drogon::WebSocketConnectionPtr &conn, Socket &socket,
+                 const std::string &request_id, std::uint64_t after_seq);
+  void cancel(const drogon::WebSocketConnectionPtr &conn, const std::string &request_id);
+  // Replaces any earlier subscription of this socket to the same generation.
+  void attach(const drogon::WebSocketConnectionPtr &conn, Socket &socket,
+              const std::shared_ptr<StreamHub> &hub, std::uint64_t after_seq);
+
+  RuntimeState &runtime_state_;
+  StreamHubRegistry &stream_hubs_;
+};
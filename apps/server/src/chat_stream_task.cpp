@@ -0,0 +1,224 @@
+#include "chat_stream_task.hpp"
+
+#include <drogon/drogon.h>
+
+#include "api_serialization.hpp"
+
+LoopStreamSubscriber::LoopStreamSubscriber(trantor::EventLoop *loop, std::size_t buffer_bytes)
+    : loop_(loop), ring_(buffer_bytes) {}
+
+void LoopStreamSubscriber::replay(const std::vector<StreamEvent> &events) {
+  for (const auto &event : events) {
+    frame(backlog_, event);
+  }
+  if (!backlog_.empty()) {
+    schedule();
+  }
+}
+
+bool LoopStreamSubscriber::deliver(const StreamEvent &event) {
+  if (gone()) {
+    return false;
+  }
+  frame_.clear();  // Keeps the capacity
+  frame(frame_, event);
+  if (!ring_.try_write(frame_)) {
+    // Not keeping up. Cut the client off rather than buffer without bound; the
+    // error goes out after what is already buffered.
+    LOG_WARN << "Closing chat stream: client fell more than " << ring_.capacity()
+             << " bytes behind";
+    static const std::string kSlowConsumer = SseEventWriter(128).error(
+        "APP-STREAM-507", "Client is not reading the stream fast enough");
+    std::string last;
+    frame(last, {0, kSlowConsumer});
+    close_with(std::move(last));
+    return false;
+  }
+  schedule();
+  return true;
+}
+
+void LoopStreamSubscriber::close() { close_with({}); }
+
+bool LoopStreamSubscriber::gone() const {
+  return closing_.load(std::memory_order_acquire) ||
+         disconnected_.load(std::memory_order_relaxed);
+}
+
+void LoopStreamSubscriber::disconnect() { disconnected_.store(true, std::memory_order_relaxed); }
+
+void LoopStreamSubscriber::close_with(std::string last) {
+  if (closing_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  last_ = std::move(last);
+  closing_.store(true, std::memory_order_release);
+  schedule();
+}
+
+void LoopStreamSubscriber::schedule() {
+  // At most one drain is queued; a write that lands while one runs queues the
+  // next (the exchanges pair up, so no write is left unsent).
+  if (drain_queued_.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  if (loop_ == nullptr) {
+    drain();
+    return;
+  }
+  loop_->queueInLoop([self = shared_from_this()] { self->drain(); });
+}
+
+void LoopStreamSubscriber::drain() {
+  drain_queued_.exchange(false, std::memory_order_acq_rel);
+  const bool closing = closing_.load(std::memory_order_acquire);
+  batch_.clear();
+  if (!backlog_.empty()) {
+    batch_.swap(backlog_);
+    std::string().swap(backlog_);
+  }
+  ring_.read_into(batch_);
+  if (closing) {
+    batch_ += last_;
+  }
+  if (ended_) {
+    return;
+  }
+  if (!batch_.empty() && !disconnected_.load(std::memory_order_relaxed) && !send(batch_)) {
+    disconnected_.store(true, std::memory_order_relaxed);
+  }
+  if (closing) {
+    ended_ = true;
+    end();
+  }
+}
+
+SseStreamSubscriber::SseStreamSubscriber(drogon::ResponseStreamPtr stream,
+                                         trantor::EventLoop *loop, std::size_t buffer_bytes)
+    : LoopStreamSubscriber(loop, buffer_bytes), stream_(std::move(stream)) {}
+
+void SseStreamSubscriber::frame(std::string &out, const StreamEvent &event) {
+  if (event.seq == 0) {
+    out.append("data: ").append(event.json).append("\n\n");
+    return;
+  }
+  append_sse_event(out, event.seq, event.json);
+}
+
+bool SseStreamSubscriber::send(const std::string &batch) { return stream_->send(batch); }
+
+void SseStreamSubscriber::end() {
+  stream_->close();
+  stream_.reset();
+}
+
+std::shared_ptr<StreamHub> submit_detached_session_chat(
+    RuntimeState &runtime_state, StreamHubRegistry &stream_hubs, const std::string &session_id,
+    ParsedChatSendRequest request, std::string &error_code, std::string &error_message,
+    int &retry_after_seconds) {
+  if (request.request_id.has_value()) {
+    if (auto existing = stream_hubs.find(*request.request_id)) {
+      return existing;
+    }
+  }
+
+  auto reservation = runtime_state.admit_session_chat(session_id, error_code, error_message,
+                                                      retry_after_seconds);
+  if (!reservation) {
+    return nullptr;
+  }
+
+  bool created = true;
+  auto hub = request.request_id.has_value()
+                 ? stream_hubs.find_or_create(*request.request_id, StreamLifetime::kDetached,
+                                              created)
+                 : stream_hubs.create(StreamLifetime::kDetached);
+  if (created) {
+    LOG_INFO << "Starting detached chat " << hub->id() << " in session " << session_id;
+    runtime_state.session_chat_stream_async(
+        std::move(*reservation), session_id, std::move(request.message),
+        std::make_shared<ChatStreamTask>(
+            hub, fit_flush_to_buffer(runtime_state.stream_flush_policy(),
+                                     runtime_state.stream_buffer_bytes())));
+  }
+  // Otherwise a concurrent submission of the same id won; the reservation is
+  // released unused.
+  return hub;
+}
+
+ChatStreamTask::ChatStreamTask(std::shared_ptr<StreamHub> hub, StreamFlushPolicy flush)
+    : hub_(std::move(hub)), tokens_(flush) {}
+
+ChatStreamTask::~ChatStreamTask() {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (finished_) {
+    return;
+  }
+  // Nobody is listening to a cancelled stream; otherwise the task was dropped
+  // without running, which only happens at shutdown.
+  if (!cancelled()) {
+    hub_->publish(writer_.error("APP-STATE-503", "Server is shutting down"));
+  }
+  finish_locked();
+}
+
+bool ChatStreamTask::cancelled() const { return hub_->stop_requested(StreamHub::Clock::now()); }
+
+void ChatStreamTask::on_queued(std::size_t position) {
+  std::lock_guard<std::mutex> lock(mu_);
+  hub_->publish(writer_.queued(position));
+}
+
+void ChatStreamTask::on_token(std::string_view token) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (tokens_.append(token, TokenCoalescer::Clock::now())) {
+    flush_tokens_locked(/*final=*/false);
+  }
+}
+
+void ChatStreamTask::on_tick() {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (tokens_.due(TokenCoalescer::Clock::now())) {
+    flush_tokens_locked(/*final=*/false);
+  }
+}
+
+void ChatStreamTask::on_done(const ChatResult &result) {
+  // Built once per stream, so the DOM is affordable here.
+  const Json::Value done = chat_response_to_json(result);
+
+  std::lock_guard<std::mutex> lock(mu_);
+  flush_tokens_locked(/*final=*/true);
+  hub_->publish(writer_.object("done", done));
+  finish_locked();
+}
+
+void ChatStreamTask::on_error(const std::string &error_code, const std::string &error_message) {
+  if (cancelled()) {
+    LOG_INFO << "Streaming chat stopped: " << error_message;
+  } else {
+    LOG_ERROR << "Streaming chat failed: " << error_message;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  flush_tokens_locked(/*final=*/true);
+  hub_->publish(writer_.error(error_code, error_message));
+  finish_locked();
+}
+
+void ChatStreamTask::flush_tokens_locked(bool final) {
+  const auto text = tokens_.ready(final);
+  if (text.empty()) {
+    return;
+  }
+  hub_->publish(writer_.token(text));
+  tokens_.consume(text.size());
+}
+
+void ChatStreamTask::finish_locked() {
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  hub_->finish();
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <drogon/HttpResponse.h>
+#include <trantor/net/EventLoop.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "runtime_state.hpp"
+#include "spsc_byte_ring.hpp"
+#include "sse_writer.hpp"
+#include "stream_hub.hpp"
+#include "token_coalescer.hpp"
+
+// Sends a stream's events to one client connection. The generation never
+// writes to the socket itself: live events go into a bounded ring that the
+// connection's IO loop drains on its own schedule, so a slow client or a busy
+// loop never stalls decoding. A client that falls `buffer_bytes` behind is cut
+// off with an APP-STREAM-507 error event (and may resume). Subclasses supply
+// the transport: how an event is framed and how a batch is sent.
+class LoopStreamSubscriber : public StreamSubscriber,
+                             public std::enable_shared_from_this<LoopStreamSubscriber> {
+ public:
+  void replay(const std::vector<StreamEvent> &events) final;
+  bool deliver(const StreamEvent &event) final;
+  void close() final;
+  bool gone() const final;
+  // The connection went away; nothing more is sent and the hub drops this
+  // subscriber. Safe from any thread.
+  void disconnect();
+
+ protected:
+  // `loop` is the IO loop that owns the connection.
+  LoopStreamSubscriber(trantor::EventLoop *loop, std::size_t buffer_bytes);
+
+  // Appends the wire form of `event` to `out`. Called on the writer side; an
+  // event with seq 0 is not in the stream's log (the slow-consumer error).
+  virtual void frame(std::string &out, const StreamEvent &event) = 0;
+  // IO loop: sends a batch of framed events. False once the connection is
+  // gone.
+  virtual bool send(const std::string &batch) = 0;
+  // IO loop: the subscription is over, after the last batch was sent.
+  virtual void end() = 0;
+
+ private:
+  void close_with(std::string last);
+  void schedule();
+  // Runs on the IO loop; the only code that calls send() and end().
+  void drain();
+
+  trantor::EventLoop *const loop_;
+  SpscByteRing ring_;
+  std::string frame_;    // Writer side: the event being framed
+  std::string backlog_;  // Replayed events, written before the first drain
+  std::string batch_;    // Loop side: reused by every drain
+  std::string last_;     // Published by closing_
+  bool ended_ = false;   // Loop side
+  std::atomic<bool> drain_queued_{false};
+  std::atomic<bool> closing_{false};
+  std::atomic<bool> disconnected_{false};
+};
+
+// Sends a stream's events to one SSE response, each with its sequence number
+// as the SSE id. Drogon only reports a closed connection through a failed
+// send(), so every drain doubles as a disconnect probe that flips gone().
+class SseStreamSubscriber final : public LoopStreamSubscriber {
+ public:
+  SseStreamSubscriber(drogon::ResponseStreamPtr stream, trantor::EventLoop *loop,
+                      std::size_t buffer_bytes);
+
+ protected:
+  void frame(std::string &out, const StreamEvent &event) override;
+  bool send(const std::string &batch) override;
+  void end() override;
+
+ private:
+  drogon::ResponseStreamPtr stream_;
+};
+
+// Starts a session turn that runs whether or not anybody watches it,
+// publishing to a detached hub that clients follow by its id. Submitting a
+// request_id that is still known returns that generation's hub instead of
+// starting another. Null with the admission failure (see
+// RuntimeState::admit_session_chat) when the turn cannot be queued.
+std::shared_ptr<StreamHub> submit_detached_session_chat(
+    RuntimeState &runtime_state, StreamHubRegistry &stream_hubs, const std::string &session_id,
+    ParsedChatSendRequest request, std::string &error_code, std::string &error_message,
+    int &retry_after_seconds);
+
+// One streamed generation (an /api/chat/stream request or a detached session
+// send) scheduled on the runtime's inference executor. It publishes every event
+// to its StreamHub, which logs it for late or reconnecting clients and fans it
+// out to those watching live. The hub is always finished exactly once, after a
+// terminal event or, if the task is dropped before finishing (e.g. at
+// shutdown), by the destructor.
+//
+// The generation is cancelled when the hub asks it to stop (see
+// StreamHub::stop_requested).
+//
+// Tokens are buffered and published as one `token` event per flush of the
+// coalescer; the buffer is always drained before a terminal event. Events are
+// encoded into a buffer reused for the life of the stream.
+class ChatStreamTask : public ChatStreamSink {
+ public:
+  ChatStreamTask(std::shared_ptr<StreamHub> hub, StreamFlushPolicy flush);
+  ~ChatStreamTask() override;
+
+  ChatStreamTask(const ChatStreamTask &) = delete;
+  ChatStreamTask &operator=(const ChatStreamTask &) = delete;
+
+  void on_queued(std::size_t position) override;
+  void on_started() override {}
+  void on_token(std::string_view token) override;
+  void on_tick() override;
+  void on_done(const ChatResult &result) override;
+  void on_error(const std::string &error_code, const std::string &error_message) override;
+  bool cancelled() const override;
+
+ private:
+  // All require mu_ to be held.
+  void flush_tokens_locked(bool final);
+  void finish_locked();
+
+  std::mutex mu_;
+  const std::shared_ptr<StreamHub> hub_;
+  TokenCoalescer tokens_;
+  SseEventWriter writer_;
+  bool finished_ = false;
+};
@@ -0,0 +1,91 @@
+#include "completion_cache.hpp"
+
+#include <cstdio>
+#include <iterator>
+
+namespace {
+
+// Bookkeeping per entry beyond its key and reply: list node, index slot.
+constexpr std::size_t kEntryOverheadBytes = 128;
+
+}  // namespace
+
+std::string completion_cache_key(std::string_view model_id, std::uint64_t context_hash,
+                                 std::string_view params, std::string_view message) {
+  char context[17];
+  std::snprintf(context, sizeof(context), "%016llx",
+                static_cast<unsigned long long>(context_hash));
+  // Model ids and parameters never contain NUL, so the fields cannot run into
+  // one another; the message goes last.
+  std::string key;
+  key.reserve(model_id.size() + params.size() + message.size() + 19);
+  key.append(model_id).push_back('\0');
+  key.append(context, 16).push_back('\0');
+  key.append(params).push_back('\0');
+  key.append(message);
+  return key;
+}
+
+std::optional<zoo::Response> CompletionCache::find(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mu_);
+  const auto it = index_.find(key);
+  if (it == index_.end()) {
+    return std::nullopt;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->response;
+}
+
+void CompletionCache::insert(std::string key, zoo::Response response) {
+  const auto entry_bytes = key.size() + response.text.size() + kEntryOverheadBytes;
+  if (entry_bytes > max_bytes_) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  if (const auto it = index_.find(key); it != index_.end()) {
+    erase_locked(it->second);
+  }
+  while (!lru_.empty() && bytes_ + entry_bytes > max_bytes_) {
+    erase_locked(std::prev(lru_.end()));
+  }
+  lru_.push_front({std::move(key), std::move(response), entry_bytes});
+  index_.emplace(lru_.front().key, lru_.begin());
+  bytes_ += entry_bytes;
+}
+
+void CompletionCache::erase_model(std::string_view model_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto it = lru_.begin(); it != lru_.end();) {
+    const auto next = std::next(it);
+    // Keys start with the model id and a NUL.
+    if (it->key.size() > model_id.size() && it->key.starts_with(model_id) &&
+        it->key[model_id.size()] == '\0') {
+      erase_locked(it);
+    }
+    it = next;
+  }
+}
+
+void CompletionCache::clear() {
+  std::lock_guard<std::mutex> lock(mu_);
+  index_.clear();
+  lru_.clear();
+  bytes_ = 0;
+}
+
+std::size_t CompletionCache::size() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return lru_.size();
+}
+
+std::size_t CompletionCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return bytes_;
+}
+
+void CompletionCache::erase_locked(std::list<Entry>::iterator it) {
+  bytes_ -= it->bytes;
+  index_.erase(it->key);
+  lru_.erase(it);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <zoo/types.hpp>
+
+// The exact inputs of a completion: the model, the context it starts from
+// (a conversation key), the generation parameters and the message.
+std::string completion_cache_key(std::string_view model_id, std::uint64_t context_hash,
+                                 std::string_view params, std::string_view message);
+
+// Replies of finished completions by their exact inputs, so a repeated request
+// is answered without running the model. Only sound when decoding is
+// deterministic. LRU, bounded by the bytes of its keys and replies.
+// Internally synchronized.
+class CompletionCache {
+ public:
+  // A budget of 0 disables the cache.
+  explicit CompletionCache(std::size_t max_bytes) : max_bytes_(max_bytes) {}
+
+  CompletionCache(const CompletionCache &) = delete;
+  CompletionCache &operator=(const CompletionCache &) = delete;
+
+  bool enabled() const { return max_bytes_ > 0; }
+
+  // The cached reply and marks it most recently used.
+  std::optional<zoo::Response> find(const std::string &key);
+  // Replaces any entry under `key`. A reply larger than the whole budget is
+  // not kept.
+  void insert(std::string key, zoo::Response response);
+  // Drops the entries of `model_id`, e.g. once it is unloaded or replaced.
+  void erase_model(std::string_view model_id);
+  void clear();
+
+  std::size_t size() const;
+  std::size_t bytes() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    zoo::Response response;
+    std::size_t bytes = 0;
+  };
+
+  void erase_locked(std::list<Entry>::iterator it);
+
+  const std::size_t max_bytes_;
+  mutable std::mutex mu_;
+  std::list<Entry> lru_;  // Most recently used first
+  // Keys view into lru_, whose nodes never move.
+  std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+  std::size_t bytes_ = 0;
+};
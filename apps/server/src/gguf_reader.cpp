@@ -0,0 +1,310 @@
+#include "gguf_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+enum GgufType : std::uint32_t {
+  kUint8 = 0,
+  kInt8 = 1,
+  kUint16 = 2,
+  kInt16 = 3,
+  kUint32 = 4,
+  kInt32 = 5,
+  kFloat32 = 6,
+  kBool = 7,
+  kString = 8,
+  kArray = 9,
+  kUint64 = 10,
+  kInt64 = 11,
+  kFloat64 = 12,
+};
+
+// Upper bounds that keep a corrupt header from driving huge loops.
+constexpr std::uint64_t kMaxTensorDims = 8;
+constexpr std::uint64_t kMaxStringBytes = 1u << 20;
+
+// llama_ftype values stored in general.file_type.
+constexpr std::array<std::string_view, 33> kFileTypeNames = {
+    "F32",     "F16",    "Q4_0",   "Q4_1",   "Q4_1_SOME_F16", "Q4_2",   "Q4_3",
+    "Q8_0",    "Q5_0",   "Q5_1",   "Q2_K",   "Q3_K_S",        "Q3_K_M", "Q3_K_L",
+    "Q4_K_S",  "Q4_K_M", "Q5_K_S", "Q5_K_M", "Q6_K",          "IQ2_XXS", "IQ2_XS",
+    "Q2_K_S",  "IQ3_XS", "IQ3_XXS", "IQ1_S", "IQ4_NL",        "IQ3_S",  "IQ3_M",
+    "IQ2_S",   "IQ2_M",  "IQ4_XS", "IQ1_M",  "BF16",
+};
+
+// Bounds-checked little-endian cursor; any overrun latches `ok` to false and
+// yields zeros from then on.
+class Cursor {
+ public:
+  Cursor(const unsigned char *data, std::size_t size) : data_(data), size_(size) {}
+
+  bool ok() const { return ok_; }
+
+  template <typename T>
+  T read() {
+    T value{};
+    if (!take(sizeof(T))) {
+      return value;
+    }
+    std::memcpy(&value, data_ + pos_ - sizeof(T), sizeof(T));
+    return value;
+  }
+
+  std::string_view read_string() {
+    const auto len = read<std::uint64_t>();
+    if (len > kMaxStringBytes || !take(len)) {
+      ok_ = false;
+      return {};
+    }
+    return {reinterpret_cast<const char *>(data_ + pos_ - len), static_cast<std::size_t>(len)};
+  }
+
+  // Reads a scalar value of `type` as an unsigned integer (bools and signed
+  // values included); floats and strings are skipped and yield nullopt.
+  std::optional<std::uint64_t> read_integer(std::uint32_t type) {
+    switch (type) {
+      case kUint8:
+      case kInt8:
+      case kBool:
+        return read<std::uint8_t>();
+      case kUint16:
+      case kInt16:
+        return read<std::uint16_t>();
+      case kUint32:
+      case kInt32:
+        return read<std::uint32_t>();
+      case kUint64:
+      case kInt64:
+        return read<std::uint64_t>();
+      default:
+        skip_value(type);
+        return std::nullopt;
+    }
+  }
+
+  void skip_value(std::uint32_t type) {
+    switch (type) {
+      case kUint8:
+      case kInt8:
+      case kBool:
+        take(1);
+        break;
+      case kUint16:
+      case kInt16:
+        take(2);
+        break;
+      case kUint32:
+      case kInt32:
+      case kFloat32:
+        take(4);
+        break;
+      case kUint64:
+      case kInt64:
+      case kFloat64:
+        take(8);
+        break;
+      case kString:
+        read_string();
+        break;
+      case kArray: {
+        const auto element_type = read<std::uint32_t>();
+        const auto count = read<std::uint64_t>();
+        if (element_type == kArray) {
+          ok_ = false;  // Nested arrays do not occur in GGUF metadata
+          break;
+        }
+        for (std::uint64_t i = 0; i < count && ok_; ++i) {
+          skip_value(element_type);
+        }
+        break;
+      }
+      default:
+        ok_ = false;
+    }
+  }
+
+ private:
+  bool take(std::uint64_t n) {
+    if (!ok_ || n > size_ - pos_) {
+      ok_ = false;
+      return false;
+    }
+    pos_ += static_cast<std::size_t>(n);
+    return true;
+  }
+
+  const unsigned char *data_;
+  std::size_t size_;
+  std::size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+std::optional<GgufMetadata> parse(Cursor &in, std::string &error_message) {
+  if (in.read<std::uint32_t>() != 0x46554747u) {  // "GGUF", little-endian
+    error_message = "Not a GGUF file";
+    return std::nullopt;
+  }
+  GgufMetadata out;
+  out.version = in.read<std::uint32_t>();
+  if (out.version < 2 || out.version > 3) {
+    error_message = "Unsupported GGUF version " + std::to_string(out.version);
+    return std::nullopt;
+  }
+  out.tensor_count = in.read<std::uint64_t>();
+  const auto kv_count = in.read<std::uint64_t>();
+
+  // Architecture-scoped keys are matched once general.architecture is known;
+  // it is conventionally the first key, but collect them regardless of order.
+  struct ArchKey {
+    std::string suffix;
+    std::optional<std::uint64_t> GgufMetadata::*field;
+  };
+  const std::array<ArchKey, 5> arch_keys = {{
+      {".context_length", &GgufMetadata::context_length},
+      {".block_count", &GgufMetadata::block_count},
+      {".embedding_length", &GgufMetadata::embedding_length},
+      {".attention.head_count", &GgufMetadata::head_count},
+      {".attention.head_count_kv", &GgufMetadata::head_count_kv},
+  }};
+  std::array<std::pair<std::string, std::uint64_t>, 5> pending{};
+  std::optional<std::uint64_t> file_type;
+
+  for (std::uint64_t i = 0; i < kv_count && in.ok(); ++i) {
+    const auto key = in.read_string();
+    const auto type = in.read<std::uint32_t>();
+    if (key == "general.architecture" && type == kString) {
+      out.architecture = std::string(in.read_string());
+    } else if (key == "general.name" && type == kString) {
+      out.name = std::string(in.read_string());
+    } else if (key == "general.file_type") {
+      file_type = in.read_integer(type);
+    } else if (key == "tokenizer.ggml.tokens" && type == kArray) {
+      const auto element_type = in.read<std::uint32_t>();
+      const auto count = in.read<std::uint64_t>();
+      for (std::uint64_t t = 0; t < count && in.ok(); ++t) {
+        in.skip_value(element_type);
+      }
+      out.vocab_size = count;
+    } else {
+      bool matched = false;
+      for (std::size_t k = 0; k < arch_keys.size(); ++k) {
+        if (key.size() > arch_keys[k].suffix.size() && key.ends_with(arch_keys[k].suffix) &&
+            key.find('.') == key.size() - arch_keys[k].suffix.size()) {
+          if (const auto value = in.read_integer(type)) {
+            pending[k] = {std::string(key.substr(0, key.find('.'))), *value};
+          }
+          matched = true;
+          break;
+        }
+      }
+      if (!matched) {
+        in.skip_value(type);
+      }
+    }
+  }
+
+  std::uint64_t parameters = 0;
+  for (std::uint64_t t = 0; t < out.tensor_count && in.ok(); ++t) {
+    in.read_string();
+    const auto n_dims = in.read<std::uint32_t>();
+    if (n_dims > kMaxTensorDims) {
+      error_message = "Malformed GGUF tensor table";
+      return std::nullopt;
+    }
+    std::uint64_t elements = 1;
+    for (std::uint32_t d = 0; d < n_dims; ++d) {
+      elements *= in.read<std::uint64_t>();
+    }
+    in.read<std::uint32_t>();  // ggml type
+    in.read<std::uint64_t>();  // data offset
+    parameters += elements;
+  }
+
+  if (!in.ok()) {
+    error_message = "Truncated or malformed GGUF header";
+    return std::nullopt;
+  }
+
+  for (std::size_t k = 0; k < arch_keys.size(); ++k) {
+    if (!pending[k].first.empty() && pending[k].first == out.architecture) {
+      out.*(arch_keys[k].field) = pending[k].second;
+    }
+  }
+  if (file_type.has_value() && *file_type < kFileTypeNames.size()) {
+    out.quantization = std::string(kFileTypeNames[*file_type]);
+  }
+  if (out.tensor_count > 0) {
+    out.parameter_count = parameters;
+  }
+  return out;
+}
+
+}  // namespace
+
+std::optional<std::uint64_t> GgufMetadata::kv_bytes_per_token() const {
+  if (!block_count || !embedding_length || !head_count || *head_count == 0) {
+    return std::nullopt;
+  }
+  const auto kv_heads = head_count_kv.value_or(*head_count);
+  const auto kv_embedding = *embedding_length * kv_heads / *head_count;
+  // K and V, fp16 each.
+  return 2 * *block_count * kv_embedding * 2;
+}
+
+std::optional<GgufMetadata> read_gguf_metadata(const std::string &path,
+                                               std::string &error_message) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error_message = "Failed to open model file: " + std::string(std::strerror(errno));
+    return std::nullopt;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    error_message = "Model file is empty or unreadable";
+    return std::nullopt;
+  }
+  const auto size = static_cast<std::size_t>(st.st_size);
+  // Mapping is lazy, so only the pages the parser walks are read from disk.
+  void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    error_message = "Failed to map model file: " + std::string(std::strerror(errno));
+    return std::nullopt;
+  }
+  ::madvise(addr, size, MADV_RANDOM);
+
+  Cursor in(static_cast<const unsigned char *>(addr), size);
+  auto out = parse(in, error_message);
+  ::munmap(addr, size);
+  return out;
+}
+
+std::optional<GgufMetadata> read_gguf_metadata(const std::vector<std::string> &shard_paths,
+                                               std::string &error_message) {
+  if (shard_paths.empty()) {
+    error_message = "No model files";
+    return std::nullopt;
+  }
+  auto out = read_gguf_metadata(shard_paths.front(), error_message);
+  for (std::size_t i = 1; out && i < shard_paths.size(); ++i) {
+    const auto shard = read_gguf_metadata(shard_paths[i], error_message);
+    if (!shard) {
+      return std::nullopt;
+    }
+    out->tensor_count += shard->tensor_count;
+    if (shard->parameter_count) {
+      out->parameter_count = out->parameter_count.value_or(0) + *shard->parameter_count;
+    }
+  }
+  return out;
+}
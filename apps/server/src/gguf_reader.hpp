@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Model facts read from a GGUF header, without loading any weights.
+struct GgufMetadata {
+  std::uint32_t version = 0;
+  std::uint64_t tensor_count = 0;
+  std::string architecture;                  // general.architecture
+  std::optional<std::string> name;           // general.name
+  std::optional<std::string> quantization;   // general.file_type, e.g. "Q4_K_M"
+  std::optional<std::uint64_t> parameter_count;
+  std::optional<std::uint64_t> context_length;  // Trained context, <arch>.context_length
+  std::optional<std::uint64_t> block_count;
+  std::optional<std::uint64_t> embedding_length;
+  std::optional<std::uint64_t> head_count;
+  std::optional<std::uint64_t> head_count_kv;
+  std::optional<std::uint64_t> vocab_size;  // Entries in tokenizer.ggml.tokens
+
+  // fp16 K+V bytes per context token, when the shape keys are present.
+  std::optional<std::uint64_t> kv_bytes_per_token() const;
+};
+
+// Parses the header and tensor table of a GGUF (v2/v3) file through a
+// read-only mapping; only the header pages are faulted in. Returns
+// std::nullopt with `error_message` set for unreadable or malformed files.
+std::optional<GgufMetadata> read_gguf_metadata(const std::string &path,
+                                               std::string &error_message);
+
+// Metadata of a split model: the first shard's keys, with tensor and parameter
+// counts summed over every shard.
+std::optional<GgufMetadata> read_gguf_metadata(const std::vector<std::string> &shard_paths,
+                                               std::string &error_message);
@@ -8,11 +8,13 @@
 
 std::string now_rfc3339_utc() {
   using namespace std::chrono;
-  const auto now = system_clock::now();
-  const auto secs = floor<seconds>(now);
-  const auto ms = duration_cast<milliseconds>(now - secs).count();
+  return format_rfc3339_utc(
+      duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+}
 
-  std::time_t tt = system_clock::to_time_t(now);
+std::string format_rfc3339_utc(std::int64_t epoch_ms) {
+  const std::time_t tt = static_cast<std::time_t>(epoch_ms / 1000);
+  const auto ms = epoch_ms % 1000;
   std::tm utc_tm{};
 #if defined(_WIN32)
   gmtime_s(&utc_tm, &tt);
@@ -60,14 +62,47 @@ void write_json(const drogon::HttpRequestPtr &req,
   resp->setBody(Json::writeString(builder, json));
 }
 
-void write_error(const drogon::HttpRequestPtr &req,
-                 std::function<void(const drogon::HttpResponsePtr &)> &&cb,
-                 drogon::HttpStatusCode status,
-                 std::string code,
-                 std::string category,
-                 std::string message,
-                 bool retryable,
-                 const std::optional<Json::Value> &details) {
+void write_json_text(const drogon::HttpRequestPtr &req,
+                     const drogon::HttpResponsePtr &resp,
+                     const std::string &body,
+                     drogon::HttpStatusCode code) {
+  resp->setStatusCode(code);
+  resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+  resp->addHeader("X-Correlation-Id", resolve_correlation_id(req));
+  resp->setBody(body);
+}
+
+bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+  // Weak comparison (RFC 9110 13.1.2): the W/ prefix is ignored on both sides.
+  const auto strip_weak = [](std::string_view tag) {
+    return tag.substr(0, 2) == "W/" ? tag.substr(2) : tag;
+  };
+  etag = strip_weak(etag);
+  while (!if_none_match.empty()) {
+    const auto comma = if_none_match.find(',');
+    auto candidate = if_none_match.substr(0, comma);
+    if_none_match =
+        comma == std::string_view::npos ? std::string_view{} : if_none_match.substr(comma + 1);
+    while (!candidate.empty() && candidate.front() == ' ') {
+      candidate.remove_prefix(1);
+    }
+    while (!candidate.empty() && candidate.back() == ' ') {
+      candidate.remove_suffix(1);
+    }
+    if (candidate == "*" || (!candidate.empty() && strip_weak(candidate) == etag)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+drogon::HttpResponsePtr make_error_response(const drogon::HttpRequestPtr &req,
+                                            drogon::HttpStatusCode status,
+                                            std::string code,
+                                            std::string category,
+                                            std::string message,
+                                            bool retryable,
+                                            const std::optional<Json::Value> &details) {
   Json::Value payload(Json::objectValue);
   payload["code"] = std::move(code);
   payload["category"] = std::move(category);
@@ -83,5 +118,17 @@ void write_error(const drogon::HttpRequestPtr &req,
 
   auto resp = drogon::HttpResponse::newHttpResponse();
   write_json(req, resp, error, status);
-  cb(resp);
+  return resp;
+}
+
+void write_error(const drogon::HttpRequestPtr &req,
+                 std::function<void(const drogon::HttpResponsePtr &)> &&cb,
+                 drogon::HttpStatusCode status,
+                 std::string code,
+                 std::string category,
+                 std::string message,
+                 bool retryable,
+                 const std::optional<Json::Value> &details) {
+  cb(make_error_response(req, status, std::move(code), std::move(category), std::move(message),
+                         retryable, details));
 }
@@ -3,10 +3,13 @@
 #include <drogon/HttpTypes.h>
 #include <drogon/drogon.h>
 
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 
 std::string now_rfc3339_utc();
+std::string format_rfc3339_utc(std::int64_t epoch_ms);
 std::string generate_correlation_id();
 std::string resolve_correlation_id(const drogon::HttpRequestPtr &req);
 
@@ -15,6 +18,26 @@ void write_json(const drogon::HttpRequestPtr &req,
                 const Json::Value &json,
                 drogon::HttpStatusCode code = drogon::k200OK);
 
+// Like write_json, for a body that is already serialized.
+void write_json_text(const drogon::HttpRequestPtr &req,
+                     const drogon::HttpResponsePtr &resp,
+                     const std::string &body,
+                     drogon::HttpStatusCode code = drogon::k200OK);
+
+// Whether an If-None-Match header value matches `etag` ("*", a list, or a
+// weak W/ form all count).
+bool etag_matches(std::string_view if_none_match, std::string_view etag);
+
+// Builds the standard error envelope response without sending it, for callers
+// that need to attach extra headers (e.g. Retry-After).
+drogon::HttpResponsePtr make_error_response(const drogon::HttpRequestPtr &req,
+                                            drogon::HttpStatusCode status,
+                                            std::string code,
+                                            std::string category,
+                                            std::string message,
+                                            bool retryable,
+                                            const std::optional<Json::Value> &details = std::nullopt);
+
 void write_error(const drogon::HttpRequestPtr &req,
                  std::function<void(const drogon::HttpResponsePtr &)> &&cb,
                  drogon::HttpStatusCode status,
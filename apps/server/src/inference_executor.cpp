@@ -0,0 +1,105 @@
+#include "inference_executor.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include <trantor/utils/Logger.h>
+
+InferenceExecutor::InferenceExecutor(std::size_t worker_count) {
+  worker_count = std::max<std::size_t>(worker_count, 1);
+  workers_.reserve(worker_count);
+  for (std::size_t i = 0; i < worker_count; ++i) {
+    workers_.emplace_back([this]() { worker_loop(); });
+  }
+}
+
+InferenceExecutor::~InferenceExecutor() { shutdown(); }
+
+bool InferenceExecutor::submit(Job job, Job reject) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!stopping_) {
+      jobs_.push_back({std::move(job), std::move(reject)});
+      cv_.notify_one();
+      return true;
+    }
+  }
+  if (reject) {
+    reject();
+  }
+  return false;
+}
+
+void InferenceExecutor::close() {
+  std::deque<Entry> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+    dropped.swap(jobs_);
+  }
+  cv_.notify_all();
+
+  if (!dropped.empty()) {
+    LOG_WARN << "Rejecting " << dropped.size() << " queued inference job(s) on shutdown";
+  }
+  // Outside mu_: rejecting answers the job's client.
+  for (auto &entry : dropped) {
+    if (entry.reject) {
+      entry.reject();
+    }
+  }
+}
+
+bool InferenceExecutor::wait_idle(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mu_);
+  return idle_cv_.wait_for(lock, timeout, [this]() { return running_ == 0 && jobs_.empty(); });
+}
+
+void InferenceExecutor::shutdown() {
+  close();
+  std::size_t running = 0;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    running = running_;
+  }
+  if (running > 0) {
+    LOG_INFO << "Waiting for " << running << " running inference job(s) to finish...";
+  }
+
+  for (auto &worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  workers_.clear();
+}
+
+void InferenceExecutor::worker_loop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      job = std::move(jobs_.front().job);
+      jobs_.pop_front();
+      ++running_;
+    }
+
+    try {
+      job();
+    } catch (const std::exception &e) {
+      LOG_ERROR << "Inference job threw: " << e.what();
+    } catch (...) {
+      LOG_ERROR << "Inference job threw an unknown exception";
+    }
+    job = nullptr;
+
+    std::lock_guard<std::mutex> lock(mu_);
+    if (--running_ == 0) {
+      idle_cv_.notify_all();
+    }
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool that runs model work off the Drogon event loops.
+// Jobs are executed in FIFO order; completion is reported by the job itself
+// (typically by invoking a Drogon response callback from the worker thread).
+// A job that will never run has its reject callback invoked instead, so its
+// client still gets an answer.
+class InferenceExecutor {
+ public:
+  using Job = std::function<void()>;
+
+  explicit InferenceExecutor(std::size_t worker_count);
+  ~InferenceExecutor();
+
+  InferenceExecutor(const InferenceExecutor &) = delete;
+  InferenceExecutor &operator=(const InferenceExecutor &) = delete;
+
+  // Queues a job. Once close() has been called the job is refused: `reject`
+  // runs on the calling thread and false is returned.
+  bool submit(Job job, Job reject = {});
+
+  // Stops accepting jobs and rejects the ones that have not started yet.
+  // Does not wait for running jobs. Safe to call more than once.
+  void close();
+
+  // Waits up to `timeout` for the running jobs to return; false if some still
+  // run. Meant for after close(), when no new job can start.
+  bool wait_idle(std::chrono::milliseconds timeout);
+
+  // close(), then joins the workers once the running jobs return. Safe to
+  // call more than once.
+  void shutdown();
+
+  std::size_t worker_count() const { return workers_.size(); }
+
+ private:
+  struct Entry {
+    Job job;
+    Job reject;
+  };
+
+  void worker_loop();
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::condition_variable idle_cv_;  // Signalled when running_ drops to 0
+  std::deque<Entry> jobs_;
+  std::vector<std::thread> workers_;
+  std::size_t running_ = 0;
+  bool stopping_ = false;
+};
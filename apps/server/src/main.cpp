@@ -1,5 +1,7 @@
 #include <drogon/drogon.h>
 #include <json/json.h>
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <filesystem>
 #include <string>
@@ -49,6 +51,109 @@ RuntimeConfig load_config(const std::string& config_path, int& port, std::string
         config.model_discovery_paths.push_back(path.asString());
       }
     }
+    if (runtime.isMember("discovery") && runtime["discovery"].isObject()) {
+      const auto& discovery = runtime["discovery"];
+      if (discovery["max_depth"].isInt()) {
+        config.discovery.max_depth = std::max(discovery["max_depth"].asInt(), 0);
+      }
+      if (discovery["workers"].isInt()) {
+        config.discovery.workers = std::max(discovery["workers"].asInt(), 1);
+      }
+      for (const auto& glob : discovery["include"]) {
+        if (glob.isString()) {
+          config.discovery.include_globs.push_back(glob.asString());
+        }
+      }
+      for (const auto& glob : discovery["exclude"]) {
+        if (glob.isString()) {
+          config.discovery.exclude_globs.push_back(glob.asString());
+        }
+      }
+    }
+    if (runtime.isMember("inference_workers") && runtime["inference_workers"].isInt()) {
+      config.inference_workers = std::max(runtime["inference_workers"].asInt(), 1);
+    }
+    if (runtime.isMember("max_queued_requests") && runtime["max_queued_requests"].isInt()) {
+      config.max_queued_requests = std::max(runtime["max_queued_requests"].asInt(), 0);
+    }
+    if (runtime.isMember("parallel_sequences") && runtime["parallel_sequences"].isInt()) {
+      config.parallel_sequences = std::max(runtime["parallel_sequences"].asInt(), 1);
+    }
+    if (runtime.isMember("max_resident_bytes") && runtime["max_resident_bytes"].isUInt64()) {
+      config.max_resident_bytes = runtime["max_resident_bytes"].asUInt64();
+    }
+    if (runtime.isMember("load_options") && runtime["load_options"].isObject()) {
+      const auto& options = runtime["load_options"];
+      if (options["prefetch"].isString()) {
+        if (const auto mode = parse_prefetch_mode(options["prefetch"].asString())) {
+          config.default_load_options.prefetch = *mode;
+        } else {
+          LOG_WARN << "Ignoring unknown runtime.load_options.prefetch value";
+        }
+      }
+      if (options["mlock"].isBool()) {
+        config.default_load_options.mlock = options["mlock"].asBool();
+      }
+    }
+    if (runtime.isMember("preload_models") && runtime["preload_models"].isArray()) {
+      for (const auto& entry : runtime["preload_models"]) {
+        if (entry.isString()) {
+          config.preload_models.push_back({entry.asString(), std::nullopt});
+        } else if (entry.isObject() && entry["model_id"].isString()) {
+          PreloadModel preload{entry["model_id"].asString(), std::nullopt};
+          if (entry["context_size"].isInt() && entry["context_size"].asInt() > 0) {
+            preload.context_size = entry["context_size"].asInt();
+          }
+          config.preload_models.push_back(std::move(preload));
+        }
+      }
+    }
+    if (runtime.isMember("stream_flush_interval_ms") &&
+        runtime["stream_flush_interval_ms"].isInt()) {
+      config.stream_flush.max_delay =
+          std::chrono::milliseconds(std::max(runtime["stream_flush_interval_ms"].asInt(), 0));
+    }
+    if (runtime.isMember("stream_flush_bytes") && runtime["stream_flush_bytes"].isInt()) {
+      config.stream_flush.max_bytes =
+          static_cast<std::size_t>(std::max(runtime["stream_flush_bytes"].asInt(), 1));
+    }
+    if (runtime.isMember("stream_buffer_kb") && runtime["stream_buffer_kb"].isInt()) {
+      config.stream_buffer_bytes =
+          static_cast<std::size_t>(std::max(runtime["stream_buffer_kb"].asInt(), 1)) * 1024;
+    }
+    if (runtime.isMember("stream_log_kb") && runtime["stream_log_kb"].isInt()) {
+      config.stream_log_bytes =
+          static_cast<std::size_t>(std::max(runtime["stream_log_kb"].asInt(), 1)) * 1024;
+    }
+    if (runtime.isMember("stream_resume_window_ms") &&
+        runtime["stream_resume_window_ms"].isInt()) {
+      config.stream_resume_window =
+          std::chrono::milliseconds(std::max(runtime["stream_resume_window_ms"].asInt(), 0));
+    }
+    if (runtime.isMember("completion_cache_kb") && runtime["completion_cache_kb"].isInt()) {
+      config.completion_cache_bytes =
+          static_cast<std::size_t>(std::max(runtime["completion_cache_kb"].asInt(), 0)) * 1024;
+    }
+    if (runtime.isMember("ws_heartbeat_interval_ms") &&
+        runtime["ws_heartbeat_interval_ms"].isInt()) {
+      config.ws_heartbeat_interval =
+          std::chrono::milliseconds(std::max(runtime["ws_heartbeat_interval_ms"].asInt(), 0));
+    }
+    if (runtime.isMember("warmup_prompt") && runtime["warmup_prompt"].isString()) {
+      config.warmup_prompt = runtime["warmup_prompt"].asString();
+    }
+    if (runtime.isMember("state_path") && runtime["state_path"].isString()) {
+      config.state_path = runtime["state_path"].asString();
+    }
+    if (runtime.isMember("registry_index_path") && runtime["registry_index_path"].isString()) {
+      config.registry_index_path = runtime["registry_index_path"].asString();
+    }
+    if (runtime.isMember("watch_model_paths") && runtime["watch_model_paths"].isBool()) {
+      config.watch_model_paths = runtime["watch_model_paths"].asBool();
+    }
+    if (runtime.isMember("sessions_dir") && runtime["sessions_dir"].isString()) {
+      config.sessions_dir = runtime["sessions_dir"].asString();
+    }
   }
 
   if (root.isMember("observability") && root["observability"].isMember("log_level")) {
@@ -98,6 +203,7 @@ int main() {
   RuntimeConfig config = load_config("config/app.json", port, host, log_level);
 
   static RuntimeState runtime_state(config);
+  static StreamHubRegistry stream_hubs(config.stream_log_bytes, config.stream_resume_window);
 
   const fs::path web_root = fs::path(PETTING_ZOO_WEB_ROOT);
   const fs::path index_html = web_root / "index.html";
@@ -105,9 +211,11 @@ int main() {
   drogon::app().setLogLevel(log_level);
   drogon::app().setDocumentRoot(web_root.string());
 
-  register_health_routes();
+  register_health_routes(runtime_state);
   register_model_routes(runtime_state);
-  register_chat_routes(runtime_state);
+  register_chat_routes(runtime_state, stream_hubs);
+  register_chat_socket(runtime_state, stream_hubs);
+  register_session_routes(runtime_state);
   register_mcp_routes(runtime_state);
   register_deferred_routes();
   register_spa_routes(web_root, index_html);
@@ -159,11 +267,27 @@ int main() {
     }
   });
 
+  // Answer queued chats before the event loops stop, then quit as Drogon's
+  // default handlers do. The handler runs in signal context, so it only
+  // queues the work onto the main loop.
+  const auto stop = []() {
+    drogon::app().getLoop()->queueInLoop([]() {
+      LOG_INFO << "Shutdown requested, rejecting queued chat requests";
+      runtime_state.stop_accepting();
+      drogon::app().quit();
+    });
+  };
+  drogon::app().setTermSignalHandler(stop);
+  drogon::app().setIntSignalHandler(stop);
+
   drogon::app().addListener(host, port);
   drogon::app().run();
 
   LOG_INFO << "Server stopping, waiting for background tasks...";
-  shutdown_chat_routes();
+  if (!runtime_state.shutdown()) {
+    // Static destructors would join the stuck workers.
+    std::quick_exit(EXIT_FAILURE);
+  }
   LOG_INFO << "Server stopped.";
 
   return 0;
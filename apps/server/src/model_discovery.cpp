@@ -0,0 +1,306 @@
+#include "model_discovery.hpp"
+
+#include <fnmatch.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <regex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+bool matches_any(const std::vector<std::string> &globs, const std::string &relative) {
+  return std::any_of(globs.begin(), globs.end(), [&](const std::string &glob) {
+    return ::fnmatch(glob.c_str(), relative.c_str(), 0) == 0;
+  });
+}
+
+bool accepts_file(const DiscoveryOptions &options, const std::string &relative) {
+  if (matches_any(options.exclude_globs, relative)) {
+    return false;
+  }
+  return options.include_globs.empty() || matches_any(options.include_globs, relative);
+}
+
+std::int64_t to_ns(fs::file_time_type time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+struct FoundFile {
+  std::string path;
+  std::uintmax_t size_bytes = 0;
+  std::int64_t mtime_ns = 0;
+};
+
+struct DirTask {
+  fs::path dir;
+  fs::path root;
+  int depth = 0;
+};
+
+// Shared state of one parallel walk.
+class Walk {
+ public:
+  explicit Walk(const DiscoveryOptions &options) : options_(options) {}
+
+  void push(DirTask task) {
+    std::lock_guard<std::mutex> lock(mu_);
+    queue_.push_back(std::move(task));
+    cv_.notify_one();
+  }
+
+  void run_worker() {
+    while (true) {
+      DirTask task;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return !queue_.empty() || busy_ == 0; });
+        if (queue_.empty()) {
+          cv_.notify_all();  // Walk finished; release the other workers
+          return;
+        }
+        task = std::move(queue_.front());
+        queue_.pop_front();
+        ++busy_;
+      }
+      list(task);
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        --busy_;
+      }
+      cv_.notify_all();
+    }
+  }
+
+  std::vector<FoundFile> files;
+  std::vector<std::string> directories;
+  std::vector<std::string> warnings;
+
+ private:
+  void list(const DirTask &task) {
+    std::vector<FoundFile> found;
+    std::vector<DirTask> subdirs;
+    std::error_code ec;
+    fs::directory_iterator it(task.dir, ec);
+    if (ec) {
+      std::lock_guard<std::mutex> lock(mu_);
+      warnings.push_back("Cannot list " + task.dir.string() + ": " + ec.message());
+      return;
+    }
+    for (const fs::directory_iterator end; it != end; it.increment(ec)) {
+      if (ec) {
+        break;
+      }
+      const auto &entry = *it;
+      std::error_code entry_ec;
+      const auto relative = entry.path().lexically_relative(task.root).string();
+      if (entry.is_directory(entry_ec) && !entry.is_symlink(entry_ec)) {
+        if (task.depth < options_.max_depth && !matches_any(options_.exclude_globs, relative)) {
+          subdirs.push_back({entry.path(), task.root, task.depth + 1});
+        }
+        continue;
+      }
+      if (entry.path().extension() != ".gguf" || !entry.is_regular_file(entry_ec) ||
+          !accepts_file(options_, relative)) {
+        continue;
+      }
+      FoundFile file;
+      file.path = entry.path().string();
+      file.size_bytes = entry.file_size(entry_ec);
+      file.mtime_ns = to_ns(entry.last_write_time(entry_ec));
+      if (!entry_ec) {
+        found.push_back(std::move(file));
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mu_);
+    directories.push_back(task.dir.string());
+    std::move(found.begin(), found.end(), std::back_inserter(files));
+    for (auto &subdir : subdirs) {
+      queue_.push_back(std::move(subdir));
+    }
+  }
+
+  const DiscoveryOptions &options_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<DirTask> queue_;
+  int busy_ = 0;
+};
+
+// Folds split sets into one model each; incomplete sets are left out.
+std::vector<DiscoveredModel> group_shards(std::vector<FoundFile> files,
+                                          std::vector<std::string> &warnings) {
+  std::vector<DiscoveredModel> models;
+  std::map<std::pair<std::string, int>, std::map<int, FoundFile>> sets;
+  for (auto &file : files) {
+    if (const auto shard = parse_shard_name(file.path)) {
+      sets[{shard->base, shard->count}][shard->index] = std::move(file);
+      continue;
+    }
+    DiscoveredModel model;
+    model.path = std::move(file.path);
+    model.size_bytes = file.size_bytes;
+    model.mtime_ns = file.mtime_ns;
+    models.push_back(std::move(model));
+  }
+  for (auto &[key, shards] : sets) {
+    const auto &[base, count] = key;
+    if (static_cast<int>(shards.size()) != count) {
+      warnings.push_back("Skipping split model " + base + ": " + std::to_string(shards.size()) +
+                         " of " + std::to_string(count) + " shards present");
+      continue;
+    }
+    DiscoveredModel model;
+    for (auto &[index, file] : shards) {
+      model.size_bytes += file.size_bytes;
+      model.mtime_ns = std::max(model.mtime_ns, file.mtime_ns);
+      model.shard_paths.push_back(std::move(file.path));
+    }
+    model.path = model.shard_paths.front();
+    models.push_back(std::move(model));
+  }
+  std::sort(models.begin(), models.end(),
+            [](const DiscoveredModel &a, const DiscoveredModel &b) { return a.path < b.path; });
+  return models;
+}
+
+}  // namespace
+
+std::optional<GgufShardName> parse_shard_name(const std::string &path) {
+  static const std::regex kShardPattern(R"((.+)-(\d{5})-of-(\d{5})\.gguf)");
+  std::smatch match;
+  if (!std::regex_match(path, match, kShardPattern)) {
+    return std::nullopt;
+  }
+  GgufShardName name;
+  name.base = match[1].str();
+  name.index = std::stoi(match[2].str());
+  name.count = std::stoi(match[3].str());
+  if (name.index < 1 || name.count < 1 || name.index > name.count) {
+    return std::nullopt;
+  }
+  return name;
+}
+
+DiscoveryResult discover_models(const std::vector<std::string> &roots,
+                                const DiscoveryOptions &options) {
+  Walk walk(options);
+  for (const auto &root : roots) {
+    std::error_code ec;
+    if (fs::is_directory(root, ec)) {
+      walk.push({fs::path(root), fs::path(root), 0});
+    }
+  }
+
+  const auto worker_count = static_cast<std::size_t>(std::max(options.workers, 1));
+  std::vector<std::thread> helpers;
+  helpers.reserve(worker_count - 1);
+  for (std::size_t i = 1; i < worker_count; ++i) {
+    helpers.emplace_back([&walk] { walk.run_worker(); });
+  }
+  walk.run_worker();
+  for (auto &helper : helpers) {
+    helper.join();
+  }
+
+  // Overlapping roots list the same files twice.
+  std::sort(walk.files.begin(), walk.files.end(),
+            [](const FoundFile &a, const FoundFile &b) { return a.path < b.path; });
+  walk.files.erase(std::unique(walk.files.begin(), walk.files.end(),
+                               [](const FoundFile &a, const FoundFile &b) {
+                                 return a.path == b.path;
+                               }),
+                   walk.files.end());
+
+  DiscoveryResult result;
+  result.warnings = std::move(walk.warnings);
+  result.models = group_shards(std::move(walk.files), result.warnings);
+  result.directories = std::move(walk.directories);
+  std::sort(result.directories.begin(), result.directories.end());
+  result.directories.erase(std::unique(result.directories.begin(), result.directories.end()),
+                           result.directories.end());
+  return result;
+}
+
+bool is_discoverable(const std::string &path, const std::vector<std::string> &roots,
+                     const DiscoveryOptions &options) {
+  if (fs::path(path).extension() != ".gguf") {
+    return false;
+  }
+  const auto abs_path = fs::absolute(fs::path(path)).lexically_normal();
+  for (const auto &root : roots) {
+    const auto relative =
+        abs_path.lexically_relative(fs::absolute(fs::path(root)).lexically_normal());
+    if (relative.empty() || *relative.begin() == "..") {
+      continue;
+    }
+    // Components below the root, excluding the file name itself.
+    const auto depth = std::distance(relative.begin(), relative.end()) - 1;
+    if (depth > options.max_depth) {
+      continue;
+    }
+    bool excluded_dir = false;
+    fs::path prefix;
+    for (auto part = relative.begin(); part != relative.end(); ++part) {
+      if (std::next(part) == relative.end()) {
+        break;
+      }
+      prefix /= *part;
+      excluded_dir = excluded_dir || matches_any(options.exclude_globs, prefix.string());
+    }
+    if (!excluded_dir && accepts_file(options, relative.string())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::optional<DiscoveredModel> find_shard_set(const std::string &path,
+                                              std::string &error_message) {
+  const auto shard = parse_shard_name(path);
+  if (!shard.has_value() || shard->index != 1) {
+    error_message = "Split models must be registered by their first shard";
+    return std::nullopt;
+  }
+  DiscoveredModel model;
+  for (int index = 1; index <= shard->count; ++index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "-%05d-of-%05d.gguf", index, shard->count);
+    model.shard_paths.push_back(shard->base + suffix);
+  }
+  if (!stat_model_files(model.shard_paths, model.size_bytes, model.mtime_ns)) {
+    error_message = "Split model is incomplete: expected " + std::to_string(shard->count) +
+                    " shards next to " + path;
+    return std::nullopt;
+  }
+  model.path = path;
+  return model;
+}
+
+bool stat_model_files(const std::vector<std::string> &files, std::uintmax_t &size_bytes,
+                      std::int64_t &mtime_ns) {
+  size_bytes = 0;
+  mtime_ns = 0;
+  for (const auto &file : files) {
+    std::error_code ec;
+    if (!fs::is_regular_file(file, ec)) {
+      return false;
+    }
+    size_bytes += fs::file_size(file, ec);
+    const auto time = fs::last_write_time(file, ec);
+    if (ec) {
+      return false;
+    }
+    mtime_ns = std::max(mtime_ns, to_ns(time));
+  }
+  return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct DiscoveryOptions {
+  // Directory levels below each discovery path to descend; 0 scans only the
+  // top level.
+  int max_depth = 4;
+  // fnmatch() globs over the path relative to its discovery root, where `*`
+  // also matches '/'. An empty include list accepts every .gguf file;
+  // exclude globs apply to files and directories alike.
+  std::vector<std::string> include_globs;
+  std::vector<std::string> exclude_globs;
+  // Directories listed concurrently.
+  int workers = 4;
+};
+
+// The "<base>-00001-of-00003.gguf" naming of split (sharded) GGUF sets.
+struct GgufShardName {
+  std::string base;  // Path without the -NNNNN-of-NNNNN.gguf suffix
+  int index = 0;     // 1-based
+  int count = 0;
+};
+
+std::optional<GgufShardName> parse_shard_name(const std::string &path);
+
+// One logical model on disk; the shards of a split set are grouped.
+struct DiscoveredModel {
+  std::string path;                     // The file, or the first shard
+  std::vector<std::string> shard_paths;  // Every shard in order; empty if not split
+  std::uintmax_t size_bytes = 0;        // Summed over shards
+  std::int64_t mtime_ns = 0;            // Latest over shards
+};
+
+struct DiscoveryResult {
+  std::vector<DiscoveredModel> models;  // Sorted by path
+  std::vector<std::string> directories;  // Every directory walked
+  std::vector<std::string> warnings;    // Unreadable directories, incomplete sets
+};
+
+// Walks `roots` breadth-first across a small thread pool. Directory symlinks
+// are not followed, so link cycles cannot trap the walk.
+DiscoveryResult discover_models(const std::vector<std::string> &roots,
+                                const DiscoveryOptions &options);
+
+// Whether a walk would pick up the file at `path` (depth and globs).
+bool is_discoverable(const std::string &path, const std::vector<std::string> &roots,
+                     const DiscoveryOptions &options);
+
+// Collects the split set `path` belongs to from its directory. Returns
+// std::nullopt with `error_message` set if `path` is not the first shard or
+// the set is incomplete.
+std::optional<DiscoveredModel> find_shard_set(const std::string &path,
+                                              std::string &error_message);
+
+// Summed size and latest mtime of `files`; false if any is missing.
+bool stat_model_files(const std::vector<std::string> &files, std::uintmax_t &size_bytes,
+                      std::int64_t &mtime_ns);
@@ -0,0 +1,329 @@
+#include "model_index.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <json/json.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bumped when the on-disk layout changes; other versions are rebuilt.
+constexpr int kIndexVersion = 1;
+
+void put_optional(Json::Value &out, const char *key, const std::optional<std::uint64_t> &value) {
+  if (value.has_value()) {
+    out[key] = static_cast<Json::UInt64>(*value);
+  }
+}
+
+std::optional<std::uint64_t> get_optional(const Json::Value &in, const char *key) {
+  if (in[key].isUInt64()) {
+    return in[key].asUInt64();
+  }
+  return std::nullopt;
+}
+
+Json::Value metadata_to_json(const GgufMetadata &meta) {
+  Json::Value out(Json::objectValue);
+  out["version"] = meta.version;
+  out["tensor_count"] = static_cast<Json::UInt64>(meta.tensor_count);
+  out["architecture"] = meta.architecture;
+  if (meta.name.has_value()) {
+    out["name"] = *meta.name;
+  }
+  if (meta.quantization.has_value()) {
+    out["quantization"] = *meta.quantization;
+  }
+  put_optional(out, "parameter_count", meta.parameter_count);
+  put_optional(out, "context_length", meta.context_length);
+  put_optional(out, "block_count", meta.block_count);
+  put_optional(out, "embedding_length", meta.embedding_length);
+  put_optional(out, "head_count", meta.head_count);
+  put_optional(out, "head_count_kv", meta.head_count_kv);
+  put_optional(out, "vocab_size", meta.vocab_size);
+  return out;
+}
+
+GgufMetadata metadata_from_json(const Json::Value &in) {
+  GgufMetadata meta;
+  meta.version = in["version"].asUInt();
+  meta.tensor_count = in["tensor_count"].asUInt64();
+  meta.architecture = in["architecture"].asString();
+  if (in["name"].isString()) {
+    meta.name = in["name"].asString();
+  }
+  if (in["quantization"].isString()) {
+    meta.quantization = in["quantization"].asString();
+  }
+  meta.parameter_count = get_optional(in, "parameter_count");
+  meta.context_length = get_optional(in, "context_length");
+  meta.block_count = get_optional(in, "block_count");
+  meta.embedding_length = get_optional(in, "embedding_length");
+  meta.head_count = get_optional(in, "head_count");
+  meta.head_count_kv = get_optional(in, "head_count_kv");
+  meta.vocab_size = get_optional(in, "vocab_size");
+  return meta;
+}
+
+Json::Value entry_to_json(const ModelIndexEntry &entry) {
+  Json::Value out(Json::objectValue);
+  out["id"] = entry.id;
+  out["display_name"] = entry.display_name;
+  out["path"] = entry.path;
+  out["file_size_bytes"] = static_cast<Json::UInt64>(entry.file_size_bytes);
+  out["mtime_ns"] = static_cast<Json::Int64>(entry.mtime_ns);
+  out["registered"] = entry.registered;
+  if (!entry.shard_paths.empty()) {
+    Json::Value shards(Json::arrayValue);
+    for (const auto &shard : entry.shard_paths) {
+      shards.append(shard);
+    }
+    out["shard_paths"] = shards;
+  }
+  Json::Value load_options(Json::objectValue);
+  load_options["prefetch"] = std::string(prefetch_mode_name(entry.load_options.prefetch));
+  load_options["mlock"] = entry.load_options.mlock;
+  out["load_options"] = load_options;
+  if (entry.metadata.has_value()) {
+    out["metadata"] = metadata_to_json(*entry.metadata);
+  }
+  return out;
+}
+
+std::optional<ModelIndexEntry> entry_from_json(const Json::Value &in) {
+  if (!in.isObject() || !in["id"].isString() || !in["path"].isString() ||
+      !in["file_size_bytes"].isUInt64() || !in["mtime_ns"].isInt64()) {
+    return std::nullopt;
+  }
+  ModelIndexEntry entry;
+  entry.id = in["id"].asString();
+  entry.path = in["path"].asString();
+  entry.display_name = in["display_name"].isString()
+                           ? in["display_name"].asString()
+                           : fs::path(entry.path).filename().string();
+  entry.file_size_bytes = in["file_size_bytes"].asUInt64();
+  entry.mtime_ns = in["mtime_ns"].asInt64();
+  entry.registered = in["registered"].asBool();
+  for (const auto &shard : in["shard_paths"]) {
+    if (shard.isString()) {
+      entry.shard_paths.push_back(shard.asString());
+    }
+  }
+  const auto &load_options = in["load_options"];
+  if (load_options.isObject()) {
+    if (const auto mode = parse_prefetch_mode(load_options["prefetch"].asString())) {
+      entry.load_options.prefetch = *mode;
+    }
+    entry.load_options.mlock = load_options["mlock"].asBool();
+  }
+  if (in["metadata"].isObject()) {
+    entry.metadata = metadata_from_json(in["metadata"]);
+  }
+  return entry;
+}
+
+void read_header(ModelIndexEntry &entry, ModelIndexScan &scan) {
+  std::string error_message;
+  entry.metadata = read_gguf_metadata(model_files(entry), error_message);
+  if (!entry.metadata) {
+    scan.warnings.push_back("Could not read GGUF metadata from " + entry.path + ": " +
+                            error_message);
+  }
+  ++scan.reparsed;
+}
+
+}  // namespace
+
+std::optional<std::vector<ModelIndexEntry>> load_model_index(const std::string &path,
+                                                             std::string &error_message) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return std::vector<ModelIndexEntry>{};
+  }
+  Json::Value root;
+  Json::Reader reader;
+  if (!reader.parse(file, root, false) || !root.isObject() || !root["models"].isArray()) {
+    error_message = "Model index is not valid JSON";
+    return std::nullopt;
+  }
+  if (root["version"].asInt() != kIndexVersion) {
+    error_message = "Unsupported model index version";
+    return std::nullopt;
+  }
+  std::vector<ModelIndexEntry> entries;
+  std::unordered_set<std::string> ids;
+  for (const auto &item : root["models"]) {
+    auto entry = entry_from_json(item);
+    if (entry.has_value() && ids.insert(entry->id).second) {
+      entries.push_back(std::move(*entry));
+    }
+  }
+  return entries;
+}
+
+bool save_model_index(const std::string &path, const std::vector<ModelIndexEntry> &entries,
+                      std::string &error_message) {
+  Json::Value root(Json::objectValue);
+  root["version"] = kIndexVersion;
+  root["models"] = Json::Value(Json::arrayValue);
+  for (const auto &entry : entries) {
+    root["models"].append(entry_to_json(entry));
+  }
+
+  // Write-then-rename so a crash never leaves a truncated index behind.
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    if (!out.is_open()) {
+      error_message = "Failed to open " + tmp_path;
+      return false;
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    out << Json::writeString(builder, root);
+  }
+  std::error_code ec;
+  fs::rename(tmp_path, path, ec);
+  if (ec) {
+    error_message = ec.message();
+    return false;
+  }
+  return true;
+}
+
+ModelIndexScan rescan_model_index(std::vector<ModelIndexEntry> indexed,
+                                  const std::vector<std::string> &discovery_paths,
+                                  const DiscoveryOptions &discovery,
+                                  const ModelLoadOptions &default_load_options) {
+  ModelIndexScan scan;
+  auto found = discover_models(discovery_paths, discovery);
+  scan.warnings = std::move(found.warnings);
+  scan.directories = std::move(found.directories);
+
+  std::unordered_map<std::string, DiscoveredModel *> on_disk;
+  for (auto &model : found.models) {
+    on_disk.emplace(model_path_key(model.path), &model);
+  }
+  std::unordered_set<std::string> ids;
+
+  for (auto &entry : indexed) {
+    if (!is_within_model_dirs(entry.path, discovery_paths)) {
+      ++scan.dropped;
+      continue;
+    }
+    std::uintmax_t size = 0;
+    std::int64_t mtime = 0;
+    if (const auto it = on_disk.find(model_path_key(entry.path)); it != on_disk.end()) {
+      size = it->second->size_bytes;
+      mtime = it->second->mtime_ns;
+      entry.shard_paths = it->second->shard_paths;
+      on_disk.erase(it);
+      entry.missing = false;
+    } else if (entry.registered) {
+      // Registered files may sit outside the walk's depth or globs.
+      entry.missing = !stat_model_files(model_files(entry), size, mtime);
+    } else {
+      ++scan.dropped;
+      continue;
+    }
+    if (entry.missing || (size == entry.file_size_bytes && mtime == entry.mtime_ns)) {
+      ++scan.reused;
+    } else {
+      entry.file_size_bytes = size;
+      entry.mtime_ns = mtime;
+      read_header(entry, scan);
+    }
+    ids.insert(entry.id);
+    scan.entries.push_back(std::move(entry));
+  }
+
+  const auto is_taken = [&ids](const std::string &id) { return ids.contains(id); };
+  for (auto &model : found.models) {
+    if (!on_disk.contains(model_path_key(model.path))) {
+      continue;  // Already indexed
+    }
+    const auto name = logical_model_path(model.path);
+    ModelIndexEntry entry;
+    entry.id = allocate_model_id(name, is_taken);
+    entry.display_name = fs::path(name).filename().string();
+    entry.path = std::move(model.path);
+    entry.shard_paths = std::move(model.shard_paths);
+    entry.file_size_bytes = model.size_bytes;
+    entry.mtime_ns = model.mtime_ns;
+    entry.load_options = default_load_options;
+    read_header(entry, scan);
+    ids.insert(entry.id);
+    scan.entries.push_back(std::move(entry));
+  }
+  return scan;
+}
+
+std::vector<std::string> model_files(const ModelIndexEntry &entry) {
+  return entry.shard_paths.empty() ? std::vector<std::string>{entry.path} : entry.shard_paths;
+}
+
+std::string logical_model_path(const std::string &path) {
+  if (const auto shard = parse_shard_name(path)) {
+    return shard->base + ".gguf";
+  }
+  return path;
+}
+
+bool is_within_model_dirs(const std::string &path, const std::vector<std::string> &dirs) {
+  const auto abs_path = fs::absolute(fs::path(path)).lexically_normal();
+  for (const auto &dir : dirs) {
+    const auto abs_dir = fs::absolute(fs::path(dir)).lexically_normal();
+    const auto relative = abs_path.lexically_relative(abs_dir);
+    if (!relative.empty() && *relative.begin() != "..") {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string model_path_key(const std::string &path) {
+  return fs::absolute(fs::path(path)).lexically_normal().string();
+}
+
+std::int64_t model_file_mtime_ns(const std::string &path) {
+  std::error_code ec;
+  const auto time = fs::last_write_time(path, ec);
+  if (ec) {
+    return 0;
+  }
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+std::string sanitize_model_id(std::string input) {
+  for (char &ch : input) {
+    const auto uch = static_cast<unsigned char>(ch);
+    if (std::isalnum(uch)) {
+      ch = static_cast<char>(std::tolower(uch));
+    } else {
+      ch = '-';
+    }
+  }
+
+  const auto first = input.find_first_not_of('-');
+  if (first == std::string::npos) {
+    return "model";
+  }
+  const auto last = input.find_last_not_of('-');
+  return input.substr(first, last - first + 1);
+}
+
+std::string allocate_model_id(const std::string &path,
+                              const std::function<bool(const std::string &)> &is_taken) {
+  const std::string base = sanitize_model_id(fs::path(path).stem().string());
+  std::string id = base;
+  for (int suffix = 2; is_taken(id); ++suffix) {
+    id = base + "-" + std::to_string(suffix);
+  }
+  return id;
+}
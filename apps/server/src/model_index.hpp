@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gguf_reader.hpp"
+#include "model_discovery.hpp"
+#include "model_memory.hpp"
+
+// One model as recorded in the persisted registry index.
+struct ModelIndexEntry {
+  std::string id;
+  std::string display_name;
+  std::string path;  // The file, or the first shard of a split model
+  std::vector<std::string> shard_paths;  // Every shard in order; empty if not split
+  std::uintmax_t file_size_bytes = 0;    // Summed over shards
+  std::int64_t mtime_ns = 0;             // Latest over shards
+  // Registered through the API rather than found by discovery; kept while its
+  // file is missing so it comes back under the same id.
+  bool registered = false;
+  ModelLoadOptions load_options;
+  std::optional<GgufMetadata> metadata;
+  // Set by rescan_model_index for registered files that are gone; not persisted.
+  bool missing = false;
+};
+
+// Reads the index at `path`. A missing file yields an empty index; an
+// unreadable or malformed one yields std::nullopt with `error_message` set.
+std::optional<std::vector<ModelIndexEntry>> load_model_index(const std::string &path,
+                                                             std::string &error_message);
+
+// Writes the index via write-then-rename.
+bool save_model_index(const std::string &path, const std::vector<ModelIndexEntry> &entries,
+                      std::string &error_message);
+
+struct ModelIndexScan {
+  std::vector<ModelIndexEntry> entries;
+  std::size_t reused = 0;    // Size and mtime unchanged; cached metadata kept
+  std::size_t reparsed = 0;  // New or changed files whose header was read
+  std::size_t dropped = 0;   // Discovered files that vanished or left the allowed dirs
+  std::vector<std::string> warnings;
+  std::vector<std::string> directories;  // Walked, for the directory watcher
+
+  bool changed() const { return reparsed > 0 || dropped > 0; }
+};
+
+// Reconciles `indexed` with a discovery walk: headers are only re-read for
+// new files and files whose size or mtime changed. Existing ids never change.
+ModelIndexScan rescan_model_index(std::vector<ModelIndexEntry> indexed,
+                                  const std::vector<std::string> &discovery_paths,
+                                  const DiscoveryOptions &discovery,
+                                  const ModelLoadOptions &default_load_options);
+
+// The files making up a model: its shards, or just its path.
+std::vector<std::string> model_files(const ModelIndexEntry &entry);
+
+// The name a model is listed under: split sets drop their -NNNNN-of-NNNNN
+// suffix.
+std::string logical_model_path(const std::string &path);
+
+// Whether `path` lies inside one of `dirs` (after normalization).
+bool is_within_model_dirs(const std::string &path, const std::vector<std::string> &dirs);
+
+// Comparison key for model paths: absolute and lexically normalized, so the
+// discovered and registered spellings of one file match.
+std::string model_path_key(const std::string &path);
+
+// Last-modified time of `path` in nanoseconds, or 0 if it cannot be read.
+std::int64_t model_file_mtime_ns(const std::string &path);
+
+std::string sanitize_model_id(std::string input);
+
+// Derives an id from the file stem, suffixed -2, -3, ... while `is_taken`.
+std::string allocate_model_id(const std::string &path,
+                              const std::function<bool(const std::string &)> &is_taken);
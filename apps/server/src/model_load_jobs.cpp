@@ -0,0 +1,164 @@
+#include "model_load_jobs.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Share of the progress bar covered by reading weights; the remainder is
+// engine initialization and warm-up, which report no progress of their own.
+constexpr double kReadProgressShare = 90.0;
+constexpr double kWarmingProgress = 95.0;
+
+}  // namespace
+
+ModelLoadJob::ModelLoadJob(std::string job_id, std::string model, int ctx_size,
+                           std::uintmax_t total, std::shared_ptr<ChangeCounter> changes)
+    : id(std::move(job_id)),
+      model_id(std::move(model)),
+      context_size(ctx_size),
+      bytes_total(total),
+      changes_(std::move(changes)) {}
+
+void ModelLoadJob::touch() const {
+  if (changes_) {
+    changes_->fetch_add(1, std::memory_order_release);
+  }
+}
+
+void ModelLoadJob::add_bytes_loaded(std::uintmax_t bytes) {
+  bytes_loaded_.fetch_add(bytes, std::memory_order_relaxed);
+  touch();
+}
+
+void ModelLoadJob::set_phase(std::string phase) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (finished_at_) {
+      return;
+    }
+    phase_ = std::move(phase);
+  }
+  touch();
+}
+
+void ModelLoadJob::finish(std::string state, std::string error_code, std::string error_message) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (finished_at_) {
+      return;
+    }
+    state_ = std::move(state);
+    if (state_ == "ready") {
+      phase_ = "done";
+    }
+    error_code_ = std::move(error_code);
+    error_message_ = std::move(error_message);
+    finished_at_ = std::chrono::steady_clock::now();
+  }
+  touch();
+}
+
+void ModelLoadJob::record_timing(const std::string &step, std::int64_t ms) {
+  std::lock_guard<std::mutex> lock(mu_);
+  timings_ms_[step] = ms;
+}
+
+bool ModelLoadJob::finished() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return finished_at_.has_value();
+}
+
+ModelLoadStatus ModelLoadJob::status() const {
+  ModelLoadStatus out;
+  out.id = id;
+  out.model_id = model_id;
+  out.context_size = context_size;
+  out.bytes_total = bytes_total;
+  out.bytes_loaded = std::min(bytes_loaded_.load(std::memory_order_relaxed), bytes_total);
+  out.cancel_requested = cancel_requested();
+  out.activate = activate();
+
+  std::lock_guard<std::mutex> lock(mu_);
+  out.state = state_;
+  out.phase = phase_;
+  out.error_code = error_code_;
+  out.error_message = error_message_;
+  out.timings_ms = timings_ms_;
+  const auto end = finished_at_.value_or(std::chrono::steady_clock::now());
+  out.elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(end - started_at_).count();
+
+  if (state_ == "ready") {
+    out.progress_percent = 100.0;
+  } else if (phase_ == "warming") {
+    out.progress_percent = kWarmingProgress;
+  } else if (phase_ == "mapping" || phase_ == "initializing") {
+    out.progress_percent = kReadProgressShare;
+  } else if (bytes_total > 0) {
+    out.progress_percent = kReadProgressShare * static_cast<double>(out.bytes_loaded) /
+                           static_cast<double>(bytes_total);
+  }
+  return out;
+}
+
+ModelLoadJobs::ModelLoadJobs(std::size_t max_finished, std::shared_ptr<ChangeCounter> changes)
+    : max_finished_(max_finished), changes_(std::move(changes)) {}
+
+std::shared_ptr<ModelLoadJob> ModelLoadJobs::create(const std::string &model_id,
+                                                    int context_size,
+                                                    std::uintmax_t bytes_total) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto job = std::make_shared<ModelLoadJob>("load-" + std::to_string(next_id_++), model_id,
+                                            context_size, bytes_total, changes_);
+  jobs_[job->id] = job;
+  latest_by_model_[model_id] = job;
+  order_.push_back(job->id);
+  prune_locked();
+  if (changes_) {
+    changes_->fetch_add(1, std::memory_order_release);
+  }
+  return job;
+}
+
+std::shared_ptr<ModelLoadJob> ModelLoadJobs::find(const std::string &job_id) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  const auto it = jobs_.find(job_id);
+  return it == jobs_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<ModelLoadJob> ModelLoadJobs::latest_for(const std::string &model_id) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  const auto it = latest_by_model_.find(model_id);
+  return it == latest_by_model_.end() ? nullptr : it->second;
+}
+
+void ModelLoadJobs::cancel_all() {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto &item : jobs_) {
+    if (!item.second->finished()) {
+      item.second->request_cancel();
+    }
+  }
+}
+
+void ModelLoadJobs::prune_locked() {
+  std::size_t finished = 0;
+  for (const auto &id : order_) {
+    finished += jobs_.at(id)->finished() ? 1 : 0;
+  }
+  // Drop the oldest finished jobs; running ones are never forgotten.
+  for (auto it = order_.begin(); it != order_.end() && finished > max_finished_;) {
+    const auto job = jobs_.at(*it);
+    if (!job->finished()) {
+      ++it;
+      continue;
+    }
+    const auto latest = latest_by_model_.find(job->model_id);
+    if (latest != latest_by_model_.end() && latest->second == job) {
+      latest_by_model_.erase(latest);
+    }
+    jobs_.erase(*it);
+    it = order_.erase(it);
+    --finished;
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Bumped on every observable job change so readers can cache derived views.
+using ChangeCounter = std::atomic<std::uint64_t>;
+
+// Point-in-time view of a model load job, safe to serialize.
+struct ModelLoadStatus {
+  std::string id;
+  std::string model_id;
+  int context_size = 0;
+  std::string state;  // loading | ready | failed | cancelled
+  std::string phase;  // queued | reading | mapping | initializing | warming | done
+  std::uintmax_t bytes_total = 0;
+  std::uintmax_t bytes_loaded = 0;
+  double progress_percent = 0.0;
+  bool cancel_requested = false;
+  bool activate = false;  // Becomes the active model once ready
+  std::string error_code;
+  std::string error_message;
+  std::int64_t elapsed_ms = 0;
+  // Wall time per completed step: prefetch, mapping, init, warmup.
+  std::map<std::string, std::int64_t> timings_ms;
+};
+
+// A background model load. Progress counters are written by the loader
+// thread and read by HTTP handlers; the state transitions are guarded.
+class ModelLoadJob {
+ public:
+  ModelLoadJob(std::string id, std::string model_id, int context_size,
+               std::uintmax_t bytes_total, std::shared_ptr<ChangeCounter> changes = nullptr);
+
+  const std::string id;
+  const std::string model_id;
+  const int context_size;
+  const std::uintmax_t bytes_total;
+
+  void add_bytes_loaded(std::uintmax_t bytes);
+  void set_phase(std::string phase);
+  void record_timing(const std::string &step, std::int64_t ms);
+  // Moves the job to a terminal state; later calls are ignored.
+  void finish(std::string state, std::string error_code = {}, std::string error_message = {});
+  void request_cancel() {
+    cancel_requested_.store(true, std::memory_order_relaxed);
+    touch();
+  }
+  // Preloads only make a model resident; a select joining the job upgrades it.
+  void request_activation() { activate_.store(true, std::memory_order_relaxed); }
+
+  bool cancel_requested() const { return cancel_requested_.load(std::memory_order_relaxed); }
+  bool activate() const { return activate_.load(std::memory_order_relaxed); }
+  bool finished() const;
+  ModelLoadStatus status() const;
+
+ private:
+  void touch() const;
+
+  const std::shared_ptr<ChangeCounter> changes_;
+  const std::chrono::steady_clock::time_point started_at_ = std::chrono::steady_clock::now();
+  std::atomic<std::uintmax_t> bytes_loaded_{0};
+  std::atomic<bool> cancel_requested_{false};
+  std::atomic<bool> activate_{false};
+
+  mutable std::mutex mu_;
+  std::string state_ = "loading";
+  std::string phase_ = "queued";
+  std::string error_code_;
+  std::string error_message_;
+  std::optional<std::chrono::steady_clock::time_point> finished_at_;
+  std::map<std::string, std::int64_t> timings_ms_;
+};
+
+// Registry of recent load jobs. Finished jobs are kept (up to `max_finished`)
+// so clients can poll the outcome after the fact.
+class ModelLoadJobs {
+ public:
+  explicit ModelLoadJobs(std::size_t max_finished = 32,
+                         std::shared_ptr<ChangeCounter> changes = nullptr);
+
+  std::shared_ptr<ModelLoadJob> create(const std::string &model_id, int context_size,
+                                       std::uintmax_t bytes_total);
+  std::shared_ptr<ModelLoadJob> find(const std::string &job_id) const;
+  // The most recent job for `model_id`, finished or not.
+  std::shared_ptr<ModelLoadJob> latest_for(const std::string &model_id) const;
+  // Requests cancellation of every unfinished job.
+  void cancel_all();
+
+ private:
+  void prune_locked();
+
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, std::shared_ptr<ModelLoadJob>> jobs_;
+  std::unordered_map<std::string, std::shared_ptr<ModelLoadJob>> latest_by_model_;
+  std::deque<std::string> order_;  // Creation order, oldest first
+  std::uint64_t next_id_ = 1;
+  const std::size_t max_finished_;
+  const std::shared_ptr<ChangeCounter> changes_;
+};
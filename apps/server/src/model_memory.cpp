@@ -0,0 +1,166 @@
+#include "model_memory.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kPrefetchChunkBytes = 8u << 20;
+
+std::string errno_message(const char *what) {
+  return std::string(what) + ": " + std::strerror(errno);
+}
+
+bool prefetch_by_read(int fd, const PrefetchProgress &on_progress, std::string &error_message) {
+#ifdef POSIX_FADV_SEQUENTIAL
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  std::vector<char> buffer(kPrefetchChunkBytes);
+  std::uintmax_t total = 0;
+  while (true) {
+    const auto n = ::read(fd, buffer.data(), buffer.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error_message = errno_message("Failed to read model file");
+      return false;
+    }
+    if (n == 0) {
+      return true;
+    }
+    total += static_cast<std::uintmax_t>(n);
+    if (!on_progress(total)) {
+      error_message = "Model load cancelled";
+      return false;
+    }
+  }
+}
+
+bool prefetch_by_madvise(int fd, std::size_t size, const PrefetchProgress &on_progress,
+                         std::string &error_message) {
+  if (size == 0) {
+    return true;
+  }
+  void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    error_message = errno_message("Failed to map model file");
+    return false;
+  }
+  auto *base = static_cast<const volatile char *>(addr);
+  const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGE_SIZE));
+  ::madvise(addr, size, MADV_SEQUENTIAL);
+
+  bool ok = true;
+  for (std::size_t offset = 0; offset < size; offset += kPrefetchChunkBytes) {
+    const auto len = std::min(kPrefetchChunkBytes, size - offset);
+    // Queue the chunk's readahead, then fault each page so progress reflects
+    // bytes actually resident.
+    ::madvise(const_cast<char *>(base) + offset, len, MADV_WILLNEED);
+    for (std::size_t p = 0; p < len; p += page) {
+      static_cast<void>(base[offset + p]);
+    }
+    if (!on_progress(offset + len)) {
+      error_message = "Model load cancelled";
+      ok = false;
+      break;
+    }
+  }
+  ::munmap(addr, size);
+  return ok;
+}
+
+}  // namespace
+
+std::string_view prefetch_mode_name(PrefetchMode mode) {
+  switch (mode) {
+    case PrefetchMode::kNone:
+      return "none";
+    case PrefetchMode::kRead:
+      return "read";
+    case PrefetchMode::kMadvise:
+      return "madvise";
+  }
+  return "read";
+}
+
+std::optional<PrefetchMode> parse_prefetch_mode(std::string_view name) {
+  for (const auto mode : {PrefetchMode::kNone, PrefetchMode::kRead, PrefetchMode::kMadvise}) {
+    if (prefetch_mode_name(mode) == name) {
+      return mode;
+    }
+  }
+  return std::nullopt;
+}
+
+bool prefetch_model_file(const std::string &path, PrefetchMode mode,
+                         const PrefetchProgress &on_progress, std::string &error_message) {
+  if (mode == PrefetchMode::kNone) {
+    return true;
+  }
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error_message = errno_message("Failed to open model file");
+    return false;
+  }
+  if (!on_progress(0)) {
+    ::close(fd);
+    error_message = "Model load cancelled";
+    return false;
+  }
+
+  bool ok = false;
+  if (mode == PrefetchMode::kRead) {
+    ok = prefetch_by_read(fd, on_progress, error_message);
+  } else {
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      error_message = errno_message("Failed to stat model file");
+    } else {
+      ok = prefetch_by_madvise(fd, static_cast<std::size_t>(st.st_size), on_progress,
+                               error_message);
+    }
+  }
+  ::close(fd);
+  return ok;
+}
+
+std::unique_ptr<PinnedMapping> PinnedMapping::pin(const std::string &path,
+                                                  std::string &error_message) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error_message = errno_message("Failed to open model file");
+    return nullptr;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    error_message = "Failed to stat model file";
+    ::close(fd);
+    return nullptr;
+  }
+  const auto size = static_cast<std::size_t>(st.st_size);
+  void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    error_message = errno_message("Failed to map model file");
+    return nullptr;
+  }
+  if (::mlock(addr, size) != 0) {
+    error_message = errno_message("Failed to lock model weights");
+    ::munmap(addr, size);
+    return nullptr;
+  }
+  return std::unique_ptr<PinnedMapping>(new PinnedMapping(addr, size));
+}
+
+PinnedMapping::~PinnedMapping() {
+  ::munlock(addr_, size_);
+  ::munmap(addr_, size_);
+}
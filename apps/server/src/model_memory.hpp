@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// How model weights are brought into the page cache before the engine maps
+// them. Cold loads are otherwise dominated by random page faults.
+enum class PrefetchMode {
+  kNone,     // Let the engine fault pages in on demand
+  kRead,     // Sequential read() in large chunks
+  kMadvise,  // Private mapping + madvise(WILLNEED), touching each page in order
+};
+
+std::string_view prefetch_mode_name(PrefetchMode mode);
+std::optional<PrefetchMode> parse_prefetch_mode(std::string_view name);
+
+struct ModelLoadOptions {
+  PrefetchMode prefetch = PrefetchMode::kRead;
+  // Pin the weights in RAM for as long as the model is resident.
+  bool mlock = false;
+};
+
+// Reports bytes prefetched so far; returning false aborts the prefetch.
+using PrefetchProgress = std::function<bool(std::uintmax_t bytes)>;
+
+// Runs one prefetch pass over `path`. Returns false with `error_message` set
+// on I/O errors or when `on_progress` asks to stop.
+bool prefetch_model_file(const std::string &path, PrefetchMode mode,
+                         const PrefetchProgress &on_progress, std::string &error_message);
+
+// A read-only shared mapping of a model file whose pages are mlock()ed. The
+// engine maps the same file, so pinning our view keeps its weights resident
+// too. Unlocked and unmapped on destruction.
+class PinnedMapping {
+ public:
+  // Returns nullptr with `error_message` set when the file cannot be mapped or
+  // locked (typically RLIMIT_MEMLOCK).
+  static std::unique_ptr<PinnedMapping> pin(const std::string &path, std::string &error_message);
+  ~PinnedMapping();
+
+  PinnedMapping(const PinnedMapping &) = delete;
+  PinnedMapping &operator=(const PinnedMapping &) = delete;
+
+  std::size_t size() const { return size_; }
+
+ private:
+  PinnedMapping(void *addr, std::size_t size) : addr_(addr), size_(size) {}
+
+  void *addr_;
+  std::size_t size_;
+};
@@ -0,0 +1,134 @@
+#include "model_watcher.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+constexpr std::uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM |
+                                     IN_CREATE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+bool is_model_file(const std::string &name) {
+  return std::filesystem::path(name).extension() == ".gguf";
+}
+
+}  // namespace
+
+std::unique_ptr<ModelDirectoryWatcher> ModelDirectoryWatcher::start(
+    const std::vector<std::string> &dirs, ModelFileCallback on_event,
+    std::string &error_message) {
+  const int inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0) {
+    error_message = std::string("inotify_init1 failed: ") + std::strerror(errno);
+    return nullptr;
+  }
+  const int wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd < 0) {
+    error_message = std::string("eventfd failed: ") + std::strerror(errno);
+    ::close(inotify_fd);
+    return nullptr;
+  }
+
+  std::unique_ptr<ModelDirectoryWatcher> watcher(
+      new ModelDirectoryWatcher(inotify_fd, wake_fd, std::move(on_event)));
+  watcher->add_directories(dirs);
+  watcher->thread_ = std::thread([raw = watcher.get()]() { raw->run(); });
+  return watcher;
+}
+
+ModelDirectoryWatcher::~ModelDirectoryWatcher() {
+  stop();
+  ::close(inotify_fd_);
+  ::close(wake_fd_);
+}
+
+void ModelDirectoryWatcher::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  const std::uint64_t one = 1;
+  static_cast<void>(::write(wake_fd_, &one, sizeof(one)));
+  thread_.join();
+}
+
+void ModelDirectoryWatcher::add_directories(const std::vector<std::string> &dirs) {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto &dir : dirs) {
+    // Re-adding a watched directory returns its existing descriptor.
+    const int wd = ::inotify_add_watch(inotify_fd_, dir.c_str(), kWatchMask);
+    if (wd >= 0) {
+      dirs_.try_emplace(wd, dir);
+    }
+  }
+}
+
+std::size_t ModelDirectoryWatcher::watched_count() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return dirs_.size();
+}
+
+void ModelDirectoryWatcher::run() {
+  alignas(struct inotify_event) char buffer[16 * 1024];
+  pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+  while (true) {
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+    while (true) {
+      const auto n = ::read(inotify_fd_, buffer, sizeof(buffer));
+      if (n <= 0) {
+        break;  // EAGAIN: drained
+      }
+      dispatch(buffer, static_cast<std::size_t>(n));
+    }
+  }
+}
+
+void ModelDirectoryWatcher::dispatch(const char *buffer, std::size_t length) {
+  for (std::size_t offset = 0; offset < length;) {
+    const auto *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+    offset += sizeof(struct inotify_event) + event->len;
+
+    if (event->mask & IN_IGNORED) {
+      std::lock_guard<std::mutex> lock(mu_);
+      dirs_.erase(event->wd);
+      continue;
+    }
+    if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_ISDIR)) {
+      on_event_({ModelFileEventKind::kOverflow, {}});
+      continue;
+    }
+    std::string dir;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      const auto it = dirs_.find(event->wd);
+      if (it == dirs_.end()) {
+        continue;
+      }
+      dir = it->second;
+    }
+    const std::string name(event->len > 0 ? event->name : "");
+    if (!is_model_file(name)) {
+      continue;
+    }
+    const auto path = (std::filesystem::path(dir) / name).string();
+    if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+      on_event_({ModelFileEventKind::kWritten, path});
+    } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+      on_event_({ModelFileEventKind::kRemoved, path});
+    }
+  }
+}
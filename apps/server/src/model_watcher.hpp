@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class ModelFileEventKind {
+  kWritten,   // A .gguf finished writing or was moved in
+  kRemoved,   // A .gguf was deleted or moved out
+  kOverflow,  // Events were lost or the directory tree changed; rescan
+};
+
+struct ModelFileEvent {
+  ModelFileEventKind kind;
+  std::string path;  // Empty for kOverflow
+};
+
+using ModelFileCallback = std::function<void(const ModelFileEvent &event)>;
+
+// inotify watch over the model discovery directories (every level of the
+// tree: inotify is not recursive). Files are reported on close-after-write or
+// rename-in, so partially copied GGUFs are never seen. Subdirectories being
+// created or removed are reported as kOverflow; the rescan that follows
+// should pass its directories to add_directories(). Callbacks run on the
+// watcher's own thread.
+class ModelDirectoryWatcher {
+ public:
+  // Directories that do not exist are skipped. Returns nullptr with
+  // `error_message` set when inotify is unavailable.
+  static std::unique_ptr<ModelDirectoryWatcher> start(const std::vector<std::string> &dirs,
+                                                      ModelFileCallback on_event,
+                                                      std::string &error_message);
+  ~ModelDirectoryWatcher();
+
+  ModelDirectoryWatcher(const ModelDirectoryWatcher &) = delete;
+  ModelDirectoryWatcher &operator=(const ModelDirectoryWatcher &) = delete;
+
+  // Wakes and joins the watcher thread. Safe to call more than once.
+  void stop();
+
+  // Starts watching any of `dirs` not yet watched; missing ones are skipped.
+  void add_directories(const std::vector<std::string> &dirs);
+
+  std::size_t watched_count() const;
+
+ private:
+  ModelDirectoryWatcher(int inotify_fd, int wake_fd, ModelFileCallback on_event)
+      : inotify_fd_(inotify_fd), wake_fd_(wake_fd), on_event_(std::move(on_event)) {}
+
+  void run();
+  void dispatch(const char *buffer, std::size_t length);
+
+  int inotify_fd_;
+  int wake_fd_;
+  ModelFileCallback on_event_;
+  mutable std::mutex mu_;
+  std::unordered_map<int, std::string> dirs_;  // Watch descriptor -> directory; guarded by mu_
+  std::thread thread_;
+};
@@ -0,0 +1,53 @@
+#include "prefix_cache.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::uint64_t kFnvOffset = 14695981039346656037ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+std::uint64_t fnv1a(std::uint64_t hash, std::string_view text) {
+  for (const unsigned char c : text) {
+    hash ^= c;
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+}  // namespace
+
+std::uint64_t conversation_key(std::string_view system_prompt, std::string_view scope) {
+  // The separator keeps ("ab", "c") and ("a", "bc") apart.
+  auto hash = fnv1a(kFnvOffset, system_prompt);
+  hash = fnv1a(hash, std::string_view("\0", 1));
+  return fnv1a(hash, scope);
+}
+
+PrefixCacheUsage PrefixCache::lookup(std::uint64_t key) {
+  PrefixCacheUsage usage;
+  ++stats_.lookups;
+  if (key_ == key) {
+    ++stats_.hits;
+    stats_.prefill_tokens_saved += tokens_;
+    usage.hit = true;
+    usage.reused_tokens = tokens_;
+  } else {
+    invalidate();
+  }
+  usage.totals = stats_;
+  return usage;
+}
+
+void PrefixCache::extend(std::uint64_t key, std::uint64_t turn_tokens) {
+  if (key_ != key) {
+    key_ = key;
+    tokens_ = 0;
+  }
+  tokens_ = std::min(tokens_ + turn_tokens, max_tokens_);
+}
+
+void PrefixCache::invalidate() {
+  key_.reset();
+  tokens_ = 0;
+}
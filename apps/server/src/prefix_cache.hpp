@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+struct PrefixCacheStats {
+  std::uint64_t lookups = 0;
+  std::uint64_t hits = 0;
+  // Context tokens that hits did not have to prefill again.
+  std::uint64_t prefill_tokens_saved = 0;
+
+  double hit_rate() const {
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+  }
+};
+
+// Outcome of one lookup, reported with the response it served.
+struct PrefixCacheUsage {
+  bool hit = false;
+  std::uint64_t reused_tokens = 0;
+  PrefixCacheStats totals;
+};
+
+// Identifies a conversation prefix: the system prompt it starts from and its
+// scope (a session id, or empty for the stateless chat endpoints). FNV-1a.
+std::uint64_t conversation_key(std::string_view system_prompt, std::string_view scope);
+
+// Tracks which conversation prefix an agent slot's live context (its KV
+// cache) holds and how many tokens it spans. A request whose conversation
+// matches continues the context as is; any other request must clear it and
+// prefill from scratch. Not synchronized; AgentSlot::mu guards it.
+class PrefixCache {
+ public:
+  // Context tokens are capped at the agent's context window.
+  explicit PrefixCache(std::uint64_t max_tokens) : max_tokens_(max_tokens) {}
+
+  // Counts a lookup for `key`. On a miss the cached prefix is dropped, since
+  // the caller is about to clear the context.
+  PrefixCacheUsage lookup(std::uint64_t key);
+  // Records a finished turn of `key`: the context now holds `turn_tokens`
+  // more tokens of that conversation.
+  void extend(std::uint64_t key, std::uint64_t turn_tokens);
+  // The context was cleared or its tool schema changed.
+  void invalidate();
+
+  std::optional<std::uint64_t> key() const { return key_; }
+  std::uint64_t tokens() const { return tokens_; }
+  const PrefixCacheStats &stats() const { return stats_; }
+
+ private:
+  std::optional<std::uint64_t> key_;
+  std::uint64_t tokens_ = 0;
+  const std::uint64_t max_tokens_;
+  PrefixCacheStats stats_;
+};
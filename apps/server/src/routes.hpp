@@ -3,11 +3,14 @@
 #include <filesystem>
 
 #include "runtime_state.hpp"
+#include "stream_hub.hpp"
 
-void register_health_routes();
+void register_health_routes(const RuntimeState &runtime_state);
 void register_model_routes(RuntimeState &runtime_state);
-void register_chat_routes(RuntimeState &runtime_state);
-void shutdown_chat_routes();
+void register_chat_routes(RuntimeState &runtime_state, StreamHubRegistry &stream_hubs);
+// The chat WebSocket at /api/chat/{session_id}/stream.
+void register_chat_socket(RuntimeState &runtime_state, StreamHubRegistry &stream_hubs);
+void register_session_routes(RuntimeState &runtime_state);
 void register_deferred_routes();
 void register_mcp_routes(RuntimeState &runtime_state);
 void register_spa_routes(const std::filesystem::path &web_root,
@@ -4,39 +4,148 @@
 #include <drogon/HttpTypes.h>
 #include <drogon/drogon.h>
 
-#include <thread>
-#include <atomic>
-
 #include "api_parsers.hpp"
+#include "api_serialization.hpp"
+#include "chat_stream_task.hpp"
 #include "http_helpers.hpp"
 
-static std::atomic<int> active_chat_streams{0};
-
-void shutdown_chat_routes() {
-  if (active_chat_streams.load() > 0) {
-    LOG_INFO << "Waiting for " << active_chat_streams.load() << " active chat stream(s) to finish...";
-    const int max_wait_ms = 10000;
-    int elapsed_ms = 0;
-    while (active_chat_streams.load() > 0 && elapsed_ms < max_wait_ms) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      elapsed_ms += 100;
-    }
-    if (active_chat_streams.load() > 0) {
-      LOG_WARN << "Shutdown timeout: " << active_chat_streams.load() << " stream(s) still active, forcing exit";
-    }
+namespace {
+
+// Answers a request that could not be admitted with 404 (unknown model or
+// session), 409 (model not loaded) or 429 plus a Retry-After estimate (queue
+// full).
+void write_admission_failure(const drogon::HttpRequestPtr &req,
+                             std::function<void(const drogon::HttpResponsePtr &)> &cb,
+                             const std::string &error_code, const std::string &error_message,
+                             int retry_after_seconds) {
+  if (error_code == "APP-RATE-429") {
+    LOG_WARN << "Rejecting chat request: " << error_message;
+    Json::Value details(Json::objectValue);
+    details["retry_after_seconds"] = retry_after_seconds;
+    auto resp = make_error_response(req, drogon::k429TooManyRequests, error_code, "rate_limit",
+                                    error_message, true, details);
+    resp->addHeader("Retry-After", std::to_string(retry_after_seconds));
+    cb(resp);
+    return;
+  }
+
+  if (error_code == "APP-MOD-404" || error_code == "APP-SESSION-404") {
+    write_error(req, std::move(cb), drogon::k404NotFound, error_code, "not_found",
+                error_message, false);
+    return;
   }
+
+  write_error(req, std::move(cb), drogon::k409Conflict, error_code, "conflict", error_message,
+              true);
 }
 
-void register_chat_routes(RuntimeState &runtime_state) {
+// Reserves a place in the target model's inference queue, or answers the
+// request itself.
+std::optional<ChatReservation> admit_or_reject(
+    RuntimeState &runtime_state, const std::optional<std::string> &model_id,
+    const drogon::HttpRequestPtr &req,
+    std::function<void(const drogon::HttpResponsePtr &)> &cb) {
+  std::string error_code;
+  std::string error_message;
+  int retry_after_seconds = 0;
+  auto reservation =
+      runtime_state.admit_chat(model_id, error_code, error_message, retry_after_seconds);
+  if (!reservation) {
+    write_admission_failure(req, cb, error_code, error_message, retry_after_seconds);
+  }
+  return reservation;
+}
+
+// 202 for a detached generation, naming where to watch it.
+void write_accepted(const drogon::HttpRequestPtr &req,
+                    std::function<void(const drogon::HttpResponsePtr &)> &cb,
+                    const StreamHub &hub, const std::string &session_id) {
+  const auto stream_url = "/api/chat/stream/" + hub.id();
+  Json::Value body(Json::objectValue);
+  body["request_id"] = hub.id();
+  body["session_id"] = session_id;
+  body["status"] = hub.finished() ? "finished" : "queued";
+  body["accepted_at"] = now_rfc3339_utc();
+  body["stream_url"] = stream_url;
+  auto resp = drogon::HttpResponse::newHttpResponse();
+  write_json(req, resp, body, drogon::k202Accepted);
+  resp->addHeader("Location", stream_url);
+  cb(resp);
+}
+
+// Starts a session turn that runs whether or not anybody watches it; clients
+// follow it through /api/chat/stream/{request_id}. Resubmitting a request_id
+// answers for the existing generation instead of starting another.
+void submit_detached_send(RuntimeState &runtime_state, StreamHubRegistry &stream_hubs,
+                          const std::string &session_id, ParsedChatSendRequest parsed,
+                          const drogon::HttpRequestPtr &req,
+                          std::function<void(const drogon::HttpResponsePtr &)> &cb) {
+  std::string error_code;
+  std::string error_message;
+  int retry_after_seconds = 0;
+  const auto hub = submit_detached_session_chat(runtime_state, stream_hubs, session_id,
+                                                std::move(parsed), error_code, error_message,
+                                                retry_after_seconds);
+  if (!hub) {
+    write_admission_failure(req, cb, error_code, error_message, retry_after_seconds);
+    return;
+  }
+  write_accepted(req, cb, *hub, session_id);
+}
+
+void add_sse_headers(const drogon::HttpResponsePtr &resp) {
+  resp->setContentTypeString("text/event-stream");
+  resp->addHeader("Cache-Control", "no-cache");
+  resp->addHeader("X-Accel-Buffering", "no");
+}
+
+// The server's token coalescing with the request's overrides applied, capped
+// to what the client's stream buffer holds.
+StreamFlushPolicy stream_flush_for(const RuntimeState &runtime_state,
+                                   const ParsedChatRequest &parsed) {
+  auto flush = runtime_state.stream_flush_policy();
+  if (parsed.flush_interval_ms.has_value()) {
+    flush.max_delay = std::chrono::milliseconds(*parsed.flush_interval_ms);
+  }
+  if (parsed.flush_bytes.has_value()) {
+    flush.max_bytes = static_cast<std::size_t>(*parsed.flush_bytes);
+  }
+  return fit_flush_to_buffer(flush, runtime_state.stream_buffer_bytes());
+}
+
+// Answers a chat whose generation failed after admission.
+void write_chat_failure(const drogon::HttpRequestPtr &req,
+                        std::function<void(const drogon::HttpResponsePtr &)> &&cb,
+                        const std::string &error_code, const std::string &error_message) {
+  LOG_ERROR << "Failed to complete chat: " << error_message;
+  auto status = drogon::k502BadGateway;
+  auto category = std::string("upstream");
+  if (error_code == "APP-STATE-409") {
+    status = drogon::k409Conflict;
+    category = "conflict";
+  } else if (error_code == "APP-STATE-503") {
+    status = drogon::k503ServiceUnavailable;
+    category = "internal";
+  } else if (error_code == "APP-SESSION-404") {
+    write_error(req, std::move(cb), drogon::k404NotFound, error_code, "not_found",
+                error_message, false);
+    return;
+  }
+  write_error(req, std::move(cb), status, error_code, category, error_message, true);
+}
+
+}  // namespace
+
+void register_chat_routes(RuntimeState &runtime_state, StreamHubRegistry &stream_hubs) {
   drogon::app().registerHandler(
       "/api/chat/complete",
       [&runtime_state](const drogon::HttpRequestPtr &req,
                        std::function<void(const drogon::HttpResponsePtr &)> &&cb) {
         LOG_INFO << "Executing chat complete";
-        std::string message;
+        ParsedChatRequest parsed;
         Json::Value details(Json::objectValue);
         if (const auto parse_error =
-                parse_chat_complete_request(req->getJsonObject(), message, details);
+                parse_chat_complete_request(req->getJsonObject(), parsed, details);
             parse_error.has_value()) {
           LOG_ERROR << "Failed to parse chat complete request: " << *parse_error;
           write_error(req, std::move(cb), drogon::k400BadRequest, "APP-VAL-001",
@@ -44,50 +153,90 @@ void register_chat_routes(RuntimeState &runtime_state) {
           return;
         }
 
-        std::string error_code;
-        std::string error_message;
-        const auto response = runtime_state.chat_complete(message, error_code, error_message);
-        if (!response.has_value()) {
-          LOG_ERROR << "Failed to complete chat: " << error_message;
-          const auto status = error_code == "APP-STATE-409" ? drogon::k409Conflict
-                                                              : drogon::k502BadGateway;
-          write_error(req, std::move(cb), status, error_code,
-                      status == drogon::k409Conflict ? "conflict" : "upstream",
-                      error_message, true);
+        auto reservation = admit_or_reject(runtime_state, parsed.model_id, req, cb);
+        if (!reservation) {
           return;
         }
 
-        Json::Value usage(Json::objectValue);
-        usage["prompt_tokens"] = response->usage.prompt_tokens;
-        usage["completion_tokens"] = response->usage.completion_tokens;
-        usage["total_tokens"] = response->usage.total_tokens;
+        // Inference runs on the runtime's executor; the callback is completed
+        // from the worker thread so this event loop stays free.
+        runtime_state.chat_complete_async(
+            std::move(*reservation), std::move(parsed.message), parsed.isolated,
+            [req, cb = std::move(cb)](std::optional<ChatResult> result,
+                                      const std::string &error_code,
+                                      const std::string &error_message) mutable {
+              if (!result.has_value()) {
+                write_chat_failure(req, std::move(cb), error_code, error_message);
+                return;
+              }
 
-        Json::Value metrics(Json::objectValue);
-        metrics["latency_ms"] = static_cast<Json::Int64>(response->metrics.latency_ms.count());
-        metrics["time_to_first_token_ms"] =
-            static_cast<Json::Int64>(response->metrics.time_to_first_token_ms.count());
-        metrics["tokens_per_second"] = response->metrics.tokens_per_second;
+              auto resp = drogon::HttpResponse::newHttpResponse();
+              write_json(req, resp, chat_response_to_json(*result));
+              cb(resp);
+            });
+      },
+      {drogon::Post});
 
-        Json::Value body(Json::objectValue);
-        body["text"] = response->text;
-        body["usage"] = usage;
-        body["metrics"] = metrics;
+  drogon::app().registerHandler(
+      "/api/chat/{1}/send",
+      [&runtime_state, &stream_hubs](const drogon::HttpRequestPtr &req,
+                                     std::function<void(const drogon::HttpResponsePtr &)> &&cb,
+                                     const std::string &session_id) {
+        ParsedChatSendRequest parsed;
+        Json::Value details(Json::objectValue);
+        if (const auto parse_error =
+                parse_chat_send_request(req->getJsonObject(), parsed, details);
+            parse_error.has_value()) {
+          write_error(req, std::move(cb), drogon::k400BadRequest, "APP-VAL-001",
+                      "validation", *parse_error, false, details);
+          return;
+        }
+        if (parsed.stream) {
+          submit_detached_send(runtime_state, stream_hubs, session_id, std::move(parsed), req,
+                               cb);
+          return;
+        }
 
-        auto resp = drogon::HttpResponse::newHttpResponse();
-        write_json(req, resp, body);
-        cb(resp);
+        std::string error_code;
+        std::string error_message;
+        int retry_after_seconds = 0;
+        auto reservation = runtime_state.admit_session_chat(session_id, error_code,
+                                                            error_message, retry_after_seconds);
+        if (!reservation) {
+          write_admission_failure(req, cb, error_code, error_message, retry_after_seconds);
+          return;
+        }
+
+        runtime_state.session_chat_async(
+            std::move(*reservation), session_id, std::move(parsed.message),
+            [&runtime_state, req, session_id, cb = std::move(cb)](
+                std::optional<ChatResult> result, const std::string &error_code,
+                const std::string &error_message) mutable {
+              if (!result.has_value()) {
+                write_chat_failure(req, std::move(cb), error_code, error_message);
+                return;
+              }
+
+              auto body = chat_response_to_json(*result);
+              if (const auto session = runtime_state.session(session_id)) {
+                body["session"] = session_summary_to_json(*session);
+              }
+              auto resp = drogon::HttpResponse::newHttpResponse();
+              write_json(req, resp, body);
+              cb(resp);
+            });
       },
       {drogon::Post});
 
   drogon::app().registerHandler(
       "/api/chat/stream",
-      [&runtime_state](const drogon::HttpRequestPtr &req,
+      [&runtime_state, &stream_hubs](const drogon::HttpRequestPtr &req,
                        std::function<void(const drogon::HttpResponsePtr &)> &&cb) {
         LOG_INFO << "Executing chat stream";
-        std::string message;
+        ParsedChatRequest parsed;
         Json::Value details(Json::objectValue);
         if (const auto parse_error =
-                parse_chat_complete_request(req->getJsonObject(), message, details);
+                parse_chat_complete_request(req->getJsonObject(), parsed, details);
             parse_error.has_value()) {
           LOG_ERROR << "Failed to parse chat complete request: " << *parse_error;
           write_error(req, std::move(cb), drogon::k400BadRequest, "APP-VAL-001",
@@ -95,82 +244,127 @@ void register_chat_routes(RuntimeState &runtime_state) {
           return;
         }
 
+        // Admission happens before the SSE response starts so a full queue can
+        // still be reported as a plain 429.
+        auto reservation = admit_or_reject(runtime_state, parsed.model_id, req, cb);
+        if (!reservation) {
+          return;
+        }
+
         const auto cid = resolve_correlation_id(req);
+        auto hub = stream_hubs.create(parsed.resumable ? StreamLifetime::kResumable
+                                                       : StreamLifetime::kWatched);
+        auto task = std::make_shared<ChatStreamTask>(hub, stream_flush_for(runtime_state, parsed));
 
         auto resp = drogon::HttpResponse::newAsyncStreamResponse(
-            [&runtime_state, message = std::move(message)](
-                drogon::ResponseStreamPtr stream) mutable {
-              // Move the unique_ptr into shared ownership so the inference thread
-              // and token callback can safely call send() without holding the
-              // unique_ptr exclusively.
-              auto ss = std::shared_ptr<drogon::ResponseStream>(std::move(stream));
-
-              active_chat_streams++;
-              std::thread([&runtime_state, msg = std::move(message),
-                           ss = std::move(ss)]() mutable {
-                auto token_cb = [&ss](std::string_view token) {
-                  Json::Value event(Json::objectValue);
-                  event["type"] = "token";
-                  event["content"] = std::string(token);
-                  Json::StreamWriterBuilder builder;
-                  builder["indentation"] = "";
-                  ss->send("data: " + Json::writeString(builder, event) + "\n\n");
-                };
-
-                std::string error_code;
-                std::string error_message;
-                const auto result = runtime_state.chat_stream(
-                    msg, std::move(token_cb), error_code, error_message);
-
-                if (!result) {
-                  LOG_ERROR << "Streaming chat failed: " << error_message;
-                  Json::Value err(Json::objectValue);
-                  err["type"] = "error";
-                  err["code"] = error_code;
-                  err["message"] = error_message;
-                  Json::StreamWriterBuilder builder;
-                  builder["indentation"] = "";
-                  ss->send("data: " + Json::writeString(builder, err) + "\n\n");
-                  ss->close();
-                  active_chat_streams--;
-                  return;
-                }
-
-                Json::Value usage(Json::objectValue);
-                usage["prompt_tokens"] = result->usage.prompt_tokens;
-                usage["completion_tokens"] = result->usage.completion_tokens;
-                usage["total_tokens"] = result->usage.total_tokens;
-
-                Json::Value metrics(Json::objectValue);
-                metrics["latency_ms"] =
-                    static_cast<Json::Int64>(result->metrics.latency_ms.count());
-                metrics["time_to_first_token_ms"] = static_cast<Json::Int64>(
-                    result->metrics.time_to_first_token_ms.count());
-                metrics["tokens_per_second"] = result->metrics.tokens_per_second;
-
-                Json::Value done(Json::objectValue);
-                done["type"] = "done";
-                done["text"] = result->text;
-                done["usage"] = usage;
-                done["metrics"] = metrics;
-
-                Json::StreamWriterBuilder builder;
-                builder["indentation"] = "";
-                ss->send("data: " + Json::writeString(builder, done) + "\n\n");
-                ss->close();
-                active_chat_streams--;
-              }).detach();
+            [&runtime_state, hub, task = std::move(task),
+             reservation = std::move(*reservation),
+             message = std::move(parsed.message)](drogon::ResponseStreamPtr stream) mutable {
+              // Runs on the connection's IO loop, which drains the subscriber.
+              // Nothing is published before chat_stream_async, so attaching
+              // from the start cannot fail.
+              std::string error_code;
+              std::string error_message;
+              hub->attach(std::make_shared<SseStreamSubscriber>(
+                              std::move(stream), trantor::EventLoop::getEventLoopOfCurrentThread(),
+                              runtime_state.stream_buffer_bytes()),
+                          0, error_code, error_message);
+              // The runtime schedules the task on the fixed-size inference
+              // executor behind its ticket.
+              runtime_state.chat_stream_async(std::move(reservation), std::move(message),
+                                              std::move(task));
             },
             /*disableKickoffTimeout=*/true);
 
-        resp->setContentTypeString("text/event-stream");
-        resp->addHeader("Cache-Control", "no-cache");
-        resp->addHeader("X-Accel-Buffering", "no");
+        add_sse_headers(resp);
+        resp->addHeader("X-Stream-Id", hub->id());
         resp->addHeader("X-Correlation-Id", cid);
         cb(resp);
       },
       {drogon::Post});
 
+  drogon::app().registerHandler(
+      "/api/chat/stream/{1}",
+      [&runtime_state, &stream_hubs](const drogon::HttpRequestPtr &req,
+                                     std::function<void(const drogon::HttpResponsePtr &)> &&cb,
+                                     const std::string &stream_id) {
+        std::uint64_t after_seq = 0;
+        Json::Value details(Json::objectValue);
+        if (const auto parse_error = parse_stream_resume_position(
+                req->getHeader("Last-Event-ID"), req->getParameter("from_seq"), after_seq,
+                details);
+            parse_error.has_value()) {
+          write_error(req, std::move(cb), drogon::k400BadRequest, "APP-VAL-001",
+                      "validation", *parse_error, false, details);
+          return;
+        }
+
+        auto hub = stream_hubs.find(stream_id);
+        if (!hub) {
+          write_error(req, std::move(cb), drogon::k404NotFound, "APP-STREAM-404", "not_found",
+                      "Stream not found or no longer resumable", false);
+          return;
+        }
+        // Checked up front so the common failure is a plain 410; the log could
+        // still move on before attach, which then reports it as an event.
+        if (!hub->can_resume(after_seq)) {
+          write_error(req, std::move(cb), drogon::k410Gone, "APP-STREAM-410", "not_found",
+                      "Stream events after " + std::to_string(after_seq) +
+                          " are no longer available",
+                      false);
+          return;
+        }
+        LOG_INFO << "Resuming chat stream " << stream_id << " after event " << after_seq;
+
+        auto resp = drogon::HttpResponse::newAsyncStreamResponse(
+            [&runtime_state, hub, after_seq](drogon::ResponseStreamPtr stream) {
+              auto subscriber = std::make_shared<SseStreamSubscriber>(
+                  std::move(stream), trantor::EventLoop::getEventLoopOfCurrentThread(),
+                  runtime_state.stream_buffer_bytes());
+              std::string error_code;
+              std::string error_message;
+              if (!hub->attach(subscriber, after_seq, error_code, error_message)) {
+                // Ending the stream empty sends the client back here, where it
+                // now gets the 410.
+                LOG_WARN << "Cannot resume chat stream " << hub->id() << ": " << error_message;
+                subscriber->close();
+              }
+            },
+            /*disableKickoffTimeout=*/true);
+
+        add_sse_headers(resp);
+        resp->addHeader("X-Stream-Id", hub->id());
+        resp->addHeader("X-Correlation-Id", resolve_correlation_id(req));
+        cb(resp);
+      },
+      {drogon::Get});
+
+  drogon::app().registerHandler(
+      "/api/chat/stream/{1}/cancel",
+      [&stream_hubs](const drogon::HttpRequestPtr &req,
+                     std::function<void(const drogon::HttpResponsePtr &)> &&cb,
+                     const std::string &stream_id) {
+        const auto hub = stream_hubs.find(stream_id);
+        if (!hub) {
+          write_error(req, std::move(cb), drogon::k404NotFound, "APP-STREAM-404", "not_found",
+                      "Stream not found or no longer resumable", false);
+          return;
+        }
+        if (!hub->cancel()) {
+          write_error(req, std::move(cb), drogon::k409Conflict, "APP-STATE-409", "conflict",
+                      "Generation has already finished", false);
+          return;
+        }
+        LOG_INFO << "Cancelling chat stream " << stream_id;
+        Json::Value body(Json::objectValue);
+        body["request_id"] = stream_id;
+        body["status"] = "cancelling";
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        write_json(req, resp, body, drogon::k202Accepted);
+        cb(resp);
+      },
+      {drogon::Post});
+
   drogon::app().registerHandler(
       "/api/chat/reset",
       [&runtime_state](const drogon::HttpRequestPtr &req,
@@ -201,6 +395,11 @@ void register_chat_routes(RuntimeState &runtime_state) {
         std::string error_message;
         const auto model_id = runtime_state.clear_memory(error_code, error_message);
         if (!model_id.has_value()) {
+          if (error_code == "APP-STATE-409") {
+            write_error(req, std::move(cb), drogon::k409Conflict, error_code, "conflict",
+                        error_message, true);
+            return;
+          }
           auto status = error_code == "APP-STATE-500" ? drogon::k500InternalServerError : drogon::k502BadGateway;
           write_error(req, std::move(cb), status, error_code, "server_error",
                       error_message, false);
@@ -4,19 +4,22 @@
 
 #include "http_helpers.hpp"
 
-void register_health_routes() {
+void register_health_routes(const RuntimeState &runtime_state) {
   drogon::app().registerHandler(
       "/healthz",
-      [](const drogon::HttpRequestPtr &req,
-         std::function<void(const drogon::HttpResponsePtr &)> &&cb) {
+      [&runtime_state](const drogon::HttpRequestPtr &req,
+                       std::function<void(const drogon::HttpResponsePtr &)> &&cb) {
+        // Not ready until startup preloading is done, so load balancers keep
+        // traffic away from a cold instance.
+        const bool ready = runtime_state.ready();
         Json::Value body(Json::objectValue);
-        body["status"] = "ok";
+        body["status"] = ready ? "ok" : "starting";
         body["service"] = "petting-zoo-server";
         body["version"] = PETTING_ZOO_VERSION;
         body["timestamp"] = now_rfc3339_utc();
 
         auto resp = drogon::HttpResponse::newHttpResponse();
-        write_json(req, resp, body, drogon::k200OK);
+        write_json(req, resp, body, ready ? drogon::k200OK : drogon::k503ServiceUnavailable);
         cb(resp);
       });
 }
@@ -58,6 +58,11 @@ void connect_mcp_server(RuntimeState &state, const drogon::HttpRequestPtr &req,
   auto summary = state.connect_mcp_server(connector_id, error_code, error_message);
   if (!summary) {
     LOG_ERROR << "Failed to connect MCP server " << connector_id << ": " << error_message;
+    if (error_code == "APP-STATE-409") {
+      write_error(req, std::move(cb), drogon::k409Conflict, error_code, "conflict", error_message,
+                  true);
+      return;
+    }
     auto status = error_code == "APP-MCP-404" ? drogon::k404NotFound : drogon::k500InternalServerError;
     write_error(req, std::move(cb), status, error_code, "internal", error_message, true);
     return;
@@ -76,6 +81,11 @@ void disconnect_mcp_server(RuntimeState &state, const drogon::HttpRequestPtr &re
   bool disconnected = state.disconnect_mcp_server(connector_id, error_code, error_message);
   if (!disconnected) {
     LOG_ERROR << "Failed to disconnect MCP server " << connector_id << ": " << error_message;
+    if (error_code == "APP-STATE-409") {
+      write_error(req, std::move(cb), drogon::k409Conflict, error_code, "conflict", error_message,
+                  true);
+      return;
+    }
     auto status = error_code == "APP-MCP-404" ? drogon::k404NotFound : drogon::k500InternalServerError;
     write_error(req, std::move(cb), status, error_code, "internal", error_message, true);
     return;
@@ -11,21 +11,18 @@ void register_model_routes(RuntimeState &runtime_state) {
       "/api/models",
       [&runtime_state](const drogon::HttpRequestPtr &req,
                        std::function<void(const drogon::HttpResponsePtr &)> &&cb) {
-        LOG_INFO << "Listing models";
-        Json::Value body(Json::objectValue);
-        Json::Value models(Json::arrayValue);
-        for (const auto &model : runtime_state.list_models()) {
-          models.append(model_to_json(model));
-        }
-        body["models"] = models;
-        if (const auto active = runtime_state.active_model_id(); active.has_value()) {
-          body["active_model_id"] = *active;
-        } else {
-          body["active_model_id"] = Json::nullValue;
-        }
-
+        const auto snapshot = runtime_state.model_list_snapshot();
         auto resp = drogon::HttpResponse::newHttpResponse();
-        write_json(req, resp, body);
+        resp->addHeader("ETag", snapshot->etag);
+        resp->addHeader("Cache-Control", "no-cache");
+        if (etag_matches(req->getHeader("If-None-Match"), snapshot->etag)) {
+          resp->setStatusCode(drogon::k304NotModified);
+          resp->addHeader("X-Correlation-Id", resolve_correlation_id(req));
+          cb(resp);
+          return;
+        }
+        LOG_DEBUG << "Listing models (generation " << snapshot->generation << ")";
+        write_json_text(req, resp, snapshot->body);
         cb(resp);
       },
       {drogon::Get});
@@ -83,8 +80,8 @@ void register_model_routes(RuntimeState &runtime_state) {
 
         std::string error_code;
         std::string error_message;
-        const auto model = runtime_state.select_model(model_id, context_size, error_code, error_message);
-        if (!model.has_value()) {
+        const auto load = runtime_state.select_model(model_id, context_size, error_code, error_message);
+        if (!load.has_value()) {
           LOG_ERROR << "Failed to select model " << model_id << ": " << error_message;
           auto status = drogon::k409Conflict;
           auto category = std::string("conflict");
@@ -100,12 +97,58 @@ void register_model_routes(RuntimeState &runtime_state) {
           return;
         }
 
+        // The load runs in the background; clients poll the job for progress.
+        Json::Value body(Json::objectValue);
+        body["job"] = model_load_to_json(*load);
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->addHeader("Location", "/api/models/jobs/" + load->id);
+        write_json(req, resp, body, drogon::k202Accepted);
+        cb(resp);
+      },
+      {drogon::Post});
+
+  drogon::app().registerHandler(
+      "/api/models/jobs/{1}",
+      [&runtime_state](const drogon::HttpRequestPtr &req,
+                       std::function<void(const drogon::HttpResponsePtr &)> &&cb,
+                       const std::string &job_id) {
+        const auto load = runtime_state.model_load_status(job_id);
+        if (!load.has_value()) {
+          write_error(req, std::move(cb), drogon::k404NotFound, "APP-JOB-404", "not_found",
+                      "Load job not found", false);
+          return;
+        }
+
         Json::Value body(Json::objectValue);
-        body["active_model"] = model_to_json(*model);
+        body["job"] = model_load_to_json(*load);
         auto resp = drogon::HttpResponse::newHttpResponse();
         write_json(req, resp, body);
         cb(resp);
       },
+      {drogon::Get});
+
+  drogon::app().registerHandler(
+      "/api/models/jobs/{1}/cancel",
+      [&runtime_state](const drogon::HttpRequestPtr &req,
+                       std::function<void(const drogon::HttpResponsePtr &)> &&cb,
+                       const std::string &job_id) {
+        LOG_INFO << "Cancelling load job " << job_id;
+        std::string error_code;
+        std::string error_message;
+        const auto load = runtime_state.cancel_model_load(job_id, error_code, error_message);
+        if (!load.has_value()) {
+          const bool missing = error_code == "APP-JOB-404";
+          write_error(req, std::move(cb), missing ? drogon::k404NotFound : drogon::k409Conflict,
+                      error_code, missing ? "not_found" : "conflict", error_message, false);
+          return;
+        }
+
+        Json::Value body(Json::objectValue);
+        body["job"] = model_load_to_json(*load);
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        write_json(req, resp, body, drogon::k202Accepted);
+        cb(resp);
+      },
       {drogon::Post});
 
   drogon::app().registerHandler(
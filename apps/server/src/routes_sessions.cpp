@@ -0,0 +1,108 @@
+#include "routes.hpp"
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+
+#include "api_parsers.hpp"
+#include "api_serialization.hpp"
+#include "http_helpers.hpp"
+
+namespace {
+
+constexpr int kDefaultSessionLimit = 50;
+constexpr int kMaxSessionLimit = 200;
+
+}  // namespace
+
+void register_session_routes(RuntimeState &runtime_state) {
+  drogon::app().registerHandler(
+      "/api/sessions",
+      [&runtime_state](const drogon::HttpRequestPtr &req,
+                       std::function<void(const drogon::HttpResponsePtr &)> &&cb) {
+        if (req->method() == drogon::Get) {
+          int limit = kDefaultSessionLimit;
+          if (const auto param = req->getParameter("limit"); !param.empty()) {
+            try {
+              limit = std::clamp(std::stoi(param), 1, kMaxSessionLimit);
+            } catch (...) {
+              Json::Value details(Json::objectValue);
+              details["field"] = "limit";
+              write_error(req, std::move(cb), drogon::k400BadRequest, "APP-VAL-001",
+                          "validation", "Query parameter 'limit' must be an integer", false,
+                          details);
+              return;
+            }
+          }
+          Json::Value sessions(Json::arrayValue);
+          for (const auto &session :
+               runtime_state.list_sessions(static_cast<std::size_t>(limit))) {
+            sessions.append(session_summary_to_json(session));
+          }
+          Json::Value body(Json::objectValue);
+          body["sessions"] = sessions;
+          auto resp = drogon::HttpResponse::newHttpResponse();
+          write_json(req, resp, body);
+          cb(resp);
+          return;
+        }
+
+        ParsedSessionCreateRequest parsed;
+        Json::Value details(Json::objectValue);
+        if (const auto parse_error =
+                parse_session_create_request(req->getJsonObject(), parsed, details);
+            parse_error.has_value()) {
+          write_error(req, std::move(cb), drogon::k400BadRequest, "APP-VAL-001",
+                      "validation", *parse_error, false, details);
+          return;
+        }
+
+        std::string error_code;
+        std::string error_message;
+        const auto session = runtime_state.create_session(parsed, error_code, error_message);
+        if (!session.has_value()) {
+          write_error(req, std::move(cb), drogon::k404NotFound, error_code, "not_found",
+                      error_message, false);
+          return;
+        }
+
+        Json::Value body(Json::objectValue);
+        body["session"] = session_summary_to_json(*session);
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        write_json(req, resp, body, drogon::k201Created);
+        cb(resp);
+      },
+      {drogon::Get, drogon::Post});
+
+  drogon::app().registerHandler(
+      "/api/sessions/{1}",
+      [&runtime_state](const drogon::HttpRequestPtr &req,
+                       std::function<void(const drogon::HttpResponsePtr &)> &&cb,
+                       const std::string &session_id) {
+        if (req->method() == drogon::Get) {
+          const auto session = runtime_state.session(session_id);
+          if (!session.has_value()) {
+            write_error(req, std::move(cb), drogon::k404NotFound, "APP-SESSION-404",
+                        "not_found", "Session not found", false);
+            return;
+          }
+          Json::Value body(Json::objectValue);
+          body["session"] = session_to_json(*session);
+          auto resp = drogon::HttpResponse::newHttpResponse();
+          write_json(req, resp, body);
+          cb(resp);
+          return;
+        }
+
+        if (!runtime_state.delete_session(session_id)) {
+          write_error(req, std::move(cb), drogon::k404NotFound, "APP-SESSION-404", "not_found",
+                      "Session not found", false);
+          return;
+        }
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k204NoContent);
+        resp->addHeader("X-Correlation-Id", resolve_correlation_id(req));
+        cb(resp);
+      },
+      {drogon::Get, drogon::Delete});
+}
@@ -1,74 +1,630 @@
 #include "runtime_state.hpp"
 
+#include "api_serialization.hpp"
+
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <filesystem>
+#include <fstream>
+#include <future>
 #include <mutex>
+#include <random>
 #include <unordered_map>
 
-std::string sanitize_model_id(std::string input) {
-  for (char &ch : input) {
-    const auto uch = static_cast<unsigned char>(ch);
-    if (std::isalnum(uch)) {
-      ch = static_cast<char>(std::tolower(uch));
-    } else {
-      ch = '-';
+#include <json/json.h>
+#include <trantor/utils/Logger.h>
+#include <unistd.h>
+
+namespace {
+
+// How often a running generation checks whether its client is still there.
+constexpr auto kCancelPollInterval = std::chrono::milliseconds(20);
+
+// Rough text density used to trim a replayed session transcript to the
+// context window.
+constexpr std::size_t kReplayCharsPerToken = 3;
+
+// How long shutdown waits for running generations to stop before giving up.
+constexpr auto kShutdownWait = std::chrono::seconds(10);
+
+// How long session changes are batched before the writer persists them.
+constexpr auto kSessionFlushDelay = std::chrono::milliseconds(500);
+
+// Conversation of the stateless /api/chat endpoints. It runs in one slot at a
+// time (acquired pinned), so every stateless chat continues it; the model's
+// stateless transcript rebuilds it on a slot that lost it.
+const std::uint64_t kStatelessConversation = conversation_key("", "");
+
+// Reply length cap of every agent.
+constexpr int kMaxTokens = 512;
+
+// Slots running isolated completions. Their context is cleared before and
+// forgotten after every turn, so no request ever continues it. They never run
+// on the slot holding the stateless conversation.
+const std::uint64_t kIsolatedConversation = conversation_key("", "isolated");
+
+// Key of an isolated completion on `resident`. The parameters cover what the
+// server sets; sampling is left to the engine.
+std::string isolated_completion_key(const ResidentAgent &resident,
+                                    const std::string &message) {
+  const auto params = "ctx=" + std::to_string(resident.context_size) +
+                      ";max_tokens=" + std::to_string(kMaxTokens);
+  return completion_cache_key(resident.model_id, kIsolatedConversation, params, message);
+}
+
+// Prepares a slot's context for a turn of conversation `key`: kept when it
+// already holds that conversation, cleared otherwise. Requires slot.mu.
+PrefixCacheUsage enter_conversation(AgentSlot &slot, std::uint64_t key) {
+  auto usage = slot.prefix_cache.lookup(key);
+  if (!usage.hit) {
+    slot.agent->clear_history();
+  }
+  return usage;
+}
+
+// Waits for a turn to finish without blocking in get(), so it can be cancelled
+// once `should_cancel` turns true or the server starts `stopping`; the agent
+// stops at its next token boundary, which releases the slot within a decode
+// step. Returns whether it was cancelled.
+template <typename Handle>
+bool await_turn(zoo::Agent &agent, Handle &handle, const std::function<bool()> &should_cancel,
+                const std::atomic<bool> &stopping) {
+  bool cancel_sent = false;
+  while (handle.future.wait_for(kCancelPollInterval) != std::future_status::ready) {
+    if (!cancel_sent &&
+        (stopping.load(std::memory_order_relaxed) || (should_cancel && should_cancel()))) {
+      LOG_INFO << "Cancelling chat generation";
+      agent.cancel(handle.id);
+      cancel_sent = true;
+    }
+  }
+  return cancel_sent;
+}
+
+// Error of a turn await_turn cancelled.
+void cancelled_error(const std::atomic<bool> &stopping, std::string &error_code,
+                     std::string &error_message) {
+  if (stopping.load(std::memory_order_relaxed)) {
+    error_code = "APP-STATE-503";
+    error_message = "Server is shutting down";
+    return;
+  }
+  error_code = "APP-CANCELLED-499";
+  error_message = "Generation cancelled";
+}
+
+// Transcript characters a replay may carry into `resident`'s context.
+std::size_t replay_chars(const ResidentAgent &resident) {
+  return static_cast<std::size_t>(resident.context_size) * kReplayCharsPerToken;
+}
+
+// The prompt of a stateless turn: the message itself, or on a slot that no
+// longer holds the stateless conversation, its transcript and then the
+// message. Requires slot.mu.
+std::string stateless_prompt(const ResidentAgent &resident, const PrefixCacheUsage &usage,
+                             const std::string &message) {
+  if (usage.hit) {
+    return message;
+  }
+  ChatSession transcript;
+  transcript.messages = resident.stateless_transcript();
+  if (transcript.messages.empty()) {
+    return message;
+  }
+  LOG_INFO << "Rebuilding the stateless conversation of model " << resident.model_id << " ("
+           << transcript.messages.size() << " message(s))";
+  return session_replay_prompt(transcript, message, replay_chars(resident));
+}
+
+// Records a finished turn of conversation `key`. Requires slot.mu.
+void finish_turn(ResidentAgent &resident, AgentSlot &slot, std::uint64_t key,
+                 const zoo::Response &response) {
+  slot.prefix_cache.extend(
+      key, static_cast<std::uint64_t>(std::max(
+               response.usage.prompt_tokens + response.usage.completion_tokens, 0)));
+  resident.admission.record_completion(response.usage.completion_tokens,
+                                      response.metrics.tokens_per_second);
+}
+
+// Locks every slot of `residents` without waiting, for maintenance that runs
+// on an IO thread. Fails (holding nothing) while any slot is generating, so
+// the event loop never waits out a generation.
+std::optional<std::vector<std::unique_lock<std::mutex>>> try_lock_slots(
+    const std::vector<std::shared_ptr<ResidentAgent>> &residents, std::string &error_code,
+    std::string &error_message) {
+  std::vector<std::unique_lock<std::mutex>> locks;
+  for (const auto &resident : residents) {
+    for (const auto &slot : resident->slots) {
+      std::unique_lock<std::mutex> lock(slot->mu, std::try_to_lock);
+      if (!lock.owns_lock()) {
+        error_code = "APP-STATE-409";
+        error_message = "Model '" + resident->model_id +
+                        "' is generating a reply; retry when it finishes";
+        return std::nullopt;
+      }
+      locks.push_back(std::move(lock));
     }
   }
+  return locks;
+}
+
+// Answers a request whose work was refused because the server is stopping.
+std::function<void()> shutting_down(const RuntimeState::ChatCompleteCallback &done) {
+  return [done]() { done(std::nullopt, "APP-STATE-503", "Server is shutting down"); };
+}
+
+std::function<void()> shutting_down(const std::shared_ptr<ChatStreamSink> &sink) {
+  return [sink]() { sink->on_error("APP-STATE-503", "Server is shutting down"); };
+}
+
+// Default context window, capped by the model's trained context length.
+constexpr int kDefaultContextSize = 2048;
+
+// Share of physical memory resident agents may use when no budget is set.
+constexpr double kDefaultResidentRamShare = 0.75;
+
+std::uintmax_t resolve_resident_budget(std::uintmax_t configured) {
+  if (configured > 0) {
+    return configured;
+  }
+  const long pages = sysconf(_SC_PHYS_PAGES);
+  const long page_size = sysconf(_SC_PAGE_SIZE);
+  if (pages <= 0 || page_size <= 0) {
+    // Unknown RAM: keep a single model resident, as before.
+    return 0;
+  }
+  const auto total = static_cast<double>(pages) * static_cast<double>(page_size);
+  return static_cast<std::uintmax_t>(total * kDefaultResidentRamShare);
+}
 
-  const auto first = input.find_first_not_of('-');
-  if (first == std::string::npos) {
-    return "model";
+// The default context window, capped by the trained context when known.
+int default_context_size(const std::optional<GgufMetadata> &metadata) {
+  if (metadata.has_value()) {
+    if (const auto trained = metadata->context_length; trained && *trained > 0) {
+      return static_cast<int>(std::min<std::uint64_t>(kDefaultContextSize, *trained));
+    }
   }
-  const auto last = input.find_last_not_of('-');
-  return input.substr(first, last - first + 1);
+  return kDefaultContextSize;
 }
 
-RuntimeState::RuntimeState(RuntimeConfig config) : config_(std::move(config)) {
+ModelEntry model_from_index(ModelIndexEntry entry) {
+  ModelEntry model;
+  model.id = std::move(entry.id);
+  model.display_name = std::move(entry.display_name);
+  model.path = std::move(entry.path);
+  model.shard_paths = std::move(entry.shard_paths);
+  model.status = entry.missing ? "unavailable" : "available";
+  model.file_size_bytes = entry.file_size_bytes;
+  model.file_mtime_ns = entry.mtime_ns;
+  model.registered = entry.registered;
+  model.load_options = entry.load_options;
+  model.context_size = default_context_size(entry.metadata);
+  model.metadata = std::move(entry.metadata);
+  return model;
+}
+
+// Distinguishes ETags across restarts, when generations start over.
+std::string make_boot_id() {
+  std::random_device rd;
+  std::uniform_int_distribution<std::uint32_t> dist;
+  char buffer[9];
+  std::snprintf(buffer, sizeof(buffer), "%08x", dist(rd));
+  return buffer;
+}
+
+ModelIndexEntry index_from_model(const ModelEntry &model) {
+  ModelIndexEntry entry;
+  entry.id = model.id;
+  entry.display_name = model.display_name;
+  entry.path = model.path;
+  entry.shard_paths = model.shard_paths;
+  entry.file_size_bytes = model.file_size_bytes;
+  entry.mtime_ns = model.file_mtime_ns;
+  entry.registered = model.registered;
+  entry.load_options = model.load_options;
+  entry.metadata = model.metadata;
+  return entry;
+}
+
+}  // namespace
+
+RuntimeState::RuntimeState(RuntimeConfig config)
+    : boot_id_(make_boot_id()),
+      config_(std::move(config)),
+      sessions_(config_.sessions_dir),
+      agents_(resolve_resident_budget(config_.max_resident_bytes)),
+      completion_cache_(config_.completion_cache_bytes),
+      load_jobs_(32, model_list_changes_),
+      loader_(1),
+      executor_(static_cast<std::size_t>(
+          std::max({config_.inference_workers, config_.parallel_sequences, 1}))) {
   auto db_result = zoo::engine::ContextDatabase::open("uploads/memory.db");
   if (db_result) {
     context_db_ = std::move(*db_result);
   }
 
+  if (std::string error_message; !sessions_.load(error_message)) {
+    LOG_WARN << "Starting without saved sessions from " << config_.sessions_dir << ": "
+             << error_message;
+  }
+  sessions_.start_writer(kSessionFlushDelay);
+
 #ifdef ZOO_ENABLE_MCP
   for (const auto& entry : config_.mcp_connectors) {
     mcp_connectors_[entry.id] = entry;
   }
 #endif
 
-  // Auto-discover and pre-register models from configured paths
+  // Start from the persisted index: known files are only re-stat()ed, and the
+  // discovery paths are listed for new ones.
+  std::vector<ModelIndexEntry> indexed;
+  if (!config_.registry_index_path.empty()) {
+    std::string error_message;
+    if (auto loaded = load_model_index(config_.registry_index_path, error_message)) {
+      indexed = std::move(*loaded);
+    } else {
+      LOG_WARN << "Rebuilding model index " << config_.registry_index_path << ": "
+               << error_message;
+    }
+  }
+  const auto scan_started = std::chrono::steady_clock::now();
+  auto scan = rescan_model_index(std::move(indexed), config_.model_discovery_paths,
+                                 config_.discovery, config_.default_load_options);
+  for (const auto &warning : scan.warnings) {
+    LOG_WARN << warning;
+  }
+  for (auto &entry : scan.entries) {
+    auto model = model_from_index(std::move(entry));
+    models_.emplace(model.id, std::move(model));
+  }
+  LOG_INFO << "Model registry: " << models_.size() << " model(s) in "
+           << scan.directories.size() << " director(ies), " << scan.reused << " unchanged, "
+           << scan.reparsed << " (re)read, " << scan.dropped << " dropped in "
+           << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - scan_started)
+                  .count()
+           << " ms";
+  if (scan.changed()) {
+    persist_model_index_locked();
+  }
+
+  if (config_.watch_model_paths && !config_.model_discovery_paths.empty()) {
+    std::string error_message;
+    watcher_ = ModelDirectoryWatcher::start(
+        scan.directories,
+        [this](const ModelFileEvent &event) { on_model_file_event(event); }, error_message);
+    if (watcher_) {
+      LOG_INFO << "Watching " << watcher_->watched_count() << " model director(ies)";
+    } else {
+      LOG_WARN << "Model directory watching disabled: " << error_message;
+    }
+  }
+
+  schedule_startup_loads();
+}
+
+void RuntimeState::schedule_startup_loads() {
+  std::vector<PreloadModel> loads = config_.preload_models;
+
+  // The previously active model is loaded last so it ends up active.
+  std::optional<PreloadModel> restore;
+  if (!config_.state_path.empty()) {
+    std::ifstream file(config_.state_path);
+    Json::Value root;
+    Json::Reader reader;
+    if (file.is_open() && reader.parse(file, root, false) && root.isObject() &&
+        root["active_model_id"].isString()) {
+      restore = PreloadModel{root["active_model_id"].asString(), std::nullopt};
+      if (root["context_size"].isInt()) {
+        restore->context_size = root["context_size"].asInt();
+      }
+    }
+  }
+
+  std::size_t scheduled = 0;
+  const auto schedule = [&](const PreloadModel &entry, bool activate) {
+    std::string error_code;
+    std::string error_message;
+    if (const auto load = start_model_load(entry.model_id, entry.context_size, activate,
+                                           error_code, error_message)) {
+      LOG_INFO << "Startup load of model " << entry.model_id << " scheduled as " << load->id;
+      ++scheduled;
+    } else {
+      LOG_WARN << "Skipping startup load of model " << entry.model_id << ": " << error_message;
+    }
+  };
+  for (const auto &entry : loads) {
+    schedule(entry, false);
+  }
+  if (restore.has_value()) {
+    schedule(*restore, true);
+  }
+
+  if (scheduled == 0) {
+    ready_.store(true, std::memory_order_release);
+    return;
+  }
+  // The loader runs jobs in order, so this runs once every startup load is done.
+  if (!loader_.submit([this]() { finish_startup(); })) {
+    ready_.store(true, std::memory_order_release);
+  }
+}
+
+void RuntimeState::finish_startup() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    // Nothing to restore: serve the first preloaded model that made it.
+    if (!active_model_id_.has_value()) {
+      for (const auto &entry : config_.preload_models) {
+        if (agents_.peek(entry.model_id)) {
+          active_model_id_ = entry.model_id;
+          persist_active_model_locked();
+          touch_model_list();
+          break;
+        }
+      }
+    }
+    LOG_INFO << "Startup preloading finished: " << agents_.entries().size()
+             << " resident model(s), active "
+             << active_model_id_.value_or("none");
+  }
+  ready_.store(true, std::memory_order_release);
+}
+
+void RuntimeState::persist_active_model_locked() const {
+  if (config_.state_path.empty()) {
+    return;
+  }
+  Json::Value root(Json::objectValue);
+  root["active_model_id"] = Json::nullValue;
+  if (active_model_id_.has_value()) {
+    root["active_model_id"] = *active_model_id_;
+    if (const auto resident = agents_.peek(*active_model_id_)) {
+      root["context_size"] = resident->context_size;
+    }
+  }
+
+  // Write-then-rename so a crash never leaves a truncated file behind.
+  const std::string tmp_path = config_.state_path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    if (!out.is_open()) {
+      LOG_WARN << "Failed to persist active model to " << config_.state_path;
+      return;
+    }
+    Json::StreamWriterBuilder builder;
+    out << Json::writeString(builder, root);
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, config_.state_path, ec);
+  if (ec) {
+    LOG_WARN << "Failed to persist active model to " << config_.state_path << ": "
+             << ec.message();
+  }
+}
+
+void RuntimeState::persist_model_index_locked() const {
+  if (config_.registry_index_path.empty()) {
+    return;
+  }
+  std::vector<ModelIndexEntry> entries;
+  entries.reserve(models_.size());
+  for (const auto &item : models_) {
+    entries.push_back(index_from_model(item.second));
+  }
+  std::string error_message;
+  if (!save_model_index(config_.registry_index_path, entries, error_message)) {
+    LOG_WARN << "Failed to persist model index to " << config_.registry_index_path << ": "
+             << error_message;
+  }
+}
+
+ModelEntry *RuntimeState::find_model_by_path_locked(const std::string &path) {
+  const auto key = model_path_key(path);
+  for (auto &item : models_) {
+    if (model_path_key(item.second.path) == key) {
+      return &item.second;
+    }
+  }
+  return nullptr;
+}
+
+void RuntimeState::on_model_file_event(const ModelFileEvent &event) {
+  switch (event.kind) {
+    case ModelFileEventKind::kWritten:
+    case ModelFileEventKind::kRemoved:
+      // A shard changes a whole split set; let the walk regroup it.
+      if (parse_shard_name(event.path).has_value()) {
+        rescan_models();
+      } else if (event.kind == ModelFileEventKind::kWritten) {
+        refresh_model_file(event.path);
+      } else {
+        remove_model_file(event.path);
+      }
+      break;
+    case ModelFileEventKind::kOverflow:
+      rescan_models();
+      break;
+  }
+}
+
+void RuntimeState::refresh_model_file(const std::string &path) {
   namespace fs = std::filesystem;
-  for (const auto& dir_str : config_.model_discovery_paths) {
-    const fs::path dir_path(dir_str);
-    if (!fs::exists(dir_path) || !fs::is_directory(dir_path)) continue;
-    for (const auto& entry : fs::directory_iterator(dir_path)) {
-      if (!entry.is_regular_file()) continue;
-      if (entry.path().extension() != ".gguf") continue;
-      std::string id = sanitize_model_id(entry.path().stem().string());
-      if (id.empty()) id = "model";
-      if (models_.contains(id) && models_[id].path != entry.path().string()) {
-        int suffix = 2;
-        std::string base = id;
-        do { id = base + "-" + std::to_string(suffix++); } while (models_.contains(id));
+  std::error_code ec;
+  const auto size = fs::file_size(path, ec);
+  if (ec) {
+    return;
+  }
+  const auto mtime = model_file_mtime_ns(path);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    const auto *known = find_model_by_path_locked(path);
+    if (known == nullptr &&
+        !is_discoverable(path, config_.model_discovery_paths, config_.discovery)) {
+      return;
+    }
+    if (known && known->status == "available" && known->file_size_bytes == size &&
+        known->file_mtime_ns == mtime) {
+      return;
+    }
+  }
+
+  // The header is read outside mu_; it may sit on slow storage.
+  std::string error_message;
+  auto metadata = read_gguf_metadata(path, error_message);
+  if (!metadata) {
+    LOG_WARN << "Could not read GGUF metadata from " << path << ": " << error_message;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  auto *model = find_model_by_path_locked(path);
+  if (model == nullptr) {
+    ModelEntry added;
+    added.id = allocate_model_id(path, [this](const std::string &id) {
+      return models_.contains(id);
+    });
+    added.display_name = fs::path(path).filename().string();
+    added.path = path;
+    added.load_options = config_.default_load_options;
+    model = &models_.emplace(added.id, std::move(added)).first->second;
+    LOG_INFO << "Discovered model " << model->id << " at " << path;
+  } else {
+    LOG_INFO << "Model file for " << model->id << " changed";
+  }
+  model->status = "available";
+  model->file_size_bytes = size;
+  model->file_mtime_ns = mtime;
+  model->context_size = default_context_size(metadata);
+  model->metadata = std::move(metadata);
+  persist_model_index_locked();
+  touch_model_list();
+}
+
+void RuntimeState::remove_model_file(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto *model = find_model_by_path_locked(path);
+  if (model == nullptr) {
+    return;
+  }
+  // Registered, resident or loading models stay listed as unavailable; a
+  // resident agent keeps its own mapping of the deleted file.
+  const auto job = load_jobs_.latest_for(model->id);
+  if (model->registered || agents_.peek(model->id) || (job && !job->finished())) {
+    model->status = "unavailable";
+    LOG_INFO << "Model file for " << model->id << " is gone; marked unavailable";
+  } else {
+    LOG_INFO << "Model file for " << model->id << " is gone; removed from the registry";
+    models_.erase(model->id);
+  }
+  persist_model_index_locked();
+  touch_model_list();
+}
+
+void RuntimeState::rescan_models() {
+  std::vector<ModelIndexEntry> indexed;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    indexed.reserve(models_.size());
+    for (const auto &item : models_) {
+      indexed.push_back(index_from_model(item.second));
+    }
+  }
+  auto scan = rescan_model_index(indexed, config_.model_discovery_paths, config_.discovery,
+                                 config_.default_load_options);
+  for (const auto &warning : scan.warnings) {
+    LOG_WARN << warning;
+  }
+  if (watcher_) {
+    watcher_->add_directories(scan.directories);
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  std::unordered_map<std::string, ModelEntry> rebuilt;
+  for (auto &entry : scan.entries) {
+    auto model = model_from_index(std::move(entry));
+    rebuilt.emplace(model.id, std::move(model));
+  }
+  // Keep what the scan could not know about: entries registered while it ran
+  // and resident models whose file has gone.
+  for (auto &item : models_) {
+    if (rebuilt.contains(item.first)) {
+      continue;
+    }
+    const bool added_since = std::none_of(indexed.begin(), indexed.end(), [&](const auto &e) {
+      return e.id == item.first;
+    });
+    if (added_since || agents_.peek(item.first)) {
+      if (!added_since) {
+        item.second.status = "unavailable";
       }
-      ModelEntry model;
-      model.id = id;
-      model.display_name = entry.path().filename().string();
-      model.path = entry.path().string();
-      model.status = "available";
-      model.file_size_bytes = entry.file_size();
-      models_[model.id] = model;
+      rebuilt.emplace(item.first, std::move(item.second));
     }
   }
+  models_ = std::move(rebuilt);
+  LOG_INFO << "Rescanned model directories: " << models_.size() << " model(s)";
+  persist_model_index_locked();
+  touch_model_list();
 }
 
 std::vector<ModelEntry> RuntimeState::list_models() const {
   std::lock_guard<std::mutex> lock(mu_);
+  return list_models_locked();
+}
+
+std::shared_ptr<const ModelListSnapshot> RuntimeState::model_list_snapshot() const {
+  auto snapshot = model_list_snapshot_.load(std::memory_order_acquire);
+  if (snapshot && snapshot->source_version == model_list_changes_->load(std::memory_order_acquire)) {
+    return snapshot;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  // Read before building: a change racing the build leaves the snapshot
+  // labelled stale, so the next call rebuilds it.
+  const auto version = model_list_changes_->load(std::memory_order_acquire);
+  snapshot = model_list_snapshot_.load(std::memory_order_acquire);
+  if (snapshot && snapshot->source_version == version) {
+    return snapshot;
+  }
+  auto fresh = std::make_shared<ModelListSnapshot>();
+  fresh->source_version = version;
+  fresh->body = serialize_json(
+      model_list_to_json(list_models_locked(), active_model_id_, draining_model_ids_locked()));
+  if (snapshot && snapshot->body == fresh->body) {
+    fresh->generation = snapshot->generation;
+    fresh->etag = snapshot->etag;
+  } else {
+    fresh->generation = snapshot ? snapshot->generation + 1 : 1;
+    fresh->etag = "\"" + boot_id_ + "-" + std::to_string(fresh->generation) + "\"";
+  }
+  std::shared_ptr<const ModelListSnapshot> published = std::move(fresh);
+  model_list_snapshot_.store(published, std::memory_order_release);
+  return published;
+}
+
+std::vector<ModelEntry> RuntimeState::list_models_locked() const {
   std::vector<ModelEntry> out;
   out.reserve(models_.size());
   for (const auto &item : models_) {
     auto model = item.second;
-    model.status = std::filesystem::exists(model.path) ? "available" : "unavailable";
+    const auto resident = agents_.peek(model.id);
+    model.resident = resident != nullptr;
+    model.parallel_sequences =
+        resident ? static_cast<int>(resident->slots.size()) : config_.parallel_sequences;
+    if (model.resident) {
+      model.status = "ready";
+    }
+    if (const auto job = load_jobs_.latest_for(model.id)) {
+      const auto load = job->status();
+      model.load_job_id = load.id;
+      if (load.state == "loading") {
+        model.status = "loading";
+        model.load_progress_percent = load.progress_percent;
+      } else if (load.state == "failed" && !model.resident) {
+        model.status = "failed";
+      }
+    }
     out.push_back(std::move(model));
   }
   std::sort(out.begin(), out.end(), [](const ModelEntry &a, const ModelEntry &b) {
@@ -88,17 +644,7 @@ std::optional<ModelEntry> RuntimeState::register_model(
   namespace fs = std::filesystem;
   const fs::path model_path = fs::path(req.path).lexically_normal();
 
-  bool is_allowed_path = false;
-  for (const auto& allowed_dir : config_.model_discovery_paths) {
-    fs::path norm_dir = fs::absolute(fs::path(allowed_dir)).lexically_normal();
-    fs::path abs_model_path = fs::absolute(model_path).lexically_normal();
-    if (abs_model_path.string().rfind(norm_dir.string(), 0) == 0) {
-      is_allowed_path = true;
-      break;
-    }
-  }
-
-  if (!is_allowed_path) {
+  if (!is_within_model_dirs(model_path.string(), config_.model_discovery_paths)) {
     error_code = "APP-SEC-403";
     error_message = "Model path is not within an allowed directory";
     return std::nullopt;
@@ -110,36 +656,72 @@ std::optional<ModelEntry> RuntimeState::register_model(
     return std::nullopt;
   }
 
-  const std::string display_name = req.display_name.value_or(model_path.filename().string());
-  std::string id = sanitize_model_id(model_path.stem().string());
-  if (id.empty()) {
-    id = "model";
+  // Split models are registered by their first shard and listed as one.
+  std::vector<std::string> shard_paths;
+  if (parse_shard_name(model_path.string()).has_value()) {
+    const auto set = find_shard_set(model_path.string(), error_message);
+    if (!set.has_value()) {
+      error_code = "APP-VAL-001";
+      return std::nullopt;
+    }
+    shard_paths = set->shard_paths;
   }
-
-  std::lock_guard<std::mutex> lock(mu_);
-  if (models_.contains(id) && models_[id].path != model_path.string()) {
-    int suffix = 2;
-    std::string base = id;
-    do {
-      id = base + "-" + std::to_string(suffix++);
-    } while (models_.contains(id));
+  const std::string display_name = req.display_name.value_or(
+      fs::path(logical_model_path(model_path.string())).filename().string());
+  std::uintmax_t size_bytes = 0;
+  std::int64_t mtime_ns = 0;
+  const auto files = shard_paths.empty() ? std::vector<std::string>{model_path.string()}
+                                         : shard_paths;
+  stat_model_files(files, size_bytes, mtime_ns);
+  std::string metadata_error;
+  auto metadata = read_gguf_metadata(files, metadata_error);
+  if (!metadata) {
+    LOG_WARN << "Could not read GGUF metadata from " << model_path.string() << ": "
+             << metadata_error;
   }
 
+  std::lock_guard<std::mutex> lock(mu_);
+  // Re-registering a known file keeps its id (and its load options unless
+  // new ones are given).
   ModelEntry model;
-  model.id = id;
+  if (const auto *existing = find_model_by_path_locked(model_path.string())) {
+    model.id = existing->id;
+    model.load_options = existing->load_options;
+  } else {
+    model.id = allocate_model_id(logical_model_path(model_path.string()),
+                                 [this](const std::string &id) { return models_.contains(id); });
+    model.load_options = config_.default_load_options;
+  }
   model.display_name = display_name;
   model.path = model_path.string();
+  model.shard_paths = std::move(shard_paths);
   model.status = "available";
-  model.file_size_bytes = fs::file_size(model_path);
+  model.file_size_bytes = size_bytes;
+  model.file_mtime_ns = mtime_ns;
+  model.registered = true;
+  model.context_size = default_context_size(metadata);
+  model.metadata = std::move(metadata);
+  if (req.load_options.has_value()) {
+    model.load_options = *req.load_options;
+  }
   models_[model.id] = model;
+  persist_model_index_locked();
+  touch_model_list();
   return model;
 }
 
-std::optional<ModelEntry> RuntimeState::select_model(const std::string &model_id,
-                                                     std::optional<int> context_size_override,
-                                                     std::string &error_code,
-                                                     std::string &error_message) {
+std::optional<ModelLoadStatus> RuntimeState::select_model(
+    const std::string &model_id, std::optional<int> context_size_override,
+    std::string &error_code, std::string &error_message) {
+  return start_model_load(model_id, context_size_override, /*activate=*/true, error_code,
+                          error_message);
+}
+
+std::optional<ModelLoadStatus> RuntimeState::start_model_load(
+    const std::string &model_id, std::optional<int> context_size_override, bool activate,
+    std::string &error_code, std::string &error_message) {
   ModelEntry selected;
+  std::shared_ptr<ModelLoadJob> job;
   {
     std::lock_guard<std::mutex> lock(mu_);
     const auto it = models_.find(model_id);
@@ -149,134 +731,729 @@ std::optional<ModelEntry> RuntimeState::select_model(const std::string &model_id
       return std::nullopt;
     }
     selected = it->second;
+    const int ctx_size = context_size_override.value_or(selected.context_size);
+
+    // Switching back to a resident model is just a pointer swap.
+    const auto resident = agents_.get(model_id);
+    if (resident && (!context_size_override.has_value() ||
+                     *context_size_override == resident->context_size)) {
+      job = load_jobs_.create(selected.id, resident->context_size, selected.file_size_bytes);
+      if (activate) {
+        active_model_id_ = selected.id;
+        job->request_activation();
+        persist_active_model_locked();
+        touch_model_list();
+      }
+      job->add_bytes_loaded(selected.file_size_bytes);
+      job->finish("ready");
+      return job->status();
+    }
+
+    // A second select for a model that is already loading joins that job.
+    if (const auto pending = load_jobs_.latest_for(model_id);
+        pending && !pending->finished() && !pending->cancel_requested() &&
+        pending->context_size == ctx_size) {
+      if (activate) {
+        pending->request_activation();
+      }
+      return pending->status();
+    }
+
+    if (!std::filesystem::exists(selected.path)) {
+      error_code = "APP-VAL-001";
+      error_message = "Model path is no longer available";
+      return std::nullopt;
+    }
+    job = load_jobs_.create(selected.id, ctx_size, selected.file_size_bytes);
+    if (activate) {
+      job->request_activation();
+    }
   }
 
-  if (!std::filesystem::exists(selected.path)) {
-    error_code = "APP-VAL-001";
-    error_message = "Model path is no longer available";
-    return std::nullopt;
+  LOG_INFO << "Queued load job " << job->id << " for model " << selected.id;
+  if (!loader_.submit([this, job, selected]() { run_model_load(job, selected); })) {
+    job->finish("failed", "APP-STATE-503", "Server is shutting down");
   }
+  return job->status();
+}
 
-  const int ctx_size = context_size_override.value_or(selected.context_size);
+void RuntimeState::run_model_load(const std::shared_ptr<ModelLoadJob> &job,
+                                  const ModelEntry &model) {
+  const auto fail = [&job](const std::string &code, const std::string &message) {
+    LOG_ERROR << "Load job " << job->id << " for model " << job->model_id
+              << " failed: " << message;
+    job->finish("failed", code, message);
+  };
+  const auto cancelled = [&job]() {
+    if (!job->cancel_requested()) {
+      return false;
+    }
+    LOG_INFO << "Load job " << job->id << " cancelled";
+    job->finish("cancelled", "APP-CANCELLED-499", "Model load cancelled");
+    return true;
+  };
+
+  using Clock = std::chrono::steady_clock;
+  auto step_started = Clock::now();
+  const auto finish_step = [&job, &step_started](const std::string &step) {
+    const auto now = Clock::now();
+    job->record_timing(
+        step, std::chrono::duration_cast<std::chrono::milliseconds>(now - step_started).count());
+    step_started = now;
+  };
 
+  job->set_phase("reading");
+  std::string error_message;
+  const auto files =
+      model.shard_paths.empty() ? std::vector<std::string>{model.path} : model.shard_paths;
+  for (const auto &file : files) {
+    const auto on_prefetch = [&job, reported = std::uintmax_t{0}](std::uintmax_t bytes) mutable {
+      job->add_bytes_loaded(bytes - reported);
+      reported = bytes;
+      return !job->cancel_requested();
+    };
+    if (!prefetch_model_file(file, model.load_options.prefetch, on_prefetch, error_message)) {
+      if (!cancelled()) {
+        fail("APP-VAL-001", error_message);
+      }
+      return;
+    }
+  }
+  finish_step("prefetch");
+  if (cancelled()) {
+    return;
+  }
+
+  std::vector<std::unique_ptr<PinnedMapping>> pinned_weights;
+  if (model.load_options.mlock) {
+    job->set_phase("mapping");
+    for (const auto &file : files) {
+      auto pinned = PinnedMapping::pin(file, error_message);
+      if (!pinned) {
+        // Not fatal: the model still works, it just may be paged out.
+        LOG_WARN << "Load job " << job->id << ": " << error_message
+                 << "; continuing without mlock";
+        pinned_weights.clear();
+        break;
+      }
+      pinned_weights.push_back(std::move(pinned));
+    }
+    finish_step("mapping");
+  }
+
+  const int ctx_size = job->context_size;
+  const int sequences = std::max(config_.parallel_sequences, 1);
+  const auto estimated_bytes = estimate_resident_bytes(
+      model.file_size_bytes, ctx_size,
+      model.metadata ? model.metadata->kv_bytes_per_token() : std::nullopt, sequences);
+  std::vector<std::shared_ptr<ResidentAgent>> evicted;
+  {
+    // Evict idle residents before creating the agent so the budget bounds the
+    // peak, but keep the active model (and the one being reloaded) serving
+    // until the new agent is ready: blue/green may briefly exceed the budget.
+    std::lock_guard<std::mutex> lock(mu_);
+    std::vector<std::string> pinned = {model.id};
+    if (active_model_id_.has_value()) {
+      pinned.push_back(*active_model_id_);
+    }
+    evicted = retire_locked(agents_.make_room(estimated_bytes, pinned));
+  }
+  // Agents with in-flight work stay alive until their reservations drain.
+  evicted.clear();
+
+  job->set_phase("initializing");
   zoo::Config config;
-  config.model_path = selected.path;
+  config.model_path = model.path;
   config.context_size = ctx_size;
-  config.max_tokens = 512;
+  config.max_tokens = kMaxTokens;
 
-  auto created = zoo::Agent::create(config);
-  if (!created) {
-    error_code = "APP-UPSTREAM-001";
-    error_message = created.error().to_string();
-    return std::nullopt;
+  // One agent per sequence, each a full load (counted so in estimated_bytes).
+  std::vector<std::shared_ptr<zoo::Agent>> loaded;
+  for (int i = 0; i < sequences && !job->cancel_requested(); ++i) {
+    auto created = zoo::Agent::create(config);
+    if (!created) {
+      if (loaded.empty()) {
+        fail("APP-UPSTREAM-001", created.error().to_string());
+        return;
+      }
+      LOG_WARN << "Load job " << job->id << ": context " << i + 1 << " of " << sequences
+               << " failed (" << created.error().to_string() << "); serving with " << i;
+      break;
+    }
+    loaded.push_back(std::shared_ptr<zoo::Agent>(std::move(*created)));
   }
-
-  std::shared_ptr<zoo::Agent> loaded = std::shared_ptr<zoo::Agent>(std::move(*created));
-  
-  if (context_db_) {
-    loaded->set_context_database(context_db_);
+  if (cancelled()) {
+    return;
+  }
+  finish_step("init");
+  if (!config_.warmup_prompt.empty() && !job->cancel_requested()) {
+    job->set_phase("warming");
+    for (const auto &agent : loaded) {
+      warm_up(*agent, *job);
+    }
+    finish_step("warmup");
+  }
+  if (cancelled()) {
+    return;
   }
 
   {
+    // Cut over: new requests route to the new agent from here on, while the
+    // reservations held by requests admitted earlier keep the old one alive
+    // until they drain.
     std::lock_guard<std::mutex> lock(mu_);
-    agent_ = std::move(loaded);
-    active_model_id_ = selected.id;
+    if (context_db_) {
+      for (const auto &agent : loaded) {
+        agent->set_context_database(context_db_);
+      }
+    }
+    std::vector<std::shared_ptr<ResidentAgent>> retired;
+    auto resident = std::make_shared<ResidentAgent>(
+        model.id, std::move(loaded), ctx_size, estimated_bytes,
+        static_cast<std::size_t>(std::max(config_.max_queued_requests, 0)));
+    resident->pinned_weights = std::move(pinned_weights);
+    resident->on_released = [changes = model_list_changes_]() {
+      changes->fetch_add(1, std::memory_order_release);
+    };
+    if (auto replaced = agents_.insert(std::move(resident))) {
+      retired.push_back(std::move(replaced));
+    }
+    if (job->activate()) {
+      active_model_id_ = model.id;
+      persist_active_model_locked();
+    }
+    for (auto &victim : agents_.make_room(0, {model.id, active_model_id_.value_or(model.id)})) {
+      retired.push_back(std::move(victim));
+    }
+    evicted = retire_locked(std::move(retired));
+    // Finished under mu_ so a select joining this job either sees it pending
+    // (and is honoured above) or finds the model resident.
+    job->finish("ready");
+  }
+  evicted.clear();
+  LOG_INFO << "Load job " << job->id << ": model " << model.id << " ready in "
+           << job->status().elapsed_ms << " ms";
+}
+
+void RuntimeState::warm_up(zoo::Agent &agent, const ModelLoadJob &job) {
+  // One prompt evaluation touches every weight and sizes the compute buffers;
+  // generation is cut short after the first token.
+  const auto started = std::chrono::steady_clock::now();
+  std::atomic<bool> got_token{false};
+  auto handle = agent.chat(zoo::Message::user(config_.warmup_prompt),
+                           [&got_token](std::string_view) { got_token.store(true); });
+  bool cancel_sent = false;
+  while (handle.future.wait_for(kCancelPollInterval) != std::future_status::ready) {
+    if (!cancel_sent && (got_token.load() || job.cancel_requested())) {
+      agent.cancel(handle.id);
+      cancel_sent = true;
+    }
+  }
+  const auto result = handle.future.get();
+  agent.clear_history();
+  if (!result && !cancel_sent) {
+    LOG_WARN << "Warm-up of model " << job.model_id << " failed: " << result.error().to_string();
+    return;
+  }
+  LOG_INFO << "Warmed up model " << job.model_id << " in "
+           << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - started)
+                  .count()
+           << " ms";
+}
+
+std::optional<ModelLoadStatus> RuntimeState::model_load_status(const std::string &job_id) const {
+  const auto job = load_jobs_.find(job_id);
+  if (!job) {
+    return std::nullopt;
+  }
+  return job->status();
+}
+
+std::optional<ModelLoadStatus> RuntimeState::cancel_model_load(const std::string &job_id,
+                                                               std::string &error_code,
+                                                               std::string &error_message) {
+  const auto job = load_jobs_.find(job_id);
+  if (!job) {
+    error_code = "APP-JOB-404";
+    error_message = "Load job not found";
+    return std::nullopt;
+  }
+  if (job->finished()) {
+    error_code = "APP-STATE-409";
+    error_message = "Load job has already finished";
+    return std::nullopt;
   }
-  return selected;
+  job->request_cancel();
+  return job->status();
 }
 
-std::optional<zoo::Response> RuntimeState::chat_complete(const std::string &message,
-                                                         std::string &error_code,
-                                                         std::string &error_message) {
-  std::shared_ptr<zoo::Agent> agent;
+std::optional<ChatReservation> RuntimeState::admit_chat(
+    const std::optional<std::string> &model_id, std::string &error_code,
+    std::string &error_message, int &retry_after_seconds) {
+  std::shared_ptr<ResidentAgent> resident;
   {
     std::lock_guard<std::mutex> lock(mu_);
-    agent = agent_;
+    if (model_id.has_value()) {
+      if (!models_.contains(*model_id)) {
+        error_code = "APP-MOD-404";
+        error_message = "Model not found";
+        return std::nullopt;
+      }
+      resident = agents_.get(*model_id);
+      if (!resident) {
+        error_code = "APP-STATE-409";
+        error_message = "Model '" + *model_id + "' is not loaded";
+        return std::nullopt;
+      }
+    } else {
+      if (active_model_id_.has_value()) {
+        resident = agents_.get(*active_model_id_);
+      }
+      if (!resident) {
+        error_code = "APP-STATE-409";
+        error_message = "No active model is loaded";
+        return std::nullopt;
+      }
+    }
   }
-  if (!agent) {
-    error_code = "APP-STATE-409";
-    error_message = "No active model is loaded";
+
+  auto ticket = resident->admission.try_admit();
+  if (!ticket) {
+    error_code = "APP-RATE-429";
+    error_message = "Inference queue is full (" +
+                    std::to_string(resident->admission.max_queued()) + " waiting requests)";
+    retry_after_seconds = resident->admission.estimate_wait_seconds();
     return std::nullopt;
   }
+  return ChatReservation{std::move(resident), std::move(ticket)};
+}
 
-  std::lock_guard<std::mutex> agent_lock(agent_mu_);
-  auto handle = agent->chat(zoo::Message::user(message));
+std::optional<ChatResult> RuntimeState::chat_complete(ResidentAgent &resident,
+                                                      const std::string &message, bool isolated,
+                                                      std::string &error_code,
+                                                      std::string &error_message) {
+  const auto lease = isolated ? resident.acquire_slot(kIsolatedConversation, false,
+                                                     kStatelessConversation)
+                              : resident.acquire_slot(kStatelessConversation, true);
+  const auto key = isolated ? kIsolatedConversation : kStatelessConversation;
+  auto &slot = lease.slot();
+  std::lock_guard<std::mutex> agent_lock(slot.mu);
+  if (isolated) {
+    slot.prefix_cache.invalidate();  // Never continue an earlier isolated turn
+  }
+  const auto usage = enter_conversation(slot, key);
+  const auto prompt = isolated ? message : stateless_prompt(resident, usage, message);
+  auto handle = slot.agent->chat(zoo::Message::user(prompt));
+  const bool cancelled = await_turn(*slot.agent, handle, {}, stopping_);
   auto result = handle.future.get();
+  if (cancelled || !result) {
+    slot.prefix_cache.invalidate();
+  }
+  if (cancelled) {
+    cancelled_error(stopping_, error_code, error_message);
+    return std::nullopt;
+  }
   if (!result) {
     error_code = "APP-UPSTREAM-001";
     error_message = result.error().to_string();
     return std::nullopt;
   }
-  return *result;
+  finish_turn(resident, slot, key, *result);
+  if (!isolated) {
+    resident.record_stateless_turn(message, result->text, replay_chars(resident));
+    return ChatResult{*result, usage, {}};
+  }
+  slot.prefix_cache.invalidate();
+  if (!completion_cache_.enabled()) {
+    return ChatResult{*result, usage, {}};
+  }
+  {
+    // A retired resident still finishes the turns it drains; its replies must
+    // not outlive erase_model() and answer for a reload of the same id.
+    std::lock_guard<std::mutex> lock(mu_);
+    if (agents_.peek(resident.model_id).get() == &resident) {
+      completion_cache_.insert(isolated_completion_key(resident, message), *result);
+    }
+  }
+  return ChatResult{*result, usage, "miss"};
+}
+
+void RuntimeState::chat_complete_async(ChatReservation reservation, std::string message,
+                                       bool isolated, ChatCompleteCallback done) {
+  if (isolated && reservation.resident->slots.size() < 2) {
+    // The only context holds the stateless conversation, which an isolated
+    // turn must not evict.
+    done(std::nullopt, "APP-STATE-409",
+         "Isolated completions need a second context; set runtime.parallel_sequences to 2 "
+         "or more");
+    return;
+  }
+  if (isolated && completion_cache_.enabled()) {
+    const auto started = std::chrono::steady_clock::now();
+    auto cached =
+        completion_cache_.find(isolated_completion_key(*reservation.resident, message));
+    if (cached.has_value()) {
+      // Timings describe this request; usage still describes the reply.
+      const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - started);
+      cached->metrics.latency_ms = elapsed;
+      cached->metrics.time_to_first_token_ms = elapsed;
+      done(ChatResult{std::move(*cached), {}, "hit"}, {}, {});
+      return;
+    }
+  }
+
+  auto &admission = reservation.resident->admission;
+  const auto &queued_ticket = *reservation.ticket;
+  admission.dispatch(queued_ticket, {}, [this, reservation = std::move(reservation),
+                                         message = std::move(message), isolated,
+                                         done]() mutable {
+    // The reservation rides along with the job so the agent stays reserved
+    // (and alive) until the response has been handed back.
+    auto job = [this, reservation = std::move(reservation), message = std::move(message),
+                isolated, done]() {
+      std::string error_code;
+      std::string error_message;
+      auto response = chat_complete(*reservation.resident, message, isolated, error_code,
+                                    error_message);
+      done(std::move(response), error_code, error_message);
+    };
+    executor_.submit(std::move(job), shutting_down(done));
+  }, shutting_down(done));
 }
 
-std::optional<zoo::Response> RuntimeState::chat_stream(
+std::optional<ChatResult> RuntimeState::chat_stream(
+    ResidentAgent &resident,
     const std::string &message,
     std::function<void(std::string_view)> token_callback,
+    std::function<bool()> should_cancel,
     std::string &error_code,
     std::string &error_message) {
-  std::shared_ptr<zoo::Agent> agent;
-  {
-    std::lock_guard<std::mutex> lock(mu_);
-    agent = agent_;
+  const auto lease = resident.acquire_slot(kStatelessConversation, true);
+  auto &slot = lease.slot();
+  const auto &agent = slot.agent;
+  std::lock_guard<std::mutex> agent_lock(slot.mu);
+  const auto usage = enter_conversation(slot, kStatelessConversation);
+  auto handle = agent->chat(zoo::Message::user(stateless_prompt(resident, usage, message)),
+                            std::move(token_callback));
+  const bool cancelled = await_turn(*agent, handle, should_cancel, stopping_);
+
+  auto result = handle.future.get();
+  if (cancelled || !result) {
+    // A cut-short turn leaves the history in an unknown state. Only that turn
+    // is lost: the next stateless turn clears the context and replays the
+    // transcript, which holds finished turns only.
+    slot.prefix_cache.invalidate();
   }
-  if (!agent) {
-    error_code = "APP-STATE-409";
-    error_message = "No active model is loaded";
+  if (cancelled) {
+    cancelled_error(stopping_, error_code, error_message);
     return std::nullopt;
   }
-
-  std::lock_guard<std::mutex> agent_lock(agent_mu_);
-  auto handle = agent->chat(zoo::Message::user(message), std::move(token_callback));
-  auto result = handle.future.get();
   if (!result) {
     error_code = "APP-UPSTREAM-001";
     error_message = result.error().to_string();
     return std::nullopt;
   }
-  return *result;
+  finish_turn(resident, slot, kStatelessConversation, *result);
+  resident.record_stateless_turn(message, result->text, replay_chars(resident));
+  return ChatResult{*result, usage, {}};
+}
+
+void RuntimeState::chat_stream_async(ChatReservation reservation, std::string message,
+                                     std::shared_ptr<ChatStreamSink> sink) {
+  stream_async(std::move(reservation), std::move(sink),
+               [this, message = std::move(message)](
+                   ResidentAgent &resident, std::function<void(std::string_view)> token_callback,
+                   std::function<bool()> should_cancel, std::string &error_code,
+                   std::string &error_message) {
+                 return chat_stream(resident, message, std::move(token_callback),
+                                    std::move(should_cancel), error_code, error_message);
+               });
+}
+
+void RuntimeState::stream_async(ChatReservation reservation, std::shared_ptr<ChatStreamSink> sink,
+                                StreamTurn turn) {
+  // The position callback lives inside this queue, so a raw pointer is safe.
+  auto *admission = &reservation.resident->admission;
+  const auto &queued_ticket = *reservation.ticket;
+  const auto ticket_id = queued_ticket.id();
+  admission->dispatch(
+      queued_ticket,
+      [admission, sink, ticket_id](std::size_t position) {
+        // Position updates double as liveness probes while waiting.
+        sink->on_queued(position);
+        if (sink->cancelled()) {
+          admission->withdraw(ticket_id);
+        }
+      },
+      [this, reservation = std::move(reservation), turn = std::move(turn),
+       sink]() mutable {
+        auto job = [reservation = std::move(reservation), turn = std::move(turn), sink]() {
+          sink->on_started();
+          if (sink->cancelled()) {
+            LOG_INFO << "Skipping chat request " << reservation.ticket->id()
+                     << ": cancelled while queued";
+            return;
+          }
+          std::string error_code;
+          std::string error_message;
+          const auto result = turn(
+              *reservation.resident, [&sink](std::string_view token) { sink->on_token(token); },
+              [&sink]() {
+                sink->on_tick();
+                return sink->cancelled();
+              },
+              error_code, error_message);
+          if (!result) {
+            sink->on_error(error_code, error_message);
+            return;
+          }
+          sink->on_done(*result);
+        };
+        executor_.submit(std::move(job), shutting_down(sink));
+      },
+      shutting_down(sink));
+}
+
+std::vector<std::shared_ptr<ResidentAgent>> RuntimeState::retire_locked(
+    std::vector<std::shared_ptr<ResidentAgent>> residents) {
+  std::erase_if(retired_, [](const auto &weak) { return weak.expired(); });
+  for (const auto &resident : residents) {
+    LOG_INFO << "Retiring resident model " << resident->model_id << " ("
+             << resident->admission.queued() << " queued; " << agents_.used_bytes() << " of "
+             << agents_.budget_bytes() << " bytes in use)";
+    retired_.push_back(resident);
+    // A later load of the id may be another file or context size.
+    completion_cache_.erase_model(resident->model_id);
+  }
+  touch_model_list();
+  return residents;
+}
+
+std::vector<std::string> RuntimeState::draining_model_ids() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return draining_model_ids_locked();
+}
+
+std::vector<std::string> RuntimeState::draining_model_ids_locked() const {
+  std::vector<std::string> out;
+  for (const auto &weak : retired_) {
+    // Residents still referenced by in-flight requests; cache hits are live.
+    if (const auto resident = weak.lock(); resident && agents_.peek(resident->model_id) != resident) {
+      out.push_back(resident->model_id);
+    }
+  }
+  return out;
+}
+
+std::shared_ptr<ResidentAgent> RuntimeState::active_resident() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!active_model_id_.has_value()) {
+    return nullptr;
+  }
+  return agents_.peek(*active_model_id_);
 }
 
 std::optional<std::string> RuntimeState::reset_chat(std::string &error_code,
                                                      std::string &error_message) {
-  std::shared_ptr<zoo::Agent> agent;
-  std::optional<std::string> model_id;
-  {
-    std::lock_guard<std::mutex> lock(mu_);
-    agent = agent_;
-    model_id = active_model_id_;
-  }
-  if (!agent || !model_id.has_value()) {
+  const auto resident = active_resident();
+  if (!resident) {
     error_code = "APP-STATE-409";
     error_message = "No active model is loaded";
     return std::nullopt;
   }
 
-  std::lock_guard<std::mutex> agent_lock(agent_mu_);
-  agent->clear_history();
-  return model_id;
+  const auto locks = try_lock_slots({resident}, error_code, error_message);
+  if (!locks) {
+    return std::nullopt;
+  }
+  for (const auto &slot : resident->slots) {
+    slot->agent->clear_history();
+    slot->prefix_cache.invalidate();
+  }
+  resident->clear_stateless_transcript();
+  return resident->model_id;
+}
+
+std::optional<ChatSession> RuntimeState::create_session(const ParsedSessionCreateRequest &req,
+                                                        std::string &error_code,
+                                                        std::string &error_message) {
+  if (req.model_id.has_value()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!models_.contains(*req.model_id)) {
+      error_code = "APP-MOD-404";
+      error_message = "Model not found";
+      return std::nullopt;
+    }
+  }
+  auto created = sessions_.create(req.title.value_or("New chat"), req.model_id,
+                                  req.system_prompt.value_or(""));
+  LOG_INFO << "Created session " << created.id;
+  return created;
+}
+
+std::optional<ChatSession> RuntimeState::session(const std::string &session_id) const {
+  return sessions_.get(session_id);
+}
+
+std::vector<ChatSession> RuntimeState::list_sessions(std::size_t limit) const {
+  return sessions_.list(limit);
+}
+
+bool RuntimeState::delete_session(const std::string &session_id) {
+  if (!sessions_.erase(session_id)) {
+    return false;
+  }
+  // An agent still bound to the session keeps its history until the next
+  // turn; ids are never reused, so it can no longer match.
+  return true;
+}
+
+std::optional<ChatReservation> RuntimeState::admit_session_chat(const std::string &session_id,
+                                                                std::string &error_code,
+                                                                std::string &error_message,
+                                                                int &retry_after_seconds) {
+  const auto found = sessions_.get(session_id);
+  if (!found) {
+    error_code = "APP-SESSION-404";
+    error_message = "Session not found";
+    return std::nullopt;
+  }
+  return admit_chat(found->model_id, error_code, error_message, retry_after_seconds);
+}
+
+std::optional<ChatResult> RuntimeState::session_chat(ResidentAgent &resident,
+                                                     const std::string &session_id,
+                                                     const std::string &message,
+                                                     std::string &error_code,
+                                                     std::string &error_message) {
+  return session_chat_stream(resident, session_id, message, {}, {}, error_code, error_message);
+}
+
+std::optional<ChatResult> RuntimeState::session_chat_stream(
+    ResidentAgent &resident, const std::string &session_id, const std::string &message,
+    std::function<void(std::string_view)> token_callback, std::function<bool()> should_cancel,
+    std::string &error_code, std::string &error_message) {
+  const auto found = sessions_.get(session_id);
+  if (!found) {
+    error_code = "APP-SESSION-404";
+    error_message = "Session not found";
+    return std::nullopt;
+  }
+
+  const auto key = conversation_key(found->system_prompt, session_id);
+  const auto lease = resident.acquire_slot(key);
+  auto &slot = lease.slot();
+  std::lock_guard<std::mutex> agent_lock(slot.mu);
+  const auto usage = enter_conversation(slot, key);
+  std::string prompt = message;
+  if (!usage.hit) {
+    // The slot held another conversation: rebuild this session's context,
+    // trimmed to roughly what fits in the context window.
+    prompt = session_replay_prompt(*found, message, replay_chars(resident));
+    LOG_INFO << "Switching model " << resident.model_id << " to session " << session_id << " ("
+             << found->messages.size() << " message(s), " << prompt.size()
+             << " prompt chars)";
+  }
+
+  auto handle = token_callback
+                    ? slot.agent->chat(zoo::Message::user(prompt), std::move(token_callback))
+                    : slot.agent->chat(zoo::Message::user(prompt));
+  const bool cancelled = await_turn(*slot.agent, handle, should_cancel, stopping_);
+  auto result = handle.future.get();
+  if (cancelled || !result) {
+    slot.prefix_cache.invalidate();
+  }
+  if (cancelled) {
+    // The transcript only records finished turns.
+    cancelled_error(stopping_, error_code, error_message);
+    return std::nullopt;
+  }
+  if (!result) {
+    error_code = "APP-UPSTREAM-001";
+    error_message = result.error().to_string();
+    return std::nullopt;
+  }
+  finish_turn(resident, slot, key, *result);
+  sessions_.append_turn(session_id, message, result->text);
+  return ChatResult{*result, usage, {}};
+}
+
+void RuntimeState::session_chat_async(ChatReservation reservation, std::string session_id,
+                                      std::string message, ChatCompleteCallback done) {
+  auto &admission = reservation.resident->admission;
+  const auto &queued_ticket = *reservation.ticket;
+  admission.dispatch(queued_ticket, {}, [this, reservation = std::move(reservation),
+                                         session_id = std::move(session_id),
+                                         message = std::move(message), done]() mutable {
+    auto job = [this, reservation = std::move(reservation), session_id = std::move(session_id),
+                message = std::move(message), done]() {
+      std::string error_code;
+      std::string error_message;
+      auto response = session_chat(*reservation.resident, session_id, message, error_code,
+                                   error_message);
+      done(std::move(response), error_code, error_message);
+    };
+    executor_.submit(std::move(job), shutting_down(done));
+  }, shutting_down(done));
+}
+
+void RuntimeState::session_chat_stream_async(ChatReservation reservation,
+                                             std::string session_id, std::string message,
+                                             std::shared_ptr<ChatStreamSink> sink) {
+  stream_async(std::move(reservation), std::move(sink),
+               [this, session_id = std::move(session_id), message = std::move(message)](
+                   ResidentAgent &resident, std::function<void(std::string_view)> token_callback,
+                   std::function<bool()> should_cancel, std::string &error_code,
+                   std::string &error_message) {
+                 return session_chat_stream(resident, session_id, message,
+                                            std::move(token_callback), std::move(should_cancel),
+                                            error_code, error_message);
+               });
 }
 
 void RuntimeState::unload_model() {
-  std::scoped_lock lock(mu_, agent_mu_);
-  agent_.reset();
-  active_model_id_ = std::nullopt;
+  std::vector<std::shared_ptr<ResidentAgent>> unloaded;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (active_model_id_.has_value()) {
+      if (auto resident = agents_.erase(*active_model_id_)) {
+        unloaded = retire_locked({std::move(resident)});
+      }
+    }
+    active_model_id_ = std::nullopt;
+    persist_active_model_locked();
+    touch_model_list();
+  }
+  // Queued requests keep the agent alive until they drain; new requests can no
+  // longer be routed to it.
 }
 
 std::optional<std::string> RuntimeState::clear_memory(std::string &error_code,
                                                       std::string &error_message) {
-  std::shared_ptr<zoo::Agent> agent;
+  std::vector<std::shared_ptr<ResidentAgent>> residents;
   std::shared_ptr<zoo::engine::ContextDatabase> new_db;
   std::optional<std::string> model_id;
 
   {
     std::lock_guard<std::mutex> lock(mu_);
-
     if (!context_db_) {
       error_code = "APP-STATE-500";
       error_message = "Memory database is not initialized";
       return std::nullopt;
     }
+    residents = agents_.entries();
+  }
+  // Slots before mu_, the order the chat paths use. Nothing is wiped while a
+  // generation may still read the old database.
+  const auto locks = try_lock_slots(residents, error_code, error_message);
+  if (!locks) {
+    return std::nullopt;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mu_);
 
     // Close the old database and wipe the file
     context_db_.reset();
@@ -293,20 +1470,60 @@ std::optional<std::string> RuntimeState::clear_memory(std::string &error_code,
       return std::nullopt;
     }
 
-    agent = agent_;
     model_id = active_model_id_;
   }
 
-  // Update the active agent's database reference outside mu_, consistent with
-  // the lock ordering used by chat_complete/chat_stream/reset_chat.
-  if (agent && new_db) {
-    std::lock_guard<std::mutex> agent_lock(agent_mu_);
-    agent->set_context_database(new_db);
+  for (const auto &resident : residents) {
+    for (const auto &slot : resident->slots) {
+      slot->agent->set_context_database(new_db);
+    }
   }
+  // Cached replies may draw on the wiped memory.
+  completion_cache_.clear();
 
   return model_id.value_or("none");
 }
 
+void RuntimeState::stop_accepting() {
+  std::vector<std::shared_ptr<ResidentAgent>> residents;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    residents = agents_.entries();
+    // Retired agents may still have requests queued while they drain.
+    for (const auto &weak : retired_) {
+      if (auto resident = weak.lock()) {
+        residents.push_back(std::move(resident));
+      }
+    }
+  }
+  for (const auto &resident : residents) {
+    resident->admission.shutdown();
+  }
+  executor_.close();
+}
+
+bool RuntimeState::shutdown() {
+  if (watcher_) {
+    watcher_->stop();
+  }
+  load_jobs_.cancel_all();
+  loader_.shutdown();
+  stop_accepting();
+  // Nobody can receive the rest of a reply once the event loops have stopped.
+  stopping_.store(true, std::memory_order_relaxed);
+  const bool idle = executor_.wait_idle(kShutdownWait);
+  if (idle) {
+    executor_.shutdown();
+  } else {
+    LOG_WARN << "Shutdown timeout: inference still running after "
+             << std::chrono::duration_cast<std::chrono::seconds>(kShutdownWait).count()
+             << " s, forcing exit";
+  }
+  // After the executor, so the last finished turns are written too.
+  sessions_.stop_writer();
+  return idle;
+}
+
 #ifdef ZOO_ENABLE_MCP
 std::vector<McpConnectorEntry> RuntimeState::list_mcp_connectors() const {
   std::lock_guard<std::mutex> lock(mu_);
@@ -323,7 +1540,6 @@ std::vector<McpConnectorEntry> RuntimeState::list_mcp_connectors() const {
 std::optional<zoo::Agent::McpServerSummary> RuntimeState::connect_mcp_server(
     const std::string &id, std::string &error_code, std::string &error_message) {
   McpConnectorEntry entry;
-  std::shared_ptr<zoo::Agent> agent;
   {
     std::lock_guard<std::mutex> lock(mu_);
     const auto it = mcp_connectors_.find(id);
@@ -333,24 +1549,43 @@ std::optional<zoo::Agent::McpServerSummary> RuntimeState::connect_mcp_server(
       return std::nullopt;
     }
     entry = it->second;
-    agent = agent_;
   }
 
-  if (!agent) {
+  const auto resident = active_resident();
+  if (!resident) {
     error_code = "APP-STATE-409";
     error_message = "No active model is loaded (cannot connect MCP tools without agent)";
     return std::nullopt;
   }
 
-  std::lock_guard<std::mutex> agent_lock(agent_mu_);
-  auto result = agent->add_mcp_server(entry.config);
-  if (!result) {
+  const auto locks = try_lock_slots({resident}, error_code, error_message);
+  if (!locks) {
+    return std::nullopt;
+  }
+  // Every slot gets the tools so a chat sees the same ones whichever it lands
+  // on. New tools change the prompt prefix every conversation starts from,
+  // and what a cached reply would have been.
+  completion_cache_.erase_model(resident->model_id);
+  const auto &slots = resident->slots;
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    auto result = slots[i]->agent->add_mcp_server(entry.config);
+    slots[i]->prefix_cache.invalidate();
+    if (result) {
+      continue;
+    }
     error_code = "APP-UPSTREAM-001";
     error_message = result.error().to_string();
+    // All or nothing: take the tools back off the slots that got them.
+    for (std::size_t j = 0; j < i; ++j) {
+      if (!slots[j]->agent->remove_mcp_server(id)) {
+        LOG_WARN << "Failed to roll back MCP server " << id << " on model "
+                 << resident->model_id;
+      }
+    }
     return std::nullopt;
   }
 
-  auto summary = agent->get_mcp_server(id);
+  auto summary = resident->slots.front()->agent->get_mcp_server(id);
   if (!summary) {
     error_code = "APP-UPSTREAM-002";
     error_message = "Failed to fetch summary after connection";
@@ -362,27 +1597,45 @@ std::optional<zoo::Agent::McpServerSummary> RuntimeState::connect_mcp_server(
 bool RuntimeState::disconnect_mcp_server(const std::string &id,
                                          std::string &error_code,
                                          std::string &error_message) {
-  std::shared_ptr<zoo::Agent> agent;
+  McpConnectorEntry entry;
   {
     std::lock_guard<std::mutex> lock(mu_);
-    if (!mcp_connectors_.contains(id)) {
+    const auto it = mcp_connectors_.find(id);
+    if (it == mcp_connectors_.end()) {
       error_code = "APP-MCP-404";
       error_message = "Connector not found";
       return false;
     }
-    agent = agent_;
+    entry = it->second;
   }
 
-  if (!agent) {
+  const auto resident = active_resident();
+  if (!resident) {
     // If agent is gone, then it's effectively disconnected
     return true; 
   }
 
-  std::lock_guard<std::mutex> agent_lock(agent_mu_);
-  auto result = agent->remove_mcp_server(id);
-  if (!result) {
+  const auto locks = try_lock_slots({resident}, error_code, error_message);
+  if (!locks) {
+    return false;
+  }
+  completion_cache_.erase_model(resident->model_id);
+  const auto &slots = resident->slots;
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    auto result = slots[i]->agent->remove_mcp_server(id);
+    slots[i]->prefix_cache.invalidate();
+    if (result) {
+      continue;
+    }
     error_code = "APP-UPSTREAM-001";
     error_message = result.error().to_string();
+    // All or nothing: give the tools back to the slots that lost them.
+    for (std::size_t j = 0; j < i; ++j) {
+      if (!slots[j]->agent->add_mcp_server(entry.config)) {
+        LOG_WARN << "Failed to roll back MCP server " << id << " on model "
+                 << resident->model_id;
+      }
+    }
     return false;
   }
   return true;
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <mutex>
@@ -13,18 +17,98 @@
 #include <zoo/mcp/mcp_client.hpp>
 #endif
 
+#include "admission_queue.hpp"
+#include "agent_cache.hpp"
+#include "completion_cache.hpp"
+#include "gguf_reader.hpp"
+#include "inference_executor.hpp"
+#include "model_index.hpp"
+#include "model_load_jobs.hpp"
+#include "model_memory.hpp"
+#include "model_watcher.hpp"
+#include "prefix_cache.hpp"
+#include "session_store.hpp"
+#include "token_coalescer.hpp"
+
 struct ModelEntry {
   std::string id;
   std::string display_name;
-  std::string path;
+  std::string path;  // The file, or the first shard of a split model
+  std::vector<std::string> shard_paths;  // Every shard in order; empty if not split
+  // Stored as available | unavailable (file presence, kept current by the
+  // directory watcher); list_models() overlays loading | ready | failed.
   std::string status = "available";
   int context_size = 2048;
+  int parallel_sequences = 1;  // Context slots a load creates (or the resident has)
   std::uintmax_t file_size_bytes = 0;
+  std::int64_t file_mtime_ns = 0;
+  // Registered through the API (kept in the index while the file is missing).
+  bool registered = false;
+  bool resident = false;
+  std::optional<std::string> load_job_id;  // Most recent load job, if any
+  std::optional<double> load_progress_percent;  // Set while loading
+  ModelLoadOptions load_options;
+  // Header facts read at discovery/registration; absent if unparseable.
+  std::optional<GgufMetadata> metadata;
+};
+
+// Immutable, pre-serialized GET /api/models body. `generation` only advances
+// when the body actually changes.
+struct ModelListSnapshot {
+  std::uint64_t generation = 0;
+  std::string etag;
+  std::string body;
+  // Change counter value the snapshot was built from.
+  std::uint64_t source_version = 0;
 };
 
 struct ParsedModelRegisterRequest {
   std::string path;
   std::optional<std::string> display_name;
+  std::optional<ModelLoadOptions> load_options;
+};
+
+struct ParsedChatRequest {
+  std::string message;
+  // Routes the request to this resident model instead of the active one.
+  std::optional<std::string> model_id;
+  // `isolated`: answer from a fresh context, on a slot other than the one
+  // holding the stateless conversation, which is left untouched
+  // (/api/chat/complete only; needs parallel_sequences >= 2). Only these
+  // requests use the completion cache, since their reply depends on nothing
+  // but the message.
+  bool isolated = false;
+  // Override the server's token coalescing for a streamed reply.
+  std::optional<int> flush_interval_ms;
+  std::optional<int> flush_bytes;
+  // `stream_options.resumable`: keep a streamed reply generating for the
+  // resume window after its client disconnects, instead of cancelling it.
+  bool resumable = false;
+};
+
+struct ParsedChatSendRequest {
+  std::string message;
+  // Client-chosen id for the generation; resubmitting it attaches to the first
+  // submission instead of starting another.
+  std::optional<std::string> request_id;
+  // `options.stream`: run the turn detached and answer 202 right away.
+  bool stream = false;
+};
+
+// A client message on the chat WebSocket.
+struct ParsedChatSocketMessage {
+  std::string type;  // send | subscribe | cancel | ping
+  ParsedChatSendRequest send;
+  // subscribe and cancel: the generation's id.
+  std::string request_id;
+  // subscribe: replay the events after this one (`from_seq` - 1).
+  std::uint64_t after_seq = 0;
+};
+
+struct ParsedSessionCreateRequest {
+  std::optional<std::string> title;
+  std::optional<std::string> model_id;
+  std::optional<std::string> system_prompt;
 };
 
 #ifdef ZOO_ENABLE_MCP
@@ -36,46 +120,247 @@ struct McpConnectorEntry {
 
 #endif
 
+// A finished chat turn and how much of the conversation the agent's live
+// context already held.
+struct ChatResult {
+  zoo::Response response;
+  PrefixCacheUsage prefix_cache;
+  // "hit" or "miss" when the completion cache was consulted.
+  std::string cache;
+};
+
+// Receives the events of a streaming chat scheduled with
+// RuntimeState::chat_stream_async(). Events arrive on inference worker threads;
+// on_queued may also arrive on whichever thread advanced the queue.
+class ChatStreamSink {
+ public:
+  virtual ~ChatStreamSink() = default;
+  virtual void on_queued(std::size_t position) = 0;
+  // Called when the generation is about to start; a good moment to check that
+  // the client is still there.
+  virtual void on_started() = 0;
+  virtual void on_token(std::string_view token) = 0;
+  // Called between tokens about every 20 ms while generating, so buffered
+  // output can go out even when the next token is slow to arrive.
+  virtual void on_tick() {}
+  virtual void on_done(const ChatResult &result) = 0;
+  virtual void on_error(const std::string &error_code, const std::string &error_message) = 0;
+  // True once the client has gone away; polled between decode steps.
+  virtual bool cancelled() const = 0;
+};
+
+struct PreloadModel {
+  std::string model_id;
+  std::optional<int> context_size;
+};
+
 struct RuntimeConfig {
   std::vector<std::string> model_discovery_paths = {"./uploads"};
+  DiscoveryOptions discovery;
   std::vector<std::string> allowed_origins = {"http://127.0.0.1:8080", "http://localhost:8080"};
+  int inference_workers = 2;
+  int max_queued_requests = 8;
+  // Independent contexts per loaded model. Each runs one chat at a time, so up
+  // to this many chats decode concurrently on a model; each costs a full KV
+  // cache. Inference workers are raised to at least this many.
+  int parallel_sequences = 1;
+  // Memory budget for resident agents; 0 means 75% of physical RAM.
+  std::uintmax_t max_resident_bytes = 0;
+  // Applied to discovered models and to registrations without load_options.
+  ModelLoadOptions default_load_options;
+  // Loaded (without becoming active) at startup, before /healthz reports ready.
+  std::vector<PreloadModel> preload_models;
+  // How streamed tokens are packed into SSE events unless a request says
+  // otherwise.
+  StreamFlushPolicy stream_flush;
+  // Encoded stream output allowed to wait for a slow client before the stream
+  // is aborted.
+  std::size_t stream_buffer_bytes = 256 * 1024;
+  // Events kept per stream for clients that reconnect; oldest dropped first.
+  std::size_t stream_log_bytes = 1024 * 1024;
+  // How long a resumable stream nobody watches keeps generating, and how long
+  // a finished one stays resumable.
+  std::chrono::milliseconds stream_resume_window{30000};
+  // How often the chat WebSocket pings each client, which keeps proxies from
+  // timing out quiet connections; 0 disables heartbeats.
+  std::chrono::milliseconds ws_heartbeat_interval{20000};
+  // Replies of /api/chat/complete kept for identical requests; 0 disables.
+  // Serving a repeat from the cache is only faithful when the model decodes
+  // deterministically (greedy sampling), so this is off unless asked for.
+  std::size_t completion_cache_bytes = 0;
+  // Sent to every freshly loaded agent to fault in weights and allocate compute
+  // buffers before it serves traffic; empty disables warm-up.
+  std::string warmup_prompt = "Hello";
+  // Where the active model is remembered so a restart can restore it; empty
+  // disables persistence.
+  std::string state_path = "uploads/runtime_state.json";
+  // Persisted model registry, so restarts only re-stat known files and keep
+  // ids stable; empty rescans from scratch on every boot.
+  std::string registry_index_path = "uploads/model_index.json";
+  // Watch the discovery paths with inotify and apply changes as they happen.
+  // Disable on filesystems without inotify support (e.g. NFS); changes are
+  // then picked up at the next restart.
+  bool watch_model_paths = true;
+  // Directory of per-session transcript logs; empty keeps sessions in memory
+  // only.
+  std::string sessions_dir = "uploads/sessions";
 #ifdef ZOO_ENABLE_MCP
   std::vector<McpConnectorEntry> mcp_connectors;
 #endif
 };
 
+// An admitted chat request: the agent it was routed to and its place in that
+// agent's queue. The ticket is declared last so it is released before the
+// agent (and the queue it points into) can go away.
+struct ChatReservation {
+  std::shared_ptr<ResidentAgent> resident;
+  std::shared_ptr<AdmissionTicket> ticket;
+};
+
 class RuntimeState {
  public:
+  // Invoked from an inference worker thread once a queued chat finishes.
+  using ChatCompleteCallback =
+      std::function<void(std::optional<ChatResult> result,
+                         const std::string &error_code,
+                         const std::string &error_message)>;
+
   explicit RuntimeState(RuntimeConfig config = {});
 
   std::vector<ModelEntry> list_models() const;
+  // The current model list; lock-free unless something changed since the
+  // snapshot was last built.
+  std::shared_ptr<const ModelListSnapshot> model_list_snapshot() const;
   std::optional<std::string> active_model_id() const;
+  // False until startup preloading (and restoring the previously active model)
+  // has finished.
+  bool ready() const { return ready_.load(std::memory_order_acquire); }
+  // Token coalescing for streams that do not choose their own.
+  const StreamFlushPolicy &stream_flush_policy() const { return config_.stream_flush; }
+  std::size_t stream_buffer_bytes() const { return config_.stream_buffer_bytes; }
+  std::chrono::milliseconds ws_heartbeat_interval() const {
+    return config_.ws_heartbeat_interval;
+  }
+  // Models swapped out or evicted whose agents are still finishing requests
+  // admitted before the cut-over.
+  std::vector<std::string> draining_model_ids() const;
 
   std::optional<ModelEntry> register_model(const ParsedModelRegisterRequest &req,
                                            std::string &error_code,
                                            std::string &error_message);
 
-  std::optional<ModelEntry> select_model(const std::string &model_id,
-                                         std::optional<int> context_size_override,
-                                         std::string &error_code,
-                                         std::string &error_message);
+  // Starts loading `model_id` in the background and makes it active once
+  // ready. Returns the load job; selecting a resident model completes
+  // immediately and a load already in flight for the same model is reused.
+  std::optional<ModelLoadStatus> select_model(const std::string &model_id,
+                                              std::optional<int> context_size_override,
+                                              std::string &error_code,
+                                              std::string &error_message);
+
+  std::optional<ModelLoadStatus> model_load_status(const std::string &job_id) const;
+
+  // Requests cancellation of a running load. Reading weights stops at the next
+  // chunk; an engine initialization already underway runs to completion and
+  // its agent is discarded.
+  std::optional<ModelLoadStatus> cancel_model_load(const std::string &job_id,
+                                                   std::string &error_code,
+                                                   std::string &error_message);
 
+  // Evicts the active model from the resident set.
   void unload_model();
 
-  std::optional<zoo::Response> chat_complete(const std::string &message,
-                                             std::string &error_code,
-                                             std::string &error_message);
+  // Reserves a place in the admission queue of `model_id` (or of the active
+  // model). Fails with APP-MOD-404 for unknown models, APP-STATE-409 when the
+  // model is not resident and APP-RATE-429 when its queue is full, in which
+  // case `retry_after_seconds` holds the estimated wait.
+  std::optional<ChatReservation> admit_chat(const std::optional<std::string> &model_id,
+                                            std::string &error_code,
+                                            std::string &error_message,
+                                            int &retry_after_seconds);
+
+  // Runs a chat turn on `resident`; callers must hold its running admission
+  // ticket. An `isolated` turn runs in a cleared context on a slot not holding
+  // the stateless conversation and is not kept, so that conversation neither
+  // shapes nor records it.
+  std::optional<ChatResult> chat_complete(ResidentAgent &resident,
+                                          const std::string &message, bool isolated,
+                                          std::string &error_code,
+                                          std::string &error_message);
+
+  // Queues chat_complete behind the reservation and runs it on the inference
+  // executor so the calling event loop never blocks on model work. With the
+  // completion cache on, a repeat of an earlier isolated request is answered
+  // right away on the calling thread. An isolated request to a model with a
+  // single context fails with APP-STATE-409.
+  void chat_complete_async(ChatReservation reservation, std::string message, bool isolated,
+                           ChatCompleteCallback done);
 
+  // Clears the stateless conversation on every slot of the active model.
+  // Called on an IO thread, so while any slot is generating it fails with
+  // APP-STATE-409 instead of waiting; the same holds for clear_memory and the
+  // MCP connector calls.
   std::optional<std::string> reset_chat(std::string &error_code,
                                         std::string &error_message);
 
+  // Sessions own a transcript and the agent history that goes with it. Each
+  // slot of a resident model holds one conversation at a time (see
+  // PrefixCache): consecutive turns of a session continue it on the slot that
+  // last ran it, while a turn landing on another slot rebuilds the session's
+  // context there first.
+  std::optional<ChatSession> create_session(const ParsedSessionCreateRequest &req,
+                                            std::string &error_code,
+                                            std::string &error_message);
+  std::optional<ChatSession> session(const std::string &session_id) const;
+  std::vector<ChatSession> list_sessions(std::size_t limit) const;
+  bool delete_session(const std::string &session_id);
+
+  // Like admit_chat, routed to the session's model (or the active model).
+  // Fails with APP-SESSION-404 for unknown sessions.
+  std::optional<ChatReservation> admit_session_chat(const std::string &session_id,
+                                                    std::string &error_code,
+                                                    std::string &error_message,
+                                                    int &retry_after_seconds);
+
+  // Runs a session turn on `resident` and records it in the transcript;
+  // callers must hold its running admission ticket.
+  std::optional<ChatResult> session_chat(ResidentAgent &resident,
+                                         const std::string &session_id,
+                                         const std::string &message,
+                                         std::string &error_code,
+                                         std::string &error_message);
+
+  void session_chat_async(ChatReservation reservation, std::string session_id,
+                          std::string message, ChatCompleteCallback done);
+
+  // Streaming variant of session_chat, cancelled like chat_stream. A cancelled
+  // turn is not recorded in the transcript.
+  std::optional<ChatResult> session_chat_stream(
+      ResidentAgent &resident, const std::string &session_id, const std::string &message,
+      std::function<void(std::string_view)> token_callback, std::function<bool()> should_cancel,
+      std::string &error_code, std::string &error_message);
+
+  // Queues session_chat_stream like chat_stream_async.
+  void session_chat_stream_async(ChatReservation reservation, std::string session_id,
+                                 std::string message, std::shared_ptr<ChatStreamSink> sink);
+
   std::optional<std::string> clear_memory(std::string &error_code,
                                           std::string &error_message);
 
-  std::optional<zoo::Response> chat_stream(const std::string &message,
-                                           std::function<void(std::string_view)> token_callback,
-                                           std::string &error_code,
-                                           std::string &error_message);
+  // Streaming variant of chat_complete; same admission requirements. When
+  // `should_cancel` turns true the request is cancelled at the next token
+  // boundary and APP-CANCELLED-499 is reported.
+  std::optional<ChatResult> chat_stream(ResidentAgent &resident,
+                                        const std::string &message,
+                                        std::function<void(std::string_view)> token_callback,
+                                        std::function<bool()> should_cancel,
+                                        std::string &error_code,
+                                        std::string &error_message);
+
+  // Queues chat_stream behind the reservation on the inference executor. The
+  // sink is owned by the scheduled task and released once the generation
+  // finishes or is rejected at shutdown.
+  void chat_stream_async(ChatReservation reservation, std::string message,
+                         std::shared_ptr<ChatStreamSink> sink);
 
 #ifdef ZOO_ENABLE_MCP
   std::vector<McpConnectorEntry> list_mcp_connectors() const;
@@ -91,17 +376,77 @@ class RuntimeState {
                              std::string &error_message);
 #endif
 
+  // Rejects queued chat work with APP-STATE-503 and refuses new work, without
+  // waiting for running work. Call while the event loops still run, so the
+  // rejections reach their clients.
+  void stop_accepting();
+
+  // Cancels model loads and stops accepting chat work, then cancels running
+  // generations at their next token and joins the loader and inference
+  // executor. False when generations were still running after a bounded wait;
+  // the executor is then left running and the caller should exit without
+  // destroying this object.
+  bool shutdown();
+
  private:
+  // One streamed turn, run on the inference executor with the sink's token
+  // and cancellation callbacks.
+  using StreamTurn = std::function<std::optional<ChatResult>(
+      ResidentAgent &, std::function<void(std::string_view)>, std::function<bool()>,
+      std::string &, std::string &)>;
+
+  // Queues `turn` behind the reservation and reports it to `sink`.
+  void stream_async(ChatReservation reservation, std::shared_ptr<ChatStreamSink> sink,
+                    StreamTurn turn);
+  std::shared_ptr<ResidentAgent> active_resident() const;
+  // Records agents leaving the cache so their drain can be observed; returns
+  // them for the caller to drop outside mu_.
+  std::vector<std::shared_ptr<ResidentAgent>> retire_locked(
+      std::vector<std::shared_ptr<ResidentAgent>> residents);
+  std::optional<ModelLoadStatus> start_model_load(const std::string &model_id,
+                                                  std::optional<int> context_size_override,
+                                                  bool activate, std::string &error_code,
+                                                  std::string &error_message);
+  void run_model_load(const std::shared_ptr<ModelLoadJob> &job, const ModelEntry &model);
+  void warm_up(zoo::Agent &agent, const ModelLoadJob &job);
+  void schedule_startup_loads();
+  void finish_startup();
+  void persist_active_model_locked() const;
+  void persist_model_index_locked() const;
+  // Directory watcher callbacks; run on the watcher thread.
+  void on_model_file_event(const ModelFileEvent &event);
+  void refresh_model_file(const std::string &path);
+  void remove_model_file(const std::string &path);
+  void rescan_models();
+  ModelEntry *find_model_by_path_locked(const std::string &path);
+  std::vector<ModelEntry> list_models_locked() const;
+  std::vector<std::string> draining_model_ids_locked() const;
+  // Marks the published model list stale.
+  void touch_model_list() { model_list_changes_->fetch_add(1, std::memory_order_release); }
+
   mutable std::mutex mu_;
-  mutable std::mutex agent_mu_;  // Serializes agent operations (chat, reset)
   std::unordered_map<std::string, ModelEntry> models_;
+  // Bumped by every change visible in the model list. Shared with load jobs
+  // and resident agents, which change outside mu_.
+  const std::shared_ptr<ChangeCounter> model_list_changes_ = std::make_shared<ChangeCounter>(1);
+  mutable std::atomic<std::shared_ptr<const ModelListSnapshot>> model_list_snapshot_;
+  const std::string boot_id_;
   std::optional<std::string> active_model_id_;
-  std::shared_ptr<zoo::Agent> agent_;
   std::shared_ptr<zoo::engine::ContextDatabase> context_db_;
 #ifdef ZOO_ENABLE_MCP
   std::unordered_map<std::string, McpConnectorEntry> mcp_connectors_;
 #endif
   RuntimeConfig config_;
+  SessionStore sessions_;
+  AgentCache agents_;  // Guarded by mu_
+  CompletionCache completion_cache_;
+  std::vector<std::weak_ptr<ResidentAgent>> retired_;  // Guarded by mu_
+  std::atomic<bool> ready_{false};
+  std::atomic<bool> stopping_{false};  // Set by shutdown(); cancels every turn
+  ModelLoadJobs load_jobs_;
+  // Single loader thread: loads run one at a time so the memory budget holds.
+  InferenceExecutor loader_;
+  // Declared after the state they reference so workers are joined first.
+  InferenceExecutor executor_;
+  std::unique_ptr<ModelDirectoryWatcher> watcher_;
 };
-
-std::string sanitize_model_id(std::string input);
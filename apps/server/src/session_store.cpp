@@ -0,0 +1,418 @@
+#include "session_store.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <json/json.h>
+#include <trantor/utils/Logger.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int kSessionLogVersion = 1;
+constexpr char kLogExtension[] = ".jsonl";
+
+std::int64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string make_session_id() {
+  static thread_local std::mt19937_64 rng(std::random_device{}());
+  char buffer[24];
+  std::snprintf(buffer, sizeof(buffer), "sess_%016llx",
+                static_cast<unsigned long long>(rng()));
+  return buffer;
+}
+
+// One line of a session log, without the newline.
+std::string to_line(const Json::Value &value) {
+  static const auto builder = [] {
+    Json::StreamWriterBuilder b;
+    b["indentation"] = "";
+    return b;
+  }();
+  return Json::writeString(builder, value);
+}
+
+std::string header_line(const ChatSession &session) {
+  Json::Value out(Json::objectValue);
+  out["version"] = kSessionLogVersion;
+  out["id"] = session.id;
+  out["title"] = session.title;
+  if (session.model_id.has_value()) {
+    out["model_id"] = *session.model_id;
+  }
+  out["system_prompt"] = session.system_prompt;
+  out["created_at_ms"] = static_cast<Json::Int64>(session.created_at_ms);
+  return to_line(out) + "\n";
+}
+
+// Messages [first, end) of `session`, stamped with its last activity.
+std::string message_lines(const ChatSession &session, std::size_t first) {
+  std::string out;
+  for (auto i = first; i < session.messages.size(); ++i) {
+    Json::Value item(Json::objectValue);
+    item["role"] = session.messages[i].role;
+    item["content"] = session.messages[i].content;
+    item["at_ms"] = static_cast<Json::Int64>(session.updated_at_ms);
+    out += to_line(item);
+    out += '\n';
+  }
+  return out;
+}
+
+// Reads a session log. A torn last line (a crash mid-append) ends the
+// transcript early instead of failing the session.
+std::optional<ChatSession> read_session_log(const fs::path &path, std::string &error_message) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    error_message = "cannot open";
+    return std::nullopt;
+  }
+  Json::Reader reader;
+  std::string line;
+  Json::Value header;
+  if (!std::getline(file, line) || !reader.parse(line, header, false) || !header.isObject() ||
+      !header["id"].isString()) {
+    error_message = "missing header";
+    return std::nullopt;
+  }
+  if (header["version"].asInt() != kSessionLogVersion) {
+    error_message = "unsupported version";
+    return std::nullopt;
+  }
+
+  ChatSession session;
+  session.id = header["id"].asString();
+  session.title = header["title"].asString();
+  if (header["model_id"].isString()) {
+    session.model_id = header["model_id"].asString();
+  }
+  session.system_prompt = header["system_prompt"].asString();
+  session.created_at_ms = header["created_at_ms"].asInt64();
+  session.updated_at_ms = session.created_at_ms;
+  while (std::getline(file, line)) {
+    Json::Value item;
+    if (!reader.parse(line, item, false) || !item["role"].isString() ||
+        !item["content"].isString()) {
+      break;
+    }
+    session.messages.push_back({item["role"].asString(), item["content"].asString()});
+    session.updated_at_ms = std::max(session.updated_at_ms, item["at_ms"].asInt64());
+  }
+  return session;
+}
+
+// Replaces the log at `path` (write-then-rename).
+bool write_log(const fs::path &path, const std::string &text, std::string &error_message) {
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+  const auto tmp_path = path.string() + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc | std::ios::binary);
+    if (!out.is_open() || !out.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+      error_message = "Failed to write " + tmp_path;
+      return false;
+    }
+  }
+  fs::rename(tmp_path, path, ec);
+  if (ec) {
+    error_message = ec.message();
+    return false;
+  }
+  return true;
+}
+
+bool append_log(const fs::path &path, const std::string &text, std::string &error_message) {
+  std::ofstream out(path, std::ios::app | std::ios::binary);
+  if (!out.is_open() || !out.write(text.data(), static_cast<std::streamsize>(text.size())) ||
+      !out.flush()) {
+    error_message = "Failed to append to " + path.string();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+SessionStore::~SessionStore() { stop_writer(); }
+
+bool SessionStore::load(std::string &error_message) {
+  if (dir_.empty()) {
+    return true;
+  }
+  std::error_code ec;
+  if (!fs::exists(dir_, ec)) {
+    return true;
+  }
+  std::vector<ChatSession> loaded;
+  for (fs::directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+    if (it->path().extension() != kLogExtension) {
+      continue;
+    }
+    std::string log_error;
+    auto session = read_session_log(it->path(), log_error);
+    if (!session) {
+      LOG_WARN << "Skipping session log " << it->path().string() << ": " << log_error;
+      continue;
+    }
+    loaded.push_back(std::move(*session));
+  }
+  if (ec) {
+    error_message = ec.message();
+    return false;
+  }
+  // Sequence numbers are not persisted; recreate them from the timestamps.
+  std::stable_sort(loaded.begin(), loaded.end(), [](const auto &a, const auto &b) {
+    return a.updated_at_ms < b.updated_at_ms;
+  });
+
+  std::lock_guard<std::mutex> lock(mu_);
+  sessions_.clear();
+  dirty_.clear();
+  logged_messages_.clear();
+  for (auto &session : loaded) {
+    session.sequence = next_sequence_++;
+    logged_messages_[session.id] = session.messages.size();
+    sessions_.emplace(session.id, std::move(session));
+  }
+  return true;
+}
+
+bool SessionStore::flush(std::string &error_message) {
+  if (dir_.empty()) {
+    return true;
+  }
+  enum class Op { kWrite, kAppend, kRemove };
+  struct Change {
+    std::string id;
+    Op op;
+    std::string text;
+  };
+
+  std::lock_guard<std::mutex> flush_lock(flush_mu_);
+  std::vector<Change> changes;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    changes.reserve(dirty_.size());
+    for (const auto &id : dirty_) {
+      const auto session = sessions_.find(id);
+      const auto logged = logged_messages_.find(id);
+      if (session == sessions_.end()) {
+        logged_messages_.erase(id);
+        changes.push_back({id, Op::kRemove, {}});
+      } else if (logged == logged_messages_.end()) {
+        changes.push_back(
+            {id, Op::kWrite, header_line(session->second) + message_lines(session->second, 0)});
+        logged_messages_[id] = session->second.messages.size();
+      } else if (logged->second < session->second.messages.size()) {
+        changes.push_back({id, Op::kAppend, message_lines(session->second, logged->second)});
+        logged->second = session->second.messages.size();
+      }
+    }
+    dirty_.clear();
+    writing_ = changes.size();
+  }
+
+  // The store's lock is free while writing.
+  bool ok = true;
+  for (const auto &change : changes) {
+    const auto path = fs::path(dir_) / (change.id + kLogExtension);
+    std::string change_error;
+    bool written = true;
+    if (change.op == Op::kRemove) {
+      std::error_code ec;
+      fs::remove(path, ec);
+      written = !ec;
+      change_error = ec.message();
+    } else if (change.op == Op::kWrite) {
+      written = write_log(path, change.text, change_error);
+    } else {
+      written = append_log(path, change.text, change_error);
+    }
+    if (written) {
+      continue;
+    }
+    if (ok) {
+      error_message = change_error;
+      ok = false;
+    }
+    // Retried by the next flush; a failed append may have left part of a
+    // line, so the log is rewritten whole.
+    std::lock_guard<std::mutex> lock(mu_);
+    logged_messages_.erase(change.id);
+    dirty_.insert(change.id);
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  writing_ = 0;
+  return ok;
+}
+
+void SessionStore::start_writer(std::chrono::milliseconds delay) {
+  if (dir_.empty() || writer_.joinable()) {
+    return;
+  }
+  writer_ = std::thread([this, delay]() { writer_loop(delay); });
+}
+
+void SessionStore::stop_writer() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    writer_stopping_ = true;
+  }
+  writer_cv_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  if (std::string error_message; !flush(error_message)) {
+    LOG_WARN << "Failed to persist sessions to " << dir_ << ": " << error_message;
+  }
+}
+
+void SessionStore::writer_loop(std::chrono::milliseconds delay) {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    writer_cv_.wait(lock, [this]() { return writer_stopping_ || !dirty_.empty(); });
+    // Let the burst that woke the writer finish first.
+    writer_cv_.wait_for(lock, delay, [this]() { return writer_stopping_; });
+    if (writer_stopping_) {
+      return;  // stop_writer() does the final flush
+    }
+    lock.unlock();
+    if (std::string error_message; !flush(error_message)) {
+      LOG_WARN << "Failed to persist sessions to " << dir_ << ": " << error_message;
+    }
+    lock.lock();
+  }
+}
+
+void SessionStore::mark_dirty_locked(const std::string &id) {
+  if (dir_.empty()) {
+    return;
+  }
+  dirty_.insert(id);
+  writer_cv_.notify_one();
+}
+
+ChatSession SessionStore::create(std::string title, std::optional<std::string> model_id,
+                                 std::string system_prompt) {
+  ChatSession session;
+  session.title = std::move(title);
+  session.model_id = std::move(model_id);
+  session.system_prompt = std::move(system_prompt);
+  session.created_at_ms = now_ms();
+  session.updated_at_ms = session.created_at_ms;
+
+  std::lock_guard<std::mutex> lock(mu_);
+  do {
+    session.id = make_session_id();
+  } while (sessions_.contains(session.id));
+  session.sequence = next_sequence_++;
+  sessions_.emplace(session.id, session);
+  mark_dirty_locked(session.id);
+  return session;
+}
+
+std::optional<ChatSession> SessionStore::get(const std::string &id) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  const auto it = sessions_.find(id);
+  if (it == sessions_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::vector<ChatSession> SessionStore::list(std::size_t limit) const {
+  std::vector<ChatSession> out;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    out.reserve(sessions_.size());
+    for (const auto &[id, session] : sessions_) {
+      out.push_back(session);
+    }
+  }
+  std::sort(out.begin(), out.end(),
+            [](const auto &a, const auto &b) { return a.sequence > b.sequence; });
+  if (out.size() > limit) {
+    out.resize(limit);
+  }
+  return out;
+}
+
+bool SessionStore::erase(const std::string &id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (sessions_.erase(id) == 0) {
+    return false;
+  }
+  mark_dirty_locked(id);
+  return true;
+}
+
+bool SessionStore::append_turn(const std::string &id, std::string user_message,
+                               std::string assistant_message) {
+  std::lock_guard<std::mutex> lock(mu_);
+  const auto it = sessions_.find(id);
+  if (it == sessions_.end()) {
+    return false;
+  }
+  auto &session = it->second;
+  session.messages.push_back({"user", std::move(user_message)});
+  session.messages.push_back({"assistant", std::move(assistant_message)});
+  session.updated_at_ms = now_ms();
+  session.sequence = next_sequence_++;
+  mark_dirty_locked(id);
+  return true;
+}
+
+std::size_t SessionStore::size() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return sessions_.size();
+}
+
+std::size_t SessionStore::pending() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return dirty_.size() + writing_;
+}
+
+std::string session_replay_prompt(const ChatSession &session, const std::string &message,
+                                  std::size_t max_chars) {
+  const auto line = [](const SessionMessage &m) {
+    return (m.role == "assistant" ? "Assistant: " : "User: ") + m.content + "\n";
+  };
+
+  // Walk back from the newest message while the transcript still fits.
+  std::size_t budget = max_chars > message.size() + session.system_prompt.size()
+                           ? max_chars - message.size() - session.system_prompt.size()
+                           : 0;
+  auto first = session.messages.size();
+  while (first >= 2) {
+    const auto cost = line(session.messages[first - 2]).size() +
+                      line(session.messages[first - 1]).size();
+    if (cost > budget) {
+      break;
+    }
+    budget -= cost;
+    first -= 2;
+  }
+
+  std::string prompt;
+  if (!session.system_prompt.empty()) {
+    prompt += session.system_prompt + "\n\n";
+  }
+  if (first < session.messages.size()) {
+    prompt += "Conversation so far:\n";
+    for (auto i = first; i < session.messages.size(); ++i) {
+      prompt += line(session.messages[i]);
+    }
+    prompt += "\nUser: ";
+  }
+  prompt += message;
+  return prompt;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct SessionMessage {
+  std::string role;  // user | assistant
+  std::string content;
+};
+
+struct ChatSession {
+  std::string id;
+  std::string title;
+  // Model the session talks to; the active model when absent.
+  std::optional<std::string> model_id;
+  std::string system_prompt;
+  std::int64_t created_at_ms = 0;  // Unix epoch
+  std::int64_t updated_at_ms = 0;
+  std::vector<SessionMessage> messages;
+  // Orders sessions by last activity independently of clock resolution.
+  std::uint64_t sequence = 0;
+};
+
+// Chat sessions and their transcripts. Internally synchronized.
+//
+// Each session is persisted to its own append-only log, `<dir>/<id>.jsonl`:
+// a header line, then one line per message. Changes only mark the session
+// dirty; flush() writes them (a new session's log, the messages appended
+// since the last flush, or the removal of a deleted session's log) without
+// holding the store's lock, so a turn costs the size of its messages in I/O
+// and never blocks other session calls. start_writer() flushes from a
+// background thread.
+class SessionStore {
+ public:
+  // An empty directory keeps sessions in memory only.
+  explicit SessionStore(std::string dir) : dir_(std::move(dir)) {}
+  ~SessionStore();
+
+  SessionStore(const SessionStore &) = delete;
+  SessionStore &operator=(const SessionStore &) = delete;
+
+  // Replaces the sessions with those logged in the directory. A missing
+  // directory is not an error; unreadable logs are skipped with a warning.
+  bool load(std::string &error_message);
+  // Writes every pending change. Changes that fail stay pending for the next
+  // flush; the first error is reported.
+  bool flush(std::string &error_message);
+
+  // Flushes on a background thread `delay` after the first change since the
+  // last flush, so bursts of changes share one write per session.
+  void start_writer(std::chrono::milliseconds delay);
+  // Joins the writer after a final flush. Safe to call more than once.
+  void stop_writer();
+
+  ChatSession create(std::string title, std::optional<std::string> model_id,
+                     std::string system_prompt);
+  std::optional<ChatSession> get(const std::string &id) const;
+  // Most recently active first.
+  std::vector<ChatSession> list(std::size_t limit) const;
+  bool erase(const std::string &id);
+  // Records a finished exchange. Returns false if the session was deleted
+  // while the reply was being generated.
+  bool append_turn(const std::string &id, std::string user_message,
+                   std::string assistant_message);
+
+  std::size_t size() const;
+  // Session changes not yet written, including those a flush is writing.
+  std::size_t pending() const;
+
+ private:
+  void mark_dirty_locked(const std::string &id);
+  void writer_loop(std::chrono::milliseconds delay);
+
+  const std::string dir_;
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, ChatSession> sessions_;
+  std::uint64_t next_sequence_ = 1;
+  // Sessions changed since the last flush, and how many messages of each are
+  // in its log (absent: no log yet).
+  std::unordered_set<std::string> dirty_;
+  std::unordered_map<std::string, std::size_t> logged_messages_;
+  std::size_t writing_ = 0;  // Changes taken by the running flush
+
+  // Serializes flushes, so a session's appends land in order.
+  std::mutex flush_mu_;
+  std::condition_variable writer_cv_;  // Waits on mu_
+  bool writer_stopping_ = false;
+  std::thread writer_;
+};
+
+// The prompt that rebuilds a session's conversation in an agent whose history
+// holds something else: the system prompt, as many of the latest turns as fit
+// in `max_chars`, then `message`. Older turns are dropped whole.
+std::string session_replay_prompt(const ChatSession &session, const std::string &message,
+                                  std::size_t max_chars);
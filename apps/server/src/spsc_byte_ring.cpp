@@ -0,0 +1,38 @@
+#include "spsc_byte_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+SpscByteRing::SpscByteRing(std::size_t capacity) : buffer_(std::max<std::size_t>(capacity, 1)) {}
+
+bool SpscByteRing::try_write(std::string_view bytes) {
+  const auto written = written_.load(std::memory_order_relaxed);
+  const auto read = read_.load(std::memory_order_acquire);
+  if (bytes.size() > capacity() - (written - read)) {
+    return false;
+  }
+  const auto start = written % capacity();
+  const auto first = std::min(bytes.size(), capacity() - start);
+  std::memcpy(buffer_.data() + start, bytes.data(), first);
+  std::memcpy(buffer_.data(), bytes.data() + first, bytes.size() - first);
+  written_.store(written + bytes.size(), std::memory_order_release);
+  return true;
+}
+
+std::size_t SpscByteRing::read_into(std::string &out) {
+  const auto read = read_.load(std::memory_order_relaxed);
+  const auto available = written_.load(std::memory_order_acquire) - read;
+  if (available == 0) {
+    return 0;
+  }
+  const auto start = read % capacity();
+  const auto first = std::min(available, capacity() - start);
+  out.append(buffer_.data() + start, first);
+  out.append(buffer_.data(), available - first);
+  read_.store(read + available, std::memory_order_release);
+  return available;
+}
+
+std::size_t SpscByteRing::size() const {
+  return written_.load(std::memory_order_acquire) - read_.load(std::memory_order_acquire);
+}
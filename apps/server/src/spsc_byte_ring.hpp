@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Bounded byte queue between exactly one writer thread and one reader thread.
+// Neither side takes a lock or allocates after construction; each only waits
+// on the other through two atomic counters.
+class SpscByteRing {
+ public:
+  explicit SpscByteRing(std::size_t capacity);
+
+  SpscByteRing(const SpscByteRing &) = delete;
+  SpscByteRing &operator=(const SpscByteRing &) = delete;
+
+  // Writer: appends all of `bytes`, or nothing when they do not fit.
+  bool try_write(std::string_view bytes);
+  // Reader: moves every readable byte onto the end of `out` and returns how
+  // many there were.
+  std::size_t read_into(std::string &out);
+
+  // Bytes written and not yet read; exact only on the writer or reader thread.
+  std::size_t size() const;
+  std::size_t capacity() const { return buffer_.size(); }
+
+ private:
+  std::vector<char> buffer_;
+  // Running totals; positions are taken modulo the capacity. Kept on separate
+  // cache lines so the two threads do not contend on one.
+  alignas(64) std::atomic<std::size_t> written_{0};
+  alignas(64) std::atomic<std::size_t> read_{0};
+};
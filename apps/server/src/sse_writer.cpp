@@ -0,0 +1,217 @@
+#include "sse_writer.hpp"
+
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+constexpr std::string_view kReplacement = "\\ufffd";
+
+// Length of the valid UTF-8 sequence starting at `text[i]`, or 0.
+std::size_t utf8_sequence_length(std::string_view text, std::size_t i) {
+  const auto lead = static_cast<unsigned char>(text[i]);
+  std::size_t length = 0;
+  unsigned char min = 0x80;
+  unsigned char max = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    min = lead == 0xE0 ? 0xA0 : 0x80;  // No overlong forms
+    max = lead == 0xED ? 0x9F : 0xBF;  // No surrogates
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    min = lead == 0xF0 ? 0x90 : 0x80;
+    max = lead == 0xF4 ? 0x8F : 0xBF;
+  } else {
+    return 0;
+  }
+  if (text.size() - i < length) {
+    return 0;
+  }
+  const auto second = static_cast<unsigned char>(text[i + 1]);
+  if (second < min || second > max) {
+    return 0;
+  }
+  for (std::size_t k = 2; k < length; ++k) {
+    if ((static_cast<unsigned char>(text[i + k]) & 0xC0) != 0x80) {
+      return 0;
+    }
+  }
+  return length;
+}
+
+template <typename T>
+void append_number(std::string &out, T value) {
+  char digits[32];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  out.append(digits, result.ptr);
+}
+
+}  // namespace
+
+void append_json_string(std::string &out, std::string_view text) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  out.push_back('"');
+  std::size_t run = 0;  // Start of bytes that need no escaping
+  for (std::size_t i = 0; i < text.size();) {
+    const auto c = static_cast<unsigned char>(text[i]);
+    if (c >= 0x20 && c != '"' && c != '\\' && c < 0x80) {
+      ++i;
+      continue;
+    }
+    if (c >= 0x80) {
+      if (const auto length = utf8_sequence_length(text, i)) {
+        i += length;
+        continue;
+      }
+    }
+    out.append(text.data() + run, i - run);
+    switch (c) {
+      case '"':
+        out.append("\\\"");
+        break;
+      case '\\':
+        out.append("\\\\");
+        break;
+      case '\n':
+        out.append("\\n");
+        break;
+      case '\r':
+        out.append("\\r");
+        break;
+      case '\t':
+        out.append("\\t");
+        break;
+      default:
+        if (c < 0x20) {
+          const char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+          out.append(escaped, sizeof(escaped));
+        } else {
+          out.append(kReplacement);
+        }
+    }
+    run = ++i;
+  }
+  out.append(text.data() + run, text.size() - run);
+  out.push_back('"');
+}
+
+void append_sse_event(std::string &out, std::uint64_t id, std::string_view json) {
+  out.append("id: ");
+  append_number(out, id);
+  out.append("\ndata: ");
+  out.append(json);
+  out.append("\n\n");
+}
+
+SseEventWriter::SseEventWriter(std::size_t reserve_bytes) { buffer_.reserve(reserve_bytes); }
+
+const std::string &SseEventWriter::token(std::string_view content) {
+  begin("token");
+  buffer_.append(",\"content\":");
+  append_json_string(buffer_, content);
+  return end();
+}
+
+const std::string &SseEventWriter::queued(std::size_t position) {
+  begin("queued");
+  buffer_.append(",\"position\":");
+  append_number(buffer_, position);
+  return end();
+}
+
+const std::string &SseEventWriter::error(std::string_view code, std::string_view message) {
+  begin("error");
+  buffer_.append(",\"code\":");
+  append_json_string(buffer_, code);
+  buffer_.append(",\"message\":");
+  append_json_string(buffer_, message);
+  return end();
+}
+
+const std::string &SseEventWriter::object(std::string_view type, const Json::Value &fields) {
+  begin(type);
+  for (auto it = fields.begin(); it != fields.end(); ++it) {
+    const char *name_end = nullptr;
+    const char *name = it.memberName(&name_end);
+    if (name == nullptr || std::string_view(name, name_end - name) == "type") {
+      continue;
+    }
+    buffer_.push_back(',');
+    append_json_string(buffer_, std::string_view(name, name_end - name));
+    buffer_.push_back(':');
+    append_value(*it);
+  }
+  return end();
+}
+
+void SseEventWriter::begin(std::string_view type) {
+  buffer_.clear();  // Keeps the capacity
+  buffer_.append("{\"type\":");
+  append_json_string(buffer_, type);
+}
+
+const std::string &SseEventWriter::end() {
+  buffer_.push_back('}');
+  return buffer_;
+}
+
+void SseEventWriter::append_value(const Json::Value &value) {
+  switch (value.type()) {
+    case Json::nullValue:
+      buffer_.append("null");
+      break;
+    case Json::intValue:
+      append_number(buffer_, value.asLargestInt());
+      break;
+    case Json::uintValue:
+      append_number(buffer_, value.asLargestUInt());
+      break;
+    case Json::realValue:
+      if (std::isfinite(value.asDouble())) {
+        append_number(buffer_, value.asDouble());
+      } else {
+        buffer_.append("null");
+      }
+      break;
+    case Json::stringValue: {
+      const char *begin = nullptr;
+      const char *end = nullptr;
+      value.getString(&begin, &end);
+      append_json_string(buffer_, std::string_view(begin, end - begin));
+      break;
+    }
+    case Json::booleanValue:
+      buffer_.append(value.asBool() ? "true" : "false");
+      break;
+    case Json::arrayValue: {
+      buffer_.push_back('[');
+      for (Json::ArrayIndex i = 0; i < value.size(); ++i) {
+        if (i > 0) {
+          buffer_.push_back(',');
+        }
+        append_value(value[i]);
+      }
+      buffer_.push_back(']');
+      break;
+    }
+    case Json::objectValue: {
+      buffer_.push_back('{');
+      bool first = true;
+      for (auto it = value.begin(); it != value.end(); ++it) {
+        const char *name_end = nullptr;
+        const char *name = it.memberName(&name_end);
+        if (!first) {
+          buffer_.push_back(',');
+        }
+        first = false;
+        append_json_string(buffer_, std::string_view(name, name_end - name));
+        buffer_.push_back(':');
+        append_value(*it);
+      }
+      buffer_.push_back('}');
+      break;
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <json/json.h>
+
+// Appends `text` to `out` as a quoted JSON string. Bytes that are not valid
+// UTF-8 become U+FFFD.
+void append_json_string(std::string &out, std::string_view text);
+
+// Appends one SSE event carrying `json` as its data and `id` as its id.
+void append_sse_event(std::string &out, std::uint64_t id, std::string_view json);
+
+// Encodes stream events as single-line JSON objects into one buffer reused for
+// the life of a stream, so steady-state token events allocate nothing. Each
+// call replaces the previous event; the returned reference is valid until the
+// next call.
+class SseEventWriter {
+ public:
+  explicit SseEventWriter(std::size_t reserve_bytes = 1024);
+
+  const std::string &token(std::string_view content);
+  const std::string &queued(std::size_t position);
+  const std::string &error(std::string_view code, std::string_view message);
+  // `fields` (a JSON object) with "type" added; for once-per-stream events
+  // such as done.
+  const std::string &object(std::string_view type, const Json::Value &fields);
+
+ private:
+  void begin(std::string_view type);
+  const std::string &end();
+  void append_value(const Json::Value &value);
+
+  std::string buffer_;
+};
@@ -0,0 +1,212 @@
+#include "stream_hub.hpp"
+
+#include <cstdio>
+#include <random>
+
+namespace {
+
+std::string make_stream_id() {
+  static thread_local std::mt19937_64 rng(std::random_device{}());
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "stream_%016llx",
+                static_cast<unsigned long long>(rng()));
+  return buffer;
+}
+
+}  // namespace
+
+StreamHub::StreamHub(std::string id, std::size_t log_bytes, Clock::duration resume_window,
+                     StreamLifetime lifetime)
+    : id_(std::move(id)),
+      log_bytes_(log_bytes),
+      resume_window_(resume_window),
+      lifetime_(lifetime),
+      unwatched_since_(Clock::now()) {}
+
+void StreamHub::publish(std::string_view json) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (finished_at_.has_value()) {
+    return;
+  }
+  const Entry entry{next_seq_++, compacted_ + data_.size(), json.size()};
+  data_.append(json);
+  entries_.push_back(entry);
+  logged_bytes_ += entry.length;
+  evict_locked();
+  const StreamEvent event{entry.seq, json};
+  bool dropped = false;
+  for (const auto &subscriber : subscribers_) {
+    dropped = !subscriber->deliver(event) || dropped;
+  }
+  if (dropped) {
+    drop_gone_subscribers_locked(Clock::now());
+  }
+}
+
+void StreamHub::finish() {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (finished_at_.has_value()) {
+    return;
+  }
+  finished_at_ = Clock::now();
+  for (const auto &subscriber : subscribers_) {
+    subscriber->close();
+  }
+  subscribers_.clear();
+}
+
+bool StreamHub::stop_requested(Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (finished_at_.has_value()) {
+    return false;
+  }
+  if (cancelled_ || lifetime_ == StreamLifetime::kDetached) {
+    return cancelled_;
+  }
+  drop_gone_subscribers_locked(now);
+  if (!subscribers_.empty()) {
+    return false;
+  }
+  return lifetime_ == StreamLifetime::kWatched || now - unwatched_since_ >= resume_window_;
+}
+
+bool StreamHub::attach(std::shared_ptr<StreamSubscriber> subscriber, std::uint64_t after_seq,
+                       std::string &error_code, std::string &error_message) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!can_resume_locked(after_seq)) {
+    error_code = "APP-STREAM-410";
+    error_message = "Stream events after " + std::to_string(after_seq) +
+                    " are no longer available";
+    return false;
+  }
+  std::vector<StreamEvent> missed;
+  for (auto i = first_entry_; i < entries_.size(); ++i) {
+    if (entries_[i].seq > after_seq) {
+      missed.push_back({entries_[i].seq, json_locked(entries_[i])});
+    }
+  }
+  subscriber->replay(missed);
+  if (finished_at_.has_value()) {
+    subscriber->close();
+    return true;
+  }
+  subscribers_.push_back(std::move(subscriber));
+  return true;
+}
+
+bool StreamHub::cancel() {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (finished_at_.has_value()) {
+    return false;
+  }
+  cancelled_ = true;
+  return true;
+}
+
+std::size_t StreamHub::subscriber_count() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return subscribers_.size();
+}
+
+bool StreamHub::can_resume(std::uint64_t after_seq) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return can_resume_locked(after_seq);
+}
+
+std::uint64_t StreamHub::last_seq() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return next_seq_ - 1;
+}
+
+bool StreamHub::finished() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return finished_at_.has_value();
+}
+
+bool StreamHub::expired(Clock::time_point now) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return finished_at_.has_value() && now - *finished_at_ >= resume_window_;
+}
+
+std::string_view StreamHub::json_locked(const Entry &entry) const {
+  return std::string_view(data_).substr(entry.offset - compacted_, entry.length);
+}
+
+bool StreamHub::can_resume_locked(std::uint64_t after_seq) const {
+  const auto first_logged =
+      first_entry_ < entries_.size() ? entries_[first_entry_].seq : next_seq_;
+  return after_seq + 1 >= first_logged;
+}
+
+void StreamHub::evict_locked() {
+  // The newest event always stays, however large.
+  while (logged_bytes_ > log_bytes_ && entries_.size() - first_entry_ > 1) {
+    logged_bytes_ -= entries_[first_entry_].length;
+    ++first_entry_;
+  }
+  const auto dead_bytes = entries_[first_entry_].offset - compacted_;
+  if (dead_bytes > 0 && dead_bytes * 2 >= data_.size()) {
+    data_.erase(0, dead_bytes);  // Keeps the capacity
+    compacted_ += dead_bytes;
+  }
+  if (first_entry_ > 0 && first_entry_ * 2 >= entries_.size()) {
+    entries_.erase(entries_.begin(), entries_.begin() + static_cast<std::ptrdiff_t>(first_entry_));
+    first_entry_ = 0;
+  }
+}
+
+void StreamHub::drop_gone_subscribers_locked(Clock::time_point now) {
+  const auto before = subscribers_.size();
+  std::erase_if(subscribers_, [](const auto &subscriber) {
+    if (!subscriber->gone()) {
+      return false;
+    }
+    subscriber->close();
+    return true;
+  });
+  if (before > 0 && subscribers_.empty()) {
+    unwatched_since_ = now;
+  }
+}
+
+std::shared_ptr<StreamHub> StreamHubRegistry::create(StreamLifetime lifetime) {
+  std::lock_guard<std::mutex> lock(mu_);
+  prune_locked(StreamHub::Clock::now());
+  std::string id;
+  do {
+    id = make_stream_id();
+  } while (hubs_.contains(id));
+  auto hub = std::make_shared<StreamHub>(id, log_bytes_, resume_window_, lifetime);
+  hubs_.emplace(std::move(id), hub);
+  return hub;
+}
+
+std::shared_ptr<StreamHub> StreamHubRegistry::find_or_create(const std::string &id,
+                                                             StreamLifetime lifetime,
+                                                             bool &created) {
+  std::lock_guard<std::mutex> lock(mu_);
+  prune_locked(StreamHub::Clock::now());
+  auto &hub = hubs_[id];
+  created = hub == nullptr;
+  if (created) {
+    hub = std::make_shared<StreamHub>(id, log_bytes_, resume_window_, lifetime);
+  }
+  return hub;
+}
+
+std::shared_ptr<StreamHub> StreamHubRegistry::find(const std::string &id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  prune_locked(StreamHub::Clock::now());
+  const auto it = hubs_.find(id);
+  return it == hubs_.end() ? nullptr : it->second;
+}
+
+std::size_t StreamHubRegistry::size() {
+  std::lock_guard<std::mutex> lock(mu_);
+  prune_locked(StreamHub::Clock::now());
+  return hubs_.size();
+}
+
+void StreamHubRegistry::prune_locked(StreamHub::Clock::time_point now) {
+  std::erase_if(hubs_, [now](const auto &item) { return item.second->expired(now); });
+}
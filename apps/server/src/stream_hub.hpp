@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// One stream event: its sequence number and its JSON object.
+struct StreamEvent {
+  std::uint64_t seq = 0;
+  std::string_view json;
+};
+
+// A client watching a stream, e.g. one SSE response. Called with the hub's
+// lock held, so implementations must not block.
+class StreamSubscriber {
+ public:
+  virtual ~StreamSubscriber() = default;
+  // Logged events the client missed, oldest first. Called once, before any
+  // live event, and not bounded by the live buffer.
+  virtual void replay(const std::vector<StreamEvent> &events) = 0;
+  // A live event. False when the subscriber has ended (disconnected or cut off
+  // for falling behind) and should be dropped.
+  virtual bool deliver(const StreamEvent &event) = 0;
+  // Ends the subscription once everything delivered has been sent.
+  virtual void close() = 0;
+  // True once the client has gone away.
+  virtual bool gone() const = 0;
+};
+
+// What keeps a generation running once its clients go away.
+enum class StreamLifetime {
+  kWatched,    // Cancelled as soon as its last subscriber leaves
+  kResumable,  // Keeps running for the resume window, waiting for a reconnect
+  kDetached,   // Runs to completion whether or not anybody watches
+};
+
+// The sequenced events of one generation, fanned out to every client watching
+// it live. Events are kept in a log bounded by bytes (oldest dropped first), so
+// a client that joins late or reconnects replays what it missed and continues
+// live instead of starting a second generation. Internally synchronized.
+class StreamHub {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // A finished stream stays resumable for `resume_window`.
+  StreamHub(std::string id, std::size_t log_bytes, Clock::duration resume_window,
+            StreamLifetime lifetime = StreamLifetime::kWatched);
+
+  StreamHub(const StreamHub &) = delete;
+  StreamHub &operator=(const StreamHub &) = delete;
+
+  const std::string &id() const { return id_; }
+
+  // Generation side. Logs `json` under the next sequence number (from 1) and
+  // passes it to every subscriber; ignored once finished.
+  void publish(std::string_view json);
+  // No more events; subscribers are closed after the last one.
+  void finish();
+  // True once the generation should stop: cancel() was called, or nobody
+  // watches it any more (right away for a kWatched stream, after the resume
+  // window for a kResumable one).
+  bool stop_requested(Clock::time_point now);
+
+  // Client side. Replays the logged events after `after_seq`, then adds
+  // `subscriber` to the live ones (a finished stream closes it right away).
+  // False with APP-STREAM-410 when some of those events have already left the
+  // log.
+  bool attach(std::shared_ptr<StreamSubscriber> subscriber, std::uint64_t after_seq,
+              std::string &error_code, std::string &error_message);
+  bool can_resume(std::uint64_t after_seq) const;
+  // Asks the generation to stop; false when it has already finished.
+  bool cancel();
+
+  StreamLifetime lifetime() const { return lifetime_; }
+  bool detached() const { return lifetime_ == StreamLifetime::kDetached; }
+  std::uint64_t last_seq() const;
+  std::size_t subscriber_count() const;
+  bool finished() const;
+  // True once the stream finished more than the resume window ago.
+  bool expired(Clock::time_point now) const;
+
+ private:
+  struct Entry {
+    std::uint64_t seq = 0;
+    std::size_t offset = 0;  // Into data_, counting bytes already compacted away
+    std::size_t length = 0;
+  };
+
+  std::string_view json_locked(const Entry &entry) const;
+  bool can_resume_locked(std::uint64_t after_seq) const;
+  void evict_locked();
+  void drop_gone_subscribers_locked(Clock::time_point now);
+
+  const std::string id_;
+  const std::size_t log_bytes_;
+  const Clock::duration resume_window_;
+  const StreamLifetime lifetime_;
+
+  mutable std::mutex mu_;
+  // Logged event JSON back to back. Evicted entries are compacted away once
+  // they make up half the buffer, so logging does not allocate in steady state.
+  std::string data_;
+  std::size_t compacted_ = 0;
+  std::vector<Entry> entries_;
+  std::size_t first_entry_ = 0;  // Entries before this were evicted
+  std::size_t logged_bytes_ = 0;
+  std::uint64_t next_seq_ = 1;
+  std::vector<std::shared_ptr<StreamSubscriber>> subscribers_;
+  Clock::time_point unwatched_since_;  // Meaningful while subscribers_ is empty
+  bool cancelled_ = false;
+  std::optional<Clock::time_point> finished_at_;
+};
+
+// Streams by id, kept until they expire so clients can reconnect to them.
+class StreamHubRegistry {
+ public:
+  StreamHubRegistry(std::size_t log_bytes, StreamHub::Clock::duration resume_window)
+      : log_bytes_(log_bytes), resume_window_(resume_window) {}
+
+  // A new hub under a fresh id.
+  std::shared_ptr<StreamHub> create(StreamLifetime lifetime = StreamLifetime::kWatched);
+  // The hub registered under `id`, or a new one (setting `created`) when there
+  // is none, so a retried submission does not start a second generation.
+  std::shared_ptr<StreamHub> find_or_create(const std::string &id, StreamLifetime lifetime,
+                                            bool &created);
+  std::shared_ptr<StreamHub> find(const std::string &id);
+  std::size_t size();
+
+ private:
+  void prune_locked(StreamHub::Clock::time_point now);
+
+  const std::size_t log_bytes_;
+  const StreamHub::Clock::duration resume_window_;
+  std::mutex mu_;
+  std::unordered_map<std::string, std::shared_ptr<StreamHub>> hubs_;
+};
@@ -0,0 +1,56 @@
+#include "token_coalescer.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Room a flush needs besides its escaped text: the event's other fields, SSE
+// or WebSocket framing (with the request id), and the token that crossed the
+// threshold, which is sent along with the rest.
+constexpr std::size_t kFlushSlackBytes = 512;
+// Worst-case growth of text once JSON-escaped: "\u00XX" or "\ufffd" per byte.
+constexpr std::size_t kJsonEscapeGrowth = 6;
+
+// Length of the longest prefix of `text` that does not end inside a UTF-8
+// sequence, so a character split across tokens waits for its remaining bytes.
+std::size_t complete_utf8_prefix(std::string_view text) {
+  // A sequence is at most 4 bytes, so only the last 3 can be an unfinished one.
+  const auto size = text.size();
+  for (std::size_t back = 1; back <= 3 && back <= size; ++back) {
+    const auto c = static_cast<unsigned char>(text[size - back]);
+    if ((c & 0xC0) == 0x80) {
+      continue;  // Continuation byte; keep looking for the lead
+    }
+    const std::size_t expected = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    return expected > back ? size - back : size;
+  }
+  return size;
+}
+
+}  // namespace
+
+StreamFlushPolicy fit_flush_to_buffer(StreamFlushPolicy policy, std::size_t buffer_bytes) {
+  const auto room = buffer_bytes > kFlushSlackBytes ? buffer_bytes - kFlushSlackBytes : 0;
+  policy.max_bytes =
+      std::max<std::size_t>(std::min(policy.max_bytes, room / kJsonEscapeGrowth), 1);
+  return policy;
+}
+
+bool TokenCoalescer::append(std::string_view token, Clock::time_point now) {
+  if (pending_.empty()) {
+    oldest_ = now;
+  }
+  pending_.append(token);
+  return pending_.size() >= policy_.max_bytes || due(now);
+}
+
+bool TokenCoalescer::due(Clock::time_point now) const {
+  return !pending_.empty() && now - oldest_ >= policy_.max_delay;
+}
+
+std::string_view TokenCoalescer::ready(bool final) const {
+  const std::string_view pending = pending_;
+  return final ? pending : pending.substr(0, complete_utf8_prefix(pending));
+}
+
+void TokenCoalescer::consume(std::size_t bytes) { pending_.erase(0, bytes); }
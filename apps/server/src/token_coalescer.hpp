@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// When buffered stream tokens are sent as one `token` event.
+struct StreamFlushPolicy {
+  // Longest the oldest buffered token may wait; 0 sends every token alone.
+  std::chrono::milliseconds max_delay{25};
+  // Buffered bytes that trigger a send regardless of age.
+  std::size_t max_bytes = 256;
+};
+
+// `policy` with max_bytes lowered so one flush, JSON-escaped and framed,
+// always fits a subscriber buffer of `buffer_bytes`. A larger event could
+// never be buffered and would cut a healthy client off as a slow consumer.
+StreamFlushPolicy fit_flush_to_buffer(StreamFlushPolicy policy, std::size_t buffer_bytes);
+
+// Packs consecutive stream tokens into larger frames. The buffer keeps its
+// capacity across flushes, so steady-state streaming does not allocate. Not
+// synchronized; the owning stream's lock guards it.
+class TokenCoalescer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit TokenCoalescer(StreamFlushPolicy policy) : policy_(policy) {}
+
+  // Buffers `token`; returns true when the buffer should be sent now.
+  bool append(std::string_view token, Clock::time_point now);
+  // True when buffered text has waited out the policy's delay.
+  bool due(Clock::time_point now) const;
+  // Buffered text ready to send: all of it when `final`, otherwise up to the
+  // last complete UTF-8 character. Valid until the next call.
+  std::string_view ready(bool final) const;
+  // Drops the first `bytes` of the buffer once they have been sent.
+  void consume(std::size_t bytes);
+
+  bool empty() const { return pending_.empty(); }
+  const StreamFlushPolicy &policy() const { return policy_; }
+
+ private:
+  const StreamFlushPolicy policy_;
+  std::string pending_;
+  Clock::time_point oldest_{};  // Arrival of the first buffered token
+};
@@ -27,6 +27,27 @@ describe('consumeSseStream', () => {
     expect(events[1].type).toBe('done');
   });
 
+  it('reads data lines of events that carry an id', async () => {
+    const encoder = new TextEncoder();
+    const chunks = [
+      encoder.encode('id: 1\ndata: {"type":"queued","position":1}\n\n: ping\n\nid: 2\ndata: {"type":"token","content":"hi"}\n\n'),
+    ];
+
+    const stream = new ReadableStream<Uint8Array>({
+      start(controller) {
+        for (const chunk of chunks) controller.enqueue(chunk);
+        controller.close();
+      },
+    });
+
+    const events: Array<{ type: string }> = [];
+    await consumeSseStream(stream, (event) => {
+      events.push(event as { type: string });
+    });
+
+    expect(events.map((event) => event.type)).toEqual(['queued', 'token']);
+  });
+
   it('ignores malformed JSON gracefully', async () => {
     const encoder = new TextEncoder();
     const chunks = [
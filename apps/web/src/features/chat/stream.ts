@@ -2,6 +2,7 @@ import { requestJson } from '../../shared/api/client';
 import type { ChatMetrics, ChatUsage, ChatResetResponse, ClearMemoryResponse } from '../../shared/api/types';
 
 export type ChatStreamEvent =
+  | { type: 'queued'; position: number }
   | { type: 'token'; content: string }
   | { type: 'done'; text?: string; usage?: ChatUsage; metrics?: ChatMetrics }
   | { type: 'error'; code?: string; message?: string };
@@ -44,9 +45,15 @@ export async function consumeSseStream(
     buffer = parts.pop() ?? '';
 
     for (const part of parts) {
-      if (!part.startsWith('data: ')) continue;
+      // Events carry an `id:` line (for resuming) before their `data:` line.
+      const data = part
+        .split('\n')
+        .filter((line) => line.startsWith('data: '))
+        .map((line) => line.slice(6))
+        .join('\n');
+      if (!data) continue;
       try {
-        const event = JSON.parse(part.slice(6)) as ChatStreamEvent;
+        const event = JSON.parse(data) as ChatStreamEvent;
         await onEvent(event);
       } catch (err) {
         console.error('Failed to parse SSE event:', err, part);
@@ -2,7 +2,7 @@ import { requestJson } from '../../shared/api/client';
 import type {
   ListModelsResponse,
   RegisterModelResponse,
-  SelectModelResponse,
+  ModelLoadJobResponse,
   UnloadModelResponse,
 } from '../../shared/api/types';
 
@@ -23,13 +23,24 @@ export async function selectModel(modelId: string, contextSize?: number) {
   if (contextSize !== undefined) {
     payload.context_size = contextSize;
   }
-  return requestJson<SelectModelResponse>('/api/models/select', {
+  return requestJson<ModelLoadJobResponse>('/api/models/select', {
     method: 'POST',
     headers: { 'Content-Type': 'application/json' },
     body: JSON.stringify(payload),
   });
 }
 
+export async function getModelLoadJob(jobId: string) {
+  return requestJson<ModelLoadJobResponse>(`/api/models/jobs/${encodeURIComponent(jobId)}`);
+}
+
+export async function cancelModelLoadJob(jobId: string) {
+  return requestJson<ModelLoadJobResponse>(
+    `/api/models/jobs/${encodeURIComponent(jobId)}/cancel`,
+    { method: 'POST' },
+  );
+}
+
 export async function unloadModel() {
   return requestJson<UnloadModelResponse>('/api/models/unload', { method: 'POST' });
 }
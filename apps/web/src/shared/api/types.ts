@@ -1,3 +1,19 @@
+export type GgufMetadata = {
+  gguf_version: number;
+  architecture: string;
+  tensor_count: number;
+  name?: string;
+  quantization?: string;
+  parameter_count?: number;
+  trained_context_length?: number;
+  block_count?: number;
+  embedding_length?: number;
+  head_count?: number;
+  head_count_kv?: number;
+  vocab_size?: number;
+  kv_bytes_per_token?: number;
+};
+
 export type ModelSummary = {
   id: string;
   display_name?: string;
@@ -5,6 +21,12 @@ export type ModelSummary = {
   status?: string;
   context_size?: number;
   file_size_bytes?: number;
+  shard_paths?: string[];
+  estimated_resident_bytes?: number;
+  metadata?: GgufMetadata;
+  resident?: boolean;
+  load_job_id?: string;
+  load_progress_percent?: number;
 };
 
 export type ListModelsResponse = {
@@ -16,8 +38,23 @@ export type RegisterModelResponse = {
   model: Pick<ModelSummary, 'id'>;
 };
 
-export type SelectModelResponse = {
-  active_model: Pick<ModelSummary, 'id'>;
+export type ModelLoadJob = {
+  id: string;
+  model_id: string;
+  context_size: number;
+  state: 'loading' | 'ready' | 'failed' | 'cancelled';
+  phase: 'queued' | 'reading' | 'initializing' | 'warming' | 'done';
+  bytes_total: number;
+  bytes_loaded: number;
+  progress_percent: number;
+  cancel_requested: boolean;
+  activate: boolean;
+  elapsed_ms: number;
+  error?: { code: string; message: string };
+};
+
+export type ModelLoadJobResponse = {
+  job: ModelLoadJob;
 };
 
 export type UnloadModelResponse = {
@@ -34,6 +71,10 @@ export type ChatMetrics = {
   latency_ms: number;
   time_to_first_token_ms: number;
   tokens_per_second: number;
+  prefix_cache_hit?: boolean;
+  prefix_tokens_reused?: number;
+  prefix_cache_hit_rate?: number;
+  prefill_tokens_saved?: number;
 };
 
 export type ChatResetResponse = {
@@ -41,6 +82,25 @@ export type ChatResetResponse = {
   model_id: string;
 };
 
+export type SessionSummary = {
+  id: string;
+  title: string;
+  model_id: string | null;
+  created_at: string;
+  updated_at: string;
+  message_count: number;
+  last_message_preview: string | null;
+};
+
+export type SessionDetail = SessionSummary & {
+  system_prompt: string;
+  messages: { role: "user" | "assistant"; content: string }[];
+};
+
+export type ListSessionsResponse = {
+  sessions: SessionSummary[];
+};
+
 export type ClearMemoryResponse = {
   status: string;
   model_id: string;
@@ -0,0 +1,77 @@
+// Microbenchmark: per-token cost of encoding SSE token events with a jsoncpp
+// DOM (the previous encoder) versus SseEventWriter. Prints heap allocations
+// and nanoseconds per token. Not registered with CTest; run by hand:
+//   ./petting_zoo_sse_writer_bench [tokens]
+#include "../../apps/server/src/sse_writer.hpp"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace {
+
+std::size_t g_allocations = 0;
+
+// Typical detokenized pieces, including multi-byte and escaped characters.
+constexpr std::array<std::string_view, 8> kTokens = {
+    " the", " quick", " brown", " fox", "\n", " caf\xC3\xA9", " \"quoted\"", " \xE2\x82\xAC" "5"};
+
+std::string jsoncpp_event(std::string_view token) {
+  Json::Value event(Json::objectValue);
+  event["type"] = "token";
+  event["content"] = std::string(token);
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return "data: " + Json::writeString(builder, event) + "\n\n";
+}
+
+template <typename Encode>
+void run(const char *name, long tokens, Encode encode) {
+  std::size_t bytes = 0;
+  encode(kTokens[0], bytes);  // Warm-up: first-use buffer growth
+  const auto allocations = g_allocations;
+  const auto started = std::chrono::steady_clock::now();
+  for (long i = 0; i < tokens; ++i) {
+    encode(kTokens[static_cast<std::size_t>(i) % kTokens.size()], bytes);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - started;
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  std::printf("%-14s %8.2f allocs/token %8.1f ns/token (%zu bytes)\n", name,
+              static_cast<double>(g_allocations - allocations) / static_cast<double>(tokens),
+              static_cast<double>(ns) / static_cast<double>(tokens), bytes);
+}
+
+}  // namespace
+
+void *operator new(std::size_t size) {
+  ++g_allocations;
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char **argv) {
+  const long tokens = argc > 1 ? std::atol(argv[1]) : 1'000'000;
+  if (tokens <= 0) {
+    std::fprintf(stderr, "usage: %s [tokens]\n", argv[0]);
+    return 1;
+  }
+  run("jsoncpp", tokens, [](std::string_view token, std::size_t &bytes) {
+    bytes += jsoncpp_event(token).size();
+  });
+  SseEventWriter writer;
+  std::string frame;
+  std::uint64_t id = 0;
+  run("SseEventWriter", tokens, [&](std::string_view token, std::size_t &bytes) {
+    frame.clear();
+    append_sse_event(frame, ++id, writer.token(token));
+    bytes += frame.size();
+  });
+  return 0;
+}
@@ -0,0 +1,172 @@
+#include "../../apps/server/src/admission_queue.hpp"
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+void test_admits_one_when_idle_with_zero_depth() {
+  AdmissionQueue queue(0);
+  auto first = queue.try_admit();
+  assert(first);
+  bool started = false;
+  queue.dispatch(*first, {}, [&started]() { started = true; });
+  assert(started);
+  assert(!queue.try_admit());
+}
+
+void test_rejects_when_full() {
+  AdmissionQueue queue(2);
+  auto running = queue.try_admit();
+  queue.dispatch(*running, {}, []() {});
+  auto a = queue.try_admit();
+  auto b = queue.try_admit();
+  assert(a && b);
+  assert(!queue.try_admit());
+  assert(queue.queued() == 2);
+  assert(queue.estimate_wait_seconds() >= 1);
+}
+
+void test_fifo_order_and_positions() {
+  AdmissionQueue queue(4);
+  auto running = queue.try_admit();
+  queue.dispatch(*running, {}, []() {});
+
+  std::vector<int> started;
+  std::vector<std::size_t> second_positions;
+  auto first = queue.try_admit();
+  auto second = queue.try_admit();
+  queue.dispatch(*first, {}, [&started]() { started.push_back(1); });
+  queue.dispatch(
+      *second, [&second_positions](std::size_t pos) { second_positions.push_back(pos); },
+      [&started]() { started.push_back(2); });
+  assert(second_positions.size() == 1 && second_positions[0] == 2);
+
+  running.reset();
+  assert(started.size() == 1 && started[0] == 1);
+  assert(second_positions.back() == 1);
+
+  first.reset();
+  assert(started.size() == 2 && started[1] == 2);
+}
+
+void test_cancelled_waiter_leaves_queue() {
+  AdmissionQueue queue(4);
+  auto running = queue.try_admit();
+  queue.dispatch(*running, {}, []() {});
+
+  bool abandoned_started = false;
+  bool next_started = false;
+  auto abandoned = queue.try_admit();
+  auto next = queue.try_admit();
+  queue.dispatch(*abandoned, {}, [&abandoned_started]() { abandoned_started = true; });
+  queue.dispatch(*next, {}, [&next_started]() { next_started = true; });
+
+  abandoned.reset();
+  assert(queue.queued() == 1);
+  running.reset();
+  assert(!abandoned_started);
+  assert(next_started);
+}
+
+void test_withdraw_drops_work_and_advances() {
+  AdmissionQueue queue(4);
+  auto running = queue.try_admit();
+  queue.dispatch(*running, {}, []() {});
+
+  std::vector<std::size_t> positions;
+  auto gone = queue.try_admit();
+  auto next = queue.try_admit();
+  const auto gone_id = gone->id();
+  // The work keeps its own ticket alive, as the runtime's jobs do.
+  queue.dispatch(*gone, {}, [gone]() { assert(false && "withdrawn work must not start"); });
+  queue.dispatch(*next, [&positions](std::size_t pos) { positions.push_back(pos); }, []() {});
+  gone.reset();
+  assert(positions.back() == 2);
+
+  queue.withdraw(gone_id);
+  assert(queue.queued() == 1);
+  assert(positions.back() == 1);
+}
+
+void test_retry_after_uses_recent_throughput() {
+  AdmissionQueue queue(1);
+  queue.record_completion(100, 50.0);
+  auto running = queue.try_admit();
+  queue.dispatch(*running, {}, []() {});
+  auto waiting = queue.try_admit();
+  // Two requests ahead at ~2s each.
+  assert(queue.estimate_wait_seconds() == 4);
+}
+
+void test_shutdown_drops_waiting_work() {
+  AdmissionQueue queue(4);
+  auto running = queue.try_admit();
+  queue.dispatch(*running, {}, []() {});
+
+  auto dropped_flag = std::make_shared<bool>(false);
+  struct Guard {
+    std::shared_ptr<bool> flag;
+    ~Guard() { *flag = true; }
+  };
+  auto waiting = queue.try_admit();
+  auto guard = std::make_shared<Guard>(dropped_flag);
+  bool rejected = false;
+  queue.dispatch(*waiting, {}, [guard, waiting]() { assert(false && "must not start"); },
+                 [&rejected]() { rejected = true; });
+  guard.reset();
+  waiting.reset();
+  assert(!*dropped_flag);
+
+  queue.shutdown();
+  assert(rejected);
+  assert(*dropped_flag);
+  assert(queue.queued() == 0);
+}
+
+void test_dispatch_after_shutdown_rejects() {
+  AdmissionQueue queue(4);
+  auto ticket = queue.try_admit();
+  queue.shutdown();
+
+  bool rejected = false;
+  queue.dispatch(*ticket, {}, []() { assert(false && "must not start"); },
+                 [&rejected]() { rejected = true; });
+  assert(rejected);
+  ticket.reset();
+  assert(queue.queued() == 0 && queue.running() == 0);
+}
+
+void test_runs_one_ticket_per_slot() {
+  AdmissionQueue queue(1, 2);
+  std::vector<int> started;
+  auto a = queue.try_admit();
+  auto b = queue.try_admit();
+  auto c = queue.try_admit();
+  assert(a && b && c);
+  assert(!queue.try_admit());
+  queue.dispatch(*a, {}, [&started]() { started.push_back(1); });
+  queue.dispatch(*b, {}, [&started]() { started.push_back(2); });
+  queue.dispatch(*c, {}, [&started]() { started.push_back(3); });
+  assert((started == std::vector<int>{1, 2}));
+  assert(queue.running() == 2 && queue.queued() == 1);
+
+  b.reset();
+  assert((started == std::vector<int>{1, 2, 3}));
+  assert(queue.running() == 2 && queue.queued() == 0);
+  auto d = queue.try_admit();
+  assert(d);
+  assert(!queue.try_admit());
+}
+
+int main() {
+  test_admits_one_when_idle_with_zero_depth();
+  test_rejects_when_full();
+  test_fifo_order_and_positions();
+  test_cancelled_waiter_leaves_queue();
+  test_withdraw_drops_work_and_advances();
+  test_retry_after_uses_recent_throughput();
+  test_shutdown_drops_waiting_work();
+  test_dispatch_after_shutdown_rejects();
+  test_runs_one_ticket_per_slot();
+  std::cout << "All admission queue tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,197 @@
+#include "../../apps/server/src/agent_cache.hpp"
+#include <cassert>
+#include <iostream>
+
+namespace {
+
+std::shared_ptr<ResidentAgent> make_resident(const std::string &id, std::uintmax_t bytes) {
+  return std::make_shared<ResidentAgent>(id, std::vector<std::shared_ptr<zoo::Agent>>(1), 2048,
+                                         bytes, 4);
+}
+
+}  // namespace
+
+void test_insert_within_budget_keeps_everything() {
+  AgentCache cache(100);
+  assert(cache.make_room(40).empty());
+  cache.insert(make_resident("a", 40));
+  assert(cache.make_room(40).empty());
+  cache.insert(make_resident("b", 40));
+  assert(cache.used_bytes() == 80);
+  assert(cache.peek("a") && cache.peek("b"));
+}
+
+void test_evicts_least_recently_used_first() {
+  AgentCache cache(100);
+  cache.insert(make_resident("a", 40));
+  cache.insert(make_resident("b", 40));
+  // Touch "a" so "b" becomes the eviction candidate.
+  assert(cache.get("a"));
+
+  auto evicted = cache.make_room(40);
+  assert(evicted.size() == 1);
+  assert(evicted[0]->model_id == "b");
+  assert(cache.used_bytes() == 40);
+  assert(!cache.peek("b"));
+}
+
+void test_oversized_model_evicts_all() {
+  AgentCache cache(100);
+  cache.insert(make_resident("a", 40));
+  cache.insert(make_resident("b", 40));
+  auto evicted = cache.make_room(500);
+  assert(evicted.size() == 2);
+  assert(cache.used_bytes() == 0);
+  cache.insert(make_resident("huge", 500));
+  assert(cache.peek("huge"));
+}
+
+void test_pinned_agents_survive_eviction() {
+  AgentCache cache(100);
+  cache.insert(make_resident("a", 40));
+  cache.insert(make_resident("b", 40));
+  // "a" is the LRU victim but pinned, so "b" goes and the budget is exceeded.
+  auto evicted = cache.make_room(60, {"a"});
+  assert(evicted.size() == 1);
+  assert(evicted[0]->model_id == "b");
+  assert(cache.peek("a"));
+  cache.insert(make_resident("c", 60));
+  assert(cache.used_bytes() == 100);
+
+  // Trimming after the fact keeps the pinned newcomer.
+  cache.insert(make_resident("d", 30));
+  evicted = cache.make_room(0, {"d"});
+  assert(evicted.size() == 1 && evicted[0]->model_id == "a");
+  assert(cache.used_bytes() == 90);
+}
+
+void test_insert_replaces_same_id() {
+  AgentCache cache(100);
+  cache.insert(make_resident("a", 40));
+  auto replaced = cache.insert(make_resident("a", 30));
+  assert(replaced && replaced->estimated_bytes == 40);
+  assert(cache.used_bytes() == 30);
+  assert(cache.entries().size() == 1);
+}
+
+void test_erase_releases_budget() {
+  AgentCache cache(100);
+  cache.insert(make_resident("a", 40));
+  assert(cache.erase("a"));
+  assert(!cache.erase("a"));
+  assert(cache.used_bytes() == 0);
+}
+
+void test_estimate_includes_kv_cache() {
+  const std::uintmax_t file = 8192ull * 1000;
+  assert(estimate_resident_bytes(file, 0) == file);
+  assert(estimate_resident_bytes(file, 2048) == file + 2048ull * 1000);
+  assert(estimate_resident_bytes(file, 2048, 131072) == file + 2048ull * 131072);
+  // Each sequence is a separate agent with its own weights and KV cache.
+  assert(estimate_resident_bytes(file, 2048, {}, 4) == 4 * (file + 2048ull * 1000));
+}
+
+void test_slots_prefer_their_last_conversation() {
+  ResidentAgent resident("m", std::vector<std::shared_ptr<zoo::Agent>>(2), 2048, 1, 4);
+  assert(resident.slots.size() == 2);
+  assert(resident.admission.max_running() == 2);
+  {
+    auto a = resident.acquire_slot(1);
+    auto b = resident.acquire_slot(2);
+    assert(a.index() != b.index());
+  }
+  std::size_t slot_for_two = 0;
+  {
+    auto again = resident.acquire_slot(2);
+    slot_for_two = again.index();
+    // Conversation 1's slot is the only one free.
+    auto other = resident.acquire_slot(3);
+    assert(other.index() != slot_for_two);
+  }
+  // Conversation 3 took over the other slot; conversation 2 kept its own.
+  auto back = resident.acquire_slot(2);
+  assert(back.index() == slot_for_two);
+}
+
+void test_pinned_conversation_never_forks() {
+  ResidentAgent resident("m", std::vector<std::shared_ptr<zoo::Agent>>(2), 2048, 1, 4);
+  std::size_t home = 0;
+  {
+    auto first = resident.acquire_slot(1, true);
+    home = first.index();
+    // While its slot is busy a second turn shares it instead of starting the
+    // conversation over on the free slot.
+    auto second = resident.acquire_slot(1, true);
+    assert(second.index() == home);
+    // Other conversations still get the free slot.
+    auto other = resident.acquire_slot(2);
+    assert(other.index() != home);
+  }
+  {
+    // Unpinned, a busy slot is never shared.
+    auto a = resident.acquire_slot(3);
+    auto b = resident.acquire_slot(3);
+    assert(a.index() != b.index());
+  }
+  // Conversation 3 took over both slots, so conversation 1 starts afresh on
+  // one of them, and stays there.
+  auto fresh = resident.acquire_slot(1, true);
+  auto again = resident.acquire_slot(1, true);
+  assert(again.index() == fresh.index());
+}
+
+void test_avoided_conversation_keeps_its_slot() {
+  ResidentAgent resident("m", std::vector<std::shared_ptr<zoo::Agent>>(2), 2048, 1, 4);
+  std::size_t home = 0;
+  {
+    auto stateless = resident.acquire_slot(1, true);
+    home = stateless.index();
+  }
+  // The other slot is taken even while it is busy and the avoided one is the
+  // least recently used.
+  auto first = resident.acquire_slot(9, false, 1);
+  assert(first.index() != home);
+  auto second = resident.acquire_slot(9, false, 1);
+  assert(second.index() == first.index());
+  // The avoided conversation was left where it was.
+  auto stateless = resident.acquire_slot(1, true);
+  assert(stateless.index() == home);
+}
+
+void test_stateless_transcript_keeps_the_newest_turns() {
+  ResidentAgent resident("m", std::vector<std::shared_ptr<zoo::Agent>>(1), 2048, 1, 4);
+  assert(resident.stateless_transcript().empty());
+  resident.record_stateless_turn("q1", "a1", 10);
+  resident.record_stateless_turn("q2", "a2", 10);
+  assert(resident.stateless_transcript().size() == 4);
+
+  // Over budget: whole turns go, oldest first.
+  resident.record_stateless_turn("q3", "a3", 10);
+  auto transcript = resident.stateless_transcript();
+  assert(transcript.size() == 4);
+  assert(transcript[0].role == "user" && transcript[0].content == "q2");
+  assert(transcript[3].role == "assistant" && transcript[3].content == "a3");
+
+  // The newest turn stays even when it alone is over budget.
+  resident.record_stateless_turn(std::string(64, 'q'), "a", 10);
+  assert(resident.stateless_transcript().size() == 2);
+
+  resident.clear_stateless_transcript();
+  assert(resident.stateless_transcript().empty());
+}
+
+int main() {
+  test_insert_within_budget_keeps_everything();
+  test_evicts_least_recently_used_first();
+  test_oversized_model_evicts_all();
+  test_pinned_agents_survive_eviction();
+  test_insert_replaces_same_id();
+  test_erase_releases_budget();
+  test_estimate_includes_kv_cache();
+  test_slots_prefer_their_last_conversation();
+  test_pinned_conversation_never_forks();
+  test_avoided_conversation_keeps_its_slot();
+  test_stateless_transcript_keeps_the_newest_turns();
+  std::cout << "All agent cache tests passed!" << std::endl;
+  return 0;
+}
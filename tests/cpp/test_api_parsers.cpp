@@ -9,22 +9,23 @@ void test_parse_chat_complete_request_valid() {
   req["message"] = "hello";
   
   auto json_ptr = std::make_shared<Json::Value>(req);
-  std::string message;
+  ParsedChatRequest parsed;
   Json::Value details;
   
-  auto err = parse_chat_complete_request(json_ptr, message, details);
+  auto err = parse_chat_complete_request(json_ptr, parsed, details);
   assert(!err.has_value());
-  assert(message == "hello");
+  assert(parsed.message == "hello");
+  assert(!parsed.model_id.has_value());
 }
 
 void test_parse_chat_complete_request_missing_message() {
   Json::Value req(Json::objectValue);
   
   auto json_ptr = std::make_shared<Json::Value>(req);
-  std::string message;
+  ParsedChatRequest parsed;
   Json::Value details;
   
-  auto err = parse_chat_complete_request(json_ptr, message, details);
+  auto err = parse_chat_complete_request(json_ptr, parsed, details);
   assert(err.has_value());
   assert(details["field"].asString() == "message");
 }
@@ -34,18 +35,218 @@ void test_parse_chat_complete_request_empty_message() {
   req["message"] = "";
   
   auto json_ptr = std::make_shared<Json::Value>(req);
-  std::string message;
+  ParsedChatRequest parsed;
   Json::Value details;
   
-  auto err = parse_chat_complete_request(json_ptr, message, details);
+  auto err = parse_chat_complete_request(json_ptr, parsed, details);
   assert(err.has_value());
   assert(details["field"].asString() == "message");
 }
 
+void test_parse_chat_complete_request_with_model_id() {
+  Json::Value req(Json::objectValue);
+  req["message"] = "hello";
+  req["model_id"] = "llama-3";
+
+  auto json_ptr = std::make_shared<Json::Value>(req);
+  ParsedChatRequest parsed;
+  Json::Value details;
+
+  auto err = parse_chat_complete_request(json_ptr, parsed, details);
+  assert(!err.has_value());
+  assert(parsed.model_id == std::optional<std::string>("llama-3"));
+}
+
+void test_parse_chat_complete_request_invalid_model_id() {
+  Json::Value req(Json::objectValue);
+  req["message"] = "hello";
+  req["model_id"] = 7;
+
+  auto json_ptr = std::make_shared<Json::Value>(req);
+  ParsedChatRequest parsed;
+  Json::Value details;
+
+  auto err = parse_chat_complete_request(json_ptr, parsed, details);
+  assert(err.has_value());
+  assert(details["field"].asString() == "model_id");
+}
+
+void test_parse_chat_stream_options() {
+  Json::Value req(Json::objectValue);
+  req["message"] = "Hi";
+  req["stream_options"]["flush_interval_ms"] = 0;
+  auto json_ptr = std::make_shared<Json::Value>(req);
+  ParsedChatRequest parsed;
+  Json::Value details;
+  assert(!parse_chat_complete_request(json_ptr, parsed, details).has_value());
+  assert(parsed.flush_interval_ms == 0 && !parsed.flush_bytes.has_value());
+  assert(!parsed.resumable && !parsed.isolated);
+
+  (*json_ptr)["isolated"] = true;
+  ParsedChatRequest isolated;
+  assert(!parse_chat_complete_request(json_ptr, isolated, details).has_value());
+  assert(isolated.isolated);
+  (*json_ptr)["isolated"] = 1;
+  assert(parse_chat_complete_request(json_ptr, isolated, details).has_value());
+  assert(details["field"].asString() == "isolated");
+  json_ptr->removeMember("isolated");
+
+  (*json_ptr)["stream_options"]["resumable"] = true;
+  ParsedChatRequest resumable;
+  assert(!parse_chat_complete_request(json_ptr, resumable, details).has_value());
+  assert(resumable.resumable);
+
+  (*json_ptr)["stream_options"]["resumable"] = "yes";
+  ParsedChatRequest not_bool;
+  assert(parse_chat_complete_request(json_ptr, not_bool, details).has_value());
+  assert(details["field"].asString() == "stream_options.resumable");
+  (*json_ptr)["stream_options"]["resumable"] = false;
+
+  (*json_ptr)["stream_options"]["flush_bytes"] = 0;
+  ParsedChatRequest invalid;
+  assert(parse_chat_complete_request(json_ptr, invalid, details).has_value());
+  assert(details["field"].asString() == "stream_options.flush_bytes");
+}
+
+void test_parse_model_register_request_load_options() {
+  Json::Value req(Json::objectValue);
+  req["path"] = "/models/a.gguf";
+  req["load_options"]["prefetch"] = "madvise";
+  req["load_options"]["mlock"] = true;
+
+  auto json_ptr = std::make_shared<Json::Value>(req);
+  ParsedModelRegisterRequest parsed;
+  Json::Value details;
+
+  auto err = parse_model_register_request(json_ptr, parsed, details);
+  assert(!err.has_value());
+  assert(parsed.load_options.has_value());
+  assert(parsed.load_options->prefetch == PrefetchMode::kMadvise);
+  assert(parsed.load_options->mlock);
+
+  (*json_ptr)["load_options"]["prefetch"] = "mmap";
+  ParsedModelRegisterRequest invalid;
+  err = parse_model_register_request(json_ptr, invalid, details);
+  assert(err.has_value());
+  assert(details["field"].asString() == "load_options.prefetch");
+}
+
+void test_parse_session_create_request() {
+  ParsedSessionCreateRequest defaults;
+  Json::Value details;
+  assert(!parse_session_create_request(nullptr, defaults, details).has_value());
+  assert(!defaults.title.has_value() && !defaults.model_id.has_value());
+
+  Json::Value req(Json::objectValue);
+  req["title"] = "Trip planning";
+  req["system_prompt"] = "Be brief.";
+  auto json_ptr = std::make_shared<Json::Value>(req);
+  ParsedSessionCreateRequest parsed;
+  assert(!parse_session_create_request(json_ptr, parsed, details).has_value());
+  assert(parsed.title == "Trip planning");
+  assert(parsed.system_prompt == "Be brief.");
+
+  (*json_ptr)["title"] = std::string(161, 'x');
+  ParsedSessionCreateRequest too_long;
+  assert(parse_session_create_request(json_ptr, too_long, details).has_value());
+  assert(details["field"].asString() == "title");
+}
+
+void test_parse_chat_send_request_detached() {
+  Json::Value req(Json::objectValue);
+  req["message"] = "Hi";
+  auto json_ptr = std::make_shared<Json::Value>(req);
+  ParsedChatSendRequest plain;
+  Json::Value details;
+  assert(!parse_chat_send_request(json_ptr, plain, details).has_value());
+  assert(plain.message == "Hi" && !plain.stream && !plain.request_id.has_value());
+
+  (*json_ptr)["request_id"] = "tab-1_retry.2";
+  (*json_ptr)["options"]["stream"] = true;
+  ParsedChatSendRequest detached;
+  assert(!parse_chat_send_request(json_ptr, detached, details).has_value());
+  assert(detached.stream && detached.request_id == "tab-1_retry.2");
+
+  (*json_ptr)["request_id"] = "has space";
+  ParsedChatSendRequest bad_id;
+  assert(parse_chat_send_request(json_ptr, bad_id, details).has_value());
+  assert(details["field"].asString() == "request_id");
+
+  (*json_ptr)["request_id"] = "ok";
+  (*json_ptr)["options"]["stream"] = "yes";
+  ParsedChatSendRequest bad_stream;
+  assert(parse_chat_send_request(json_ptr, bad_stream, details).has_value());
+  assert(details["field"].asString() == "options.stream");
+}
+
+void test_parse_stream_resume_position() {
+  std::uint64_t after = 99;
+  Json::Value details;
+  assert(!parse_stream_resume_position("", "", after, details).has_value());
+  assert(after == 0);
+  assert(!parse_stream_resume_position("12", "", after, details).has_value());
+  assert(after == 12);
+  // The header wins; from_seq names the first event wanted.
+  assert(!parse_stream_resume_position("12", "3", after, details).has_value());
+  assert(after == 12);
+  assert(!parse_stream_resume_position("", "3", after, details).has_value());
+  assert(after == 2);
+
+  assert(parse_stream_resume_position("12abc", "", after, details).has_value());
+  assert(details["field"].asString() == "Last-Event-ID");
+  assert(parse_stream_resume_position("", "0", after, details).has_value());
+  assert(details["field"].asString() == "from_seq");
+  assert(parse_stream_resume_position("", "-1", after, details).has_value());
+}
+
+void test_parse_chat_socket_message() {
+  const auto parse = [](const char *text, ParsedChatSocketMessage &out, Json::Value &details) {
+    auto json = std::make_shared<Json::Value>();
+    Json::Reader().parse(text, *json);
+    return parse_chat_socket_message(json, out, details);
+  };
+  Json::Value details;
+
+  ParsedChatSocketMessage send;
+  assert(!parse(R"({"type":"send","message":"Hi","request_id":"r-1"})", send, details));
+  assert(send.type == "send" && send.send.message == "Hi" && send.send.request_id == "r-1");
+
+  ParsedChatSocketMessage subscribe;
+  assert(!parse(R"({"type":"subscribe","request_id":"stream_00ab","from_seq":5})", subscribe,
+                details));
+  assert(subscribe.request_id == "stream_00ab" && subscribe.after_seq == 4);
+
+  ParsedChatSocketMessage cancel;
+  assert(!parse(R"({"type":"cancel","request_id":"r-1"})", cancel, details));
+  assert(cancel.type == "cancel" && cancel.request_id == "r-1" && cancel.after_seq == 0);
+
+  ParsedChatSocketMessage ping;
+  assert(!parse(R"({"type":"ping"})", ping, details));
+
+  ParsedChatSocketMessage bad;
+  assert(parse(R"({"type":"send"})", bad, details));
+  assert(details["field"].asString() == "message");
+  assert(parse(R"({"type":"cancel"})", bad, details));
+  assert(details["field"].asString() == "request_id");
+  assert(parse(R"({"type":"subscribe","request_id":"r","from_seq":0})", bad, details));
+  assert(details["field"].asString() == "from_seq");
+  assert(parse(R"({"type":"shout"})", bad, details));
+  assert(details["field"].asString() == "type");
+  assert(parse(R"([1,2])", bad, details));
+}
+
 int main() {
   test_parse_chat_complete_request_valid();
   test_parse_chat_complete_request_missing_message();
   test_parse_chat_complete_request_empty_message();
+  test_parse_chat_complete_request_with_model_id();
+  test_parse_chat_complete_request_invalid_model_id();
+  test_parse_chat_stream_options();
+  test_parse_model_register_request_load_options();
+  test_parse_session_create_request();
+  test_parse_chat_send_request_detached();
+  test_parse_stream_resume_position();
+  test_parse_chat_socket_message();
   std::cout << "All parse tests passed!" << std::endl;
   return 0;
 }
@@ -0,0 +1,90 @@
+#include "../../apps/server/src/completion_cache.hpp"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+namespace {
+
+zoo::Response reply(const std::string &text) {
+  zoo::Response response;
+  response.text = text;
+  return response;
+}
+
+}  // namespace
+
+void test_keys_separate_every_input() {
+  const auto key = completion_cache_key("m", 1, "ctx=2048", "hi");
+  assert(key == completion_cache_key("m", 1, "ctx=2048", "hi"));
+  assert(key != completion_cache_key("m2", 1, "ctx=2048", "hi"));
+  assert(key != completion_cache_key("m", 2, "ctx=2048", "hi"));
+  assert(key != completion_cache_key("m", 1, "ctx=4096", "hi"));
+  assert(key != completion_cache_key("m", 1, "ctx=2048", "hi!"));
+}
+
+void test_hits_return_the_stored_reply() {
+  CompletionCache cache(64 * 1024);
+  assert(cache.enabled());
+  const auto key = completion_cache_key("m", 1, "p", "What is 2+2?");
+  assert(!cache.find(key).has_value());
+
+  cache.insert(key, reply("4"));
+  const auto hit = cache.find(key);
+  assert(hit.has_value() && hit->text == "4");
+
+  cache.insert(key, reply("four"));  // Replaces
+  assert(cache.size() == 1 && cache.find(key)->text == "four");
+}
+
+void test_evicts_least_recently_used_by_bytes() {
+  const std::string text(400, 'x');
+  // Room for two entries of about 550 bytes each.
+  CompletionCache cache(1200);
+  const auto a = completion_cache_key("m", 1, "p", "a");
+  const auto b = completion_cache_key("m", 1, "p", "b");
+  const auto c = completion_cache_key("m", 1, "p", "c");
+  cache.insert(a, reply(text));
+  cache.insert(b, reply(text));
+  assert(cache.find(a).has_value());  // b is now the oldest
+  cache.insert(c, reply(text));
+  assert(cache.size() == 2 && cache.bytes() <= 1200);
+  assert(cache.find(a).has_value() && !cache.find(b).has_value() && cache.find(c).has_value());
+
+  cache.insert(completion_cache_key("m", 1, "p", "huge"), reply(std::string(4096, 'y')));
+  assert(cache.size() == 2);  // Larger than the budget: not kept, nothing evicted
+}
+
+void test_erase_model_and_clear() {
+  CompletionCache cache(64 * 1024);
+  cache.insert(completion_cache_key("llama", 1, "p", "q"), reply("a"));
+  cache.insert(completion_cache_key("llama-70b", 1, "p", "q"), reply("b"));
+  cache.insert(completion_cache_key("mistral", 1, "p", "q"), reply("c"));
+
+  cache.erase_model("llama");
+  assert(!cache.find(completion_cache_key("llama", 1, "p", "q")).has_value());
+  // Only exact model ids match, not prefixes.
+  assert(cache.find(completion_cache_key("llama-70b", 1, "p", "q")).has_value());
+  assert(cache.size() == 2);
+
+  cache.clear();
+  assert(cache.size() == 0 && cache.bytes() == 0);
+  assert(!cache.find(completion_cache_key("mistral", 1, "p", "q")).has_value());
+}
+
+void test_zero_budget_disables() {
+  CompletionCache cache(0);
+  assert(!cache.enabled());
+  const auto key = completion_cache_key("m", 1, "p", "q");
+  cache.insert(key, reply("a"));
+  assert(!cache.find(key).has_value());
+}
+
+int main() {
+  test_keys_separate_every_input();
+  test_hits_return_the_stored_reply();
+  test_evicts_least_recently_used_by_bytes();
+  test_erase_model_and_clear();
+  test_zero_budget_disables();
+  std::cout << "All completion cache tests passed!" << std::endl;
+  return 0;
+}
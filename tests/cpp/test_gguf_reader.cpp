@@ -0,0 +1,130 @@
+#include "../../apps/server/src/gguf_reader.hpp"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Minimal GGUF v3 writer for fixtures.
+class GgufWriter {
+ public:
+  template <typename T>
+  void put(T value) {
+    const auto *bytes = reinterpret_cast<const char *>(&value);
+    buf_.insert(buf_.end(), bytes, bytes + sizeof(T));
+  }
+  void put_string(const std::string &s) {
+    put<std::uint64_t>(s.size());
+    buf_.insert(buf_.end(), s.begin(), s.end());
+  }
+  void kv_string(const std::string &key, const std::string &value) {
+    put_string(key);
+    put<std::uint32_t>(8);
+    put_string(value);
+  }
+  void kv_u32(const std::string &key, std::uint32_t value) {
+    put_string(key);
+    put<std::uint32_t>(4);
+    put<std::uint32_t>(value);
+  }
+  void kv_string_array(const std::string &key, const std::vector<std::string> &values) {
+    put_string(key);
+    put<std::uint32_t>(9);
+    put<std::uint32_t>(8);
+    put<std::uint64_t>(values.size());
+    for (const auto &v : values) {
+      put_string(v);
+    }
+  }
+  void tensor(const std::string &name, const std::vector<std::uint64_t> &dims) {
+    put_string(name);
+    put<std::uint32_t>(static_cast<std::uint32_t>(dims.size()));
+    for (const auto d : dims) {
+      put<std::uint64_t>(d);
+    }
+    put<std::uint32_t>(0);
+    put<std::uint64_t>(0);
+  }
+  std::string save(const std::string &file_name, std::size_t truncate_to = 0) const {
+    const auto path = std::filesystem::temp_directory_path() / file_name;
+    std::ofstream out(path, std::ios::binary);
+    const auto size = truncate_to > 0 ? truncate_to : buf_.size();
+    out.write(buf_.data(), static_cast<std::streamsize>(size));
+    return path.string();
+  }
+  std::size_t size() const { return buf_.size(); }
+
+ private:
+  std::vector<char> buf_;
+};
+
+GgufWriter llama_fixture() {
+  GgufWriter w;
+  w.put<std::uint32_t>(0x46554747u);
+  w.put<std::uint32_t>(3);
+  w.put<std::uint64_t>(2);  // tensors
+  w.put<std::uint64_t>(9);  // kv pairs
+  w.kv_string("general.architecture", "llama");
+  w.kv_string("general.name", "Tiny Llama");
+  w.kv_u32("general.file_type", 15);
+  w.kv_u32("llama.context_length", 4096);
+  w.kv_u32("llama.block_count", 32);
+  w.kv_u32("llama.embedding_length", 4096);
+  w.kv_u32("llama.attention.head_count", 32);
+  w.kv_u32("llama.attention.head_count_kv", 8);
+  w.kv_string_array("tokenizer.ggml.tokens", {"<s>", "</s>", "hello"});
+  w.tensor("token_embd.weight", {4096, 32000});
+  w.tensor("output_norm.weight", {4096});
+  return w;
+}
+
+}  // namespace
+
+void test_reads_llama_metadata() {
+  const auto path = llama_fixture().save("petting_zoo_gguf_ok.gguf");
+  std::string error;
+  const auto meta = read_gguf_metadata(path, error);
+  assert(meta.has_value());
+  assert(meta->version == 3);
+  assert(meta->architecture == "llama");
+  assert(meta->name == std::optional<std::string>("Tiny Llama"));
+  assert(meta->quantization == std::optional<std::string>("Q4_K_M"));
+  assert(meta->context_length == std::optional<std::uint64_t>(4096));
+  assert(meta->block_count == std::optional<std::uint64_t>(32));
+  assert(meta->tensor_count == 2);
+  assert(meta->parameter_count == std::optional<std::uint64_t>(4096ull * 32000 + 4096));
+  // 2 (K,V) * 32 layers * (4096 * 8 / 32) * 2 bytes
+  assert(meta->kv_bytes_per_token() == std::optional<std::uint64_t>(2ull * 32 * 1024 * 2));
+  assert(meta->vocab_size == std::optional<std::uint64_t>(3));
+  std::remove(path.c_str());
+}
+
+void test_rejects_truncated_and_foreign_files() {
+  const auto fixture = llama_fixture();
+  const auto truncated = fixture.save("petting_zoo_gguf_truncated.gguf", fixture.size() - 5);
+  std::string error;
+  assert(!read_gguf_metadata(truncated, error).has_value());
+  assert(!error.empty());
+  std::remove(truncated.c_str());
+
+  GgufWriter other;
+  other.put<std::uint32_t>(0x12345678u);
+  other.put<std::uint32_t>(3);
+  const auto foreign = other.save("petting_zoo_gguf_foreign.gguf");
+  error.clear();
+  assert(!read_gguf_metadata(foreign, error).has_value());
+  assert(error == "Not a GGUF file");
+  std::remove(foreign.c_str());
+}
+
+int main() {
+  test_reads_llama_metadata();
+  test_rejects_truncated_and_foreign_files();
+  std::cout << "All GGUF reader tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include "../../apps/server/src/inference_executor.hpp"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void test_runs_jobs_in_fifo_order() {
+  InferenceExecutor executor(1);
+  std::vector<int> order;
+  std::promise<void> finished;
+  for (int i = 0; i < 5; ++i) {
+    assert(executor.submit([&order, i]() { order.push_back(i); }));
+  }
+  assert(executor.submit([&finished]() { finished.set_value(); }));
+  finished.get_future().wait();
+  assert((order == std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+void test_shutdown_rejects_queued_and_finishes_running() {
+  InferenceExecutor executor(1);
+  std::promise<void> started;
+  std::promise<void> release;
+  auto release_future = release.get_future().share();
+  std::atomic<bool> running_finished{false};
+  executor.submit([&started, release_future, &running_finished]() {
+    started.set_value();
+    release_future.wait();
+    running_finished = true;
+  });
+  started.get_future().wait();
+
+  std::atomic<int> rejected{0};
+  for (int i = 0; i < 3; ++i) {
+    executor.submit([]() { assert(false && "queued job must not run"); },
+                    [&rejected]() { ++rejected; });
+  }
+
+  // close() answers the queued jobs without waiting for the running one.
+  executor.close();
+  assert(rejected == 3);
+  assert(!running_finished);
+
+  release.set_value();
+  executor.shutdown();
+  assert(running_finished);
+}
+
+void test_wait_idle_is_bounded() {
+  InferenceExecutor executor(1);
+  assert(executor.wait_idle(std::chrono::milliseconds(0)));
+
+  std::promise<void> started;
+  std::promise<void> release;
+  auto release_future = release.get_future().share();
+  executor.submit([&started, release_future]() {
+    started.set_value();
+    release_future.wait();
+  });
+  started.get_future().wait();
+  executor.close();
+  // A job that does not return in time is reported, not waited out.
+  assert(!executor.wait_idle(std::chrono::milliseconds(20)));
+
+  release.set_value();
+  assert(executor.wait_idle(std::chrono::seconds(5)));
+  executor.shutdown();
+}
+
+void test_submit_after_shutdown_rejects() {
+  InferenceExecutor executor(2);
+  executor.shutdown();
+  bool rejected = false;
+  assert(!executor.submit([]() { assert(false && "must not run"); },
+                          [&rejected]() { rejected = true; }));
+  assert(rejected);
+  // Without a reject callback the job is simply refused.
+  assert(!executor.submit([]() {}));
+  executor.shutdown();  // Idempotent
+}
+
+void test_throwing_job_does_not_stop_the_worker() {
+  InferenceExecutor executor(1);
+  std::promise<void> finished;
+  executor.submit([]() { throw std::runtime_error("boom"); });
+  executor.submit([&finished]() { finished.set_value(); });
+  assert(finished.get_future().wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+}
+
+int main() {
+  test_runs_jobs_in_fifo_order();
+  test_shutdown_rejects_queued_and_finishes_running();
+  test_wait_idle_is_bounded();
+  test_submit_after_shutdown_rejects();
+  test_throwing_job_does_not_stop_the_worker();
+  std::cout << "All inference executor tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "../../apps/server/src/model_discovery.hpp"
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path make_tree(const std::string &name) {
+  const auto root = fs::temp_directory_path() / name;
+  fs::remove_all(root);
+  fs::create_directories(root);
+  return root;
+}
+
+void touch(const fs::path &path, const std::string &contents = "gguf") {
+  fs::create_directories(path.parent_path());
+  std::ofstream(path, std::ios::binary) << contents;
+}
+
+std::vector<std::string> relative_paths(const DiscoveryResult &result, const fs::path &root) {
+  std::vector<std::string> out;
+  for (const auto &model : result.models) {
+    out.push_back(fs::path(model.path).lexically_relative(root).string());
+  }
+  return out;
+}
+
+}  // namespace
+
+void test_parse_shard_name() {
+  const auto shard = parse_shard_name("/m/llama-70b-00002-of-00004.gguf");
+  assert(shard.has_value());
+  assert(shard->base == "/m/llama-70b");
+  assert(shard->index == 2 && shard->count == 4);
+  assert(!parse_shard_name("/m/llama-70b.gguf").has_value());
+  assert(!parse_shard_name("/m/x-00005-of-00004.gguf").has_value());
+}
+
+void test_walks_nested_trees_to_max_depth() {
+  const auto root = make_tree("petting_zoo_discovery_depth");
+  touch(root / "top.gguf");
+  touch(root / "vendor" / "family" / "nested.gguf");
+  touch(root / "a" / "b" / "c" / "too-deep.gguf");
+  touch(root / "vendor" / "notes.txt");
+
+  DiscoveryOptions options;
+  options.max_depth = 2;
+  const auto result = discover_models({root.string()}, options);
+  assert(relative_paths(result, root) ==
+         (std::vector<std::string>{"top.gguf", "vendor/family/nested.gguf"}));
+
+  options.max_depth = 0;
+  assert(relative_paths(discover_models({root.string()}, options), root) ==
+         std::vector<std::string>{"top.gguf"});
+  fs::remove_all(root);
+}
+
+void test_include_and_exclude_globs() {
+  const auto root = make_tree("petting_zoo_discovery_globs");
+  touch(root / "llama" / "llama-8b.Q4_K_M.gguf");
+  touch(root / "llama" / "llama-8b.F16.gguf");
+  touch(root / "archive" / "old.Q4_K_M.gguf");
+
+  DiscoveryOptions options;
+  options.include_globs = {"*Q4_K_M*"};
+  options.exclude_globs = {"archive"};
+  const auto result = discover_models({root.string()}, options);
+  assert(relative_paths(result, root) ==
+         std::vector<std::string>{"llama/llama-8b.Q4_K_M.gguf"});
+
+  assert(is_discoverable((root / "llama" / "x.Q4_K_M.gguf").string(), {root.string()}, options));
+  assert(!is_discoverable((root / "llama" / "x.F16.gguf").string(), {root.string()}, options));
+  assert(!is_discoverable((root / "archive" / "y.Q4_K_M.gguf").string(), {root.string()},
+                          options));
+  assert(!is_discoverable("/elsewhere/z.Q4_K_M.gguf", {root.string()}, options));
+  fs::remove_all(root);
+}
+
+void test_groups_complete_shard_sets() {
+  const auto root = make_tree("petting_zoo_discovery_shards");
+  touch(root / "big-00001-of-00002.gguf", "aaaa");
+  touch(root / "big-00002-of-00002.gguf", "bb");
+  touch(root / "partial-00001-of-00003.gguf");
+
+  const auto result = discover_models({root.string()}, DiscoveryOptions{});
+  assert(result.models.size() == 1);
+  const auto &model = result.models[0];
+  assert(model.path == (root / "big-00001-of-00002.gguf").string());
+  assert(model.shard_paths.size() == 2);
+  assert(model.size_bytes == 6);
+  assert(std::any_of(result.warnings.begin(), result.warnings.end(),
+                     [](const std::string &w) { return w.find("partial") != std::string::npos; }));
+
+  std::string error;
+  const auto set = find_shard_set((root / "big-00001-of-00002.gguf").string(), error);
+  assert(set.has_value() && set->shard_paths == model.shard_paths && set->size_bytes == 6);
+  assert(!find_shard_set((root / "big-00002-of-00002.gguf").string(), error).has_value());
+  assert(!find_shard_set((root / "partial-00001-of-00003.gguf").string(), error).has_value());
+  fs::remove_all(root);
+}
+
+void test_parallel_walk_finds_every_file() {
+  const auto root = make_tree("petting_zoo_discovery_parallel");
+  for (int vendor = 0; vendor < 8; ++vendor) {
+    for (int family = 0; family < 8; ++family) {
+      const auto dir = root / ("v" + std::to_string(vendor)) / ("f" + std::to_string(family));
+      for (int i = 0; i < 4; ++i) {
+        touch(dir / ("m" + std::to_string(i) + ".gguf"));
+      }
+    }
+  }
+  DiscoveryOptions options;
+  options.workers = 8;
+  const auto result = discover_models({root.string(), root.string()}, options);
+  assert(result.models.size() == 8 * 8 * 4);
+  assert(result.directories.size() == 1 + 8 + 8 * 8);
+  assert(std::is_sorted(result.models.begin(), result.models.end(),
+                        [](const auto &a, const auto &b) { return a.path < b.path; }));
+  fs::remove_all(root);
+}
+
+int main() {
+  test_parse_shard_name();
+  test_walks_nested_trees_to_max_depth();
+  test_include_and_exclude_globs();
+  test_groups_complete_shard_sets();
+  test_parallel_walk_finds_every_file();
+  std::cout << "All model discovery tests passed!" << std::endl;
+  return 0;
+}
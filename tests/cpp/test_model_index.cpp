@@ -0,0 +1,179 @@
+#include "../../apps/server/src/model_index.hpp"
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path make_dir(const std::string &name) {
+  const auto dir = fs::temp_directory_path() / name;
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  return dir;
+}
+
+void write_file(const fs::path &path, const std::string &contents) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << contents;
+}
+
+const ModelIndexEntry *find_path(const ModelIndexScan &scan, const fs::path &path) {
+  for (const auto &entry : scan.entries) {
+    if (entry.path == path.string()) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+ModelIndexScan rescan(std::vector<ModelIndexEntry> indexed,
+                      const std::vector<std::string> &dirs) {
+  return rescan_model_index(std::move(indexed), dirs, DiscoveryOptions{}, ModelLoadOptions{});
+}
+
+}  // namespace
+
+void test_sanitize_and_allocate_ids() {
+  assert(sanitize_model_id("Llama-3 8B.Q4") == "llama-3-8b-q4");
+  assert(sanitize_model_id("__") == "model");
+  const auto taken = [](const std::string &id) { return id == "tiny" || id == "tiny-2"; };
+  assert(allocate_model_id("/m/Tiny.gguf", taken) == "tiny-3");
+  assert(allocate_model_id("/m/other.gguf", taken) == "other");
+}
+
+void test_is_within_model_dirs() {
+  assert(is_within_model_dirs("/srv/models/a.gguf", {"/srv/models"}));
+  assert(is_within_model_dirs("/srv/models/sub/../a.gguf", {"/srv/models/"}));
+  assert(!is_within_model_dirs("/srv/models2/a.gguf", {"/srv/models"}));
+  assert(!is_within_model_dirs("/srv/models/../etc/passwd", {"/srv/models"}));
+}
+
+void test_rescan_is_incremental_and_ids_are_stable() {
+  const auto dir = make_dir("petting_zoo_index_scan");
+  write_file(dir / "Tiny.gguf", "not really gguf");
+  write_file(dir / "tiny.gguf", "also not gguf");
+  write_file(dir / "notes.txt", "ignored");
+  const std::vector<std::string> dirs = {dir.string()};
+
+  auto first = rescan({}, dirs);
+  assert(first.entries.size() == 2);
+  assert(first.reparsed == 2 && first.reused == 0 && first.changed());
+  assert(first.warnings.size() == 2);  // Headers are unparseable, entries kept
+  const auto upper_id = find_path(first, dir / "Tiny.gguf")->id;
+  const auto lower_id = find_path(first, dir / "tiny.gguf")->id;
+  assert(upper_id != lower_id);
+
+  // Unchanged files are only re-stat()ed and keep their ids.
+  auto second = rescan(first.entries, dirs);
+  assert(second.reused == 2 && second.reparsed == 0 && !second.changed());
+  assert(find_path(second, dir / "Tiny.gguf")->id == upper_id);
+  assert(find_path(second, dir / "tiny.gguf")->id == lower_id);
+
+  // A changed file is re-read, a new one picked up, a deleted one dropped.
+  write_file(dir / "Tiny.gguf", "grown: not really gguf");
+  write_file(dir / "fresh.gguf", "new");
+  fs::remove(dir / "tiny.gguf");
+  auto third = rescan(second.entries, dirs);
+  assert(third.reparsed == 2 && third.dropped == 1 && third.reused == 0);
+  assert(third.entries.size() == 2);
+  assert(find_path(third, dir / "Tiny.gguf")->id == upper_id);
+  assert(find_path(third, dir / "fresh.gguf")->id == "fresh");
+  fs::remove_all(dir);
+}
+
+void test_split_models_are_one_entry() {
+  const auto dir = make_dir("petting_zoo_index_split");
+  write_file(dir / "big-00001-of-00002.gguf", "shard one");
+  write_file(dir / "big-00002-of-00002.gguf", "shard two");
+  auto scan = rescan({}, {dir.string()});
+  assert(scan.entries.size() == 1);
+  const auto &entry = scan.entries[0];
+  assert(entry.id == "big" && entry.display_name == "big.gguf");
+  assert(entry.path == (dir / "big-00001-of-00002.gguf").string());
+  assert(entry.shard_paths.size() == 2);
+  assert(entry.file_size_bytes == 18);
+  assert(model_files(entry) == entry.shard_paths);
+
+  // Losing a shard drops the (discovered) set.
+  fs::remove(dir / "big-00002-of-00002.gguf");
+  auto after = rescan(scan.entries, {dir.string()});
+  assert(after.entries.empty() && after.dropped == 1);
+  fs::remove_all(dir);
+}
+
+void test_registered_entries_survive_missing_files() {
+  const auto dir = make_dir("petting_zoo_index_registered");
+  ModelIndexEntry entry;
+  entry.id = "kept";
+  entry.path = (dir / "gone.gguf").string();
+  entry.registered = true;
+  auto scan = rescan({entry}, {dir.string()});
+  assert(scan.entries.size() == 1 && scan.entries[0].id == "kept");
+  assert(scan.entries[0].missing);
+
+  // Entries outside the allowed directories are never restored.
+  auto outside = rescan({entry}, {"/nonexistent/models"});
+  assert(outside.entries.empty() && outside.dropped == 1);
+  fs::remove_all(dir);
+}
+
+void test_save_and_load_round_trip() {
+  const auto dir = make_dir("petting_zoo_index_io");
+  const auto path = (dir / "index.json").string();
+  std::string error;
+
+  auto missing = load_model_index(path, error);
+  assert(missing.has_value() && missing->empty());
+
+  ModelIndexEntry entry;
+  entry.id = "tiny";
+  entry.display_name = "Tiny";
+  entry.path = "/models/tiny.gguf";
+  entry.file_size_bytes = 1234;
+  entry.mtime_ns = 1700000000123456789;
+  entry.registered = true;
+  entry.load_options.prefetch = PrefetchMode::kMadvise;
+  entry.load_options.mlock = true;
+  GgufMetadata meta;
+  meta.version = 3;
+  meta.architecture = "llama";
+  meta.quantization = "Q4_K_M";
+  meta.context_length = 4096;
+  meta.vocab_size = 32000;
+  entry.metadata = meta;
+  assert(save_model_index(path, {entry}, error));
+  assert(!fs::exists(path + ".tmp"));
+
+  const auto loaded = load_model_index(path, error);
+  assert(loaded.has_value() && loaded->size() == 1);
+  const auto &back = loaded->front();
+  assert(back.id == "tiny" && back.display_name == "Tiny" && back.path == entry.path);
+  assert(back.file_size_bytes == 1234 && back.mtime_ns == entry.mtime_ns);
+  assert(back.registered);
+  assert(back.load_options.prefetch == PrefetchMode::kMadvise && back.load_options.mlock);
+  assert(back.metadata.has_value() && back.metadata->architecture == "llama");
+  assert(back.metadata->context_length == std::optional<std::uint64_t>(4096));
+  assert(back.metadata->vocab_size == std::optional<std::uint64_t>(32000));
+  assert(!back.metadata->block_count.has_value());
+
+  write_file(path, "{not json");
+  error.clear();
+  assert(!load_model_index(path, error).has_value());
+  assert(!error.empty());
+  fs::remove_all(dir);
+}
+
+int main() {
+  test_sanitize_and_allocate_ids();
+  test_is_within_model_dirs();
+  test_rescan_is_incremental_and_ids_are_stable();
+  test_split_models_are_one_entry();
+  test_registered_entries_survive_missing_files();
+  test_save_and_load_round_trip();
+  std::cout << "All model index tests passed!" << std::endl;
+  return 0;
+}
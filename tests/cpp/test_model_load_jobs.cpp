@@ -0,0 +1,102 @@
+#include "../../apps/server/src/model_load_jobs.hpp"
+#include <cassert>
+#include <iostream>
+
+void test_progress_follows_phases() {
+  ModelLoadJob job("load-1", "m", 2048, 1000);
+  assert(job.status().state == "loading");
+  assert(job.status().phase == "queued");
+  assert(job.status().progress_percent == 0.0);
+
+  job.set_phase("reading");
+  job.add_bytes_loaded(500);
+  assert(job.status().progress_percent == 45.0);
+
+  job.set_phase("initializing");
+  assert(job.status().progress_percent == 90.0);
+
+  job.set_phase("warming");
+  assert(job.status().progress_percent == 95.0);
+  assert(!job.status().activate);
+  job.request_activation();
+  assert(job.status().activate);
+
+  job.finish("ready");
+  const auto status = job.status();
+  assert(status.state == "ready");
+  assert(status.phase == "done");
+  assert(status.progress_percent == 100.0);
+}
+
+void test_finish_is_final() {
+  ModelLoadJob job("load-1", "m", 2048, 1000);
+  job.finish("failed", "APP-UPSTREAM-001", "boom");
+  job.finish("ready");
+  job.set_phase("initializing");
+  const auto status = job.status();
+  assert(status.state == "failed");
+  assert(status.error_code == "APP-UPSTREAM-001");
+  assert(status.phase == "queued");
+}
+
+void test_registry_prunes_only_finished_jobs() {
+  ModelLoadJobs jobs(1);
+  auto running = jobs.create("a", 2048, 10);
+  auto first = jobs.create("b", 2048, 10);
+  first->finish("ready");
+  auto second = jobs.create("c", 2048, 10);
+  second->finish("ready");
+  jobs.create("d", 2048, 10);
+
+  assert(jobs.find(running->id) == running);
+  assert(!jobs.find(first->id));
+  assert(!jobs.latest_for("b"));
+  assert(jobs.find(second->id) == second);
+  assert(jobs.latest_for("c") == second);
+}
+
+void test_cancel_all_skips_finished() {
+  ModelLoadJobs jobs;
+  auto done = jobs.create("a", 2048, 10);
+  done->finish("ready");
+  auto running = jobs.create("b", 2048, 10);
+  jobs.cancel_all();
+  assert(!done->cancel_requested());
+  assert(running->cancel_requested());
+}
+
+void test_timings_are_reported() {
+  ModelLoadJob job("load-1", "m", 2048, 10);
+  job.record_timing("prefetch", 12);
+  job.record_timing("init", 34);
+  const auto status = job.status();
+  assert(status.timings_ms.size() == 2);
+  assert(status.timings_ms.at("prefetch") == 12);
+  assert(status.timings_ms.at("init") == 34);
+}
+
+void test_changes_are_counted() {
+  auto changes = std::make_shared<ChangeCounter>(0);
+  ModelLoadJobs jobs(32, changes);
+  auto job = jobs.create("a", 2048, 10);
+  assert(changes->load() == 1);
+  job->add_bytes_loaded(5);
+  job->set_phase("initializing");
+  job->finish("ready");
+  assert(changes->load() == 4);
+  // Ignored transitions are not changes.
+  job->finish("failed");
+  job->set_phase("warming");
+  assert(changes->load() == 4);
+}
+
+int main() {
+  test_progress_follows_phases();
+  test_finish_is_final();
+  test_registry_prunes_only_finished_jobs();
+  test_cancel_all_skips_finished();
+  test_timings_are_reported();
+  test_changes_are_counted();
+  std::cout << "All model load job tests passed!" << std::endl;
+  return 0;
+}
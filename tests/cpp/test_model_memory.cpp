@@ -0,0 +1,90 @@
+#include "../../apps/server/src/model_memory.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+std::string write_temp_file(std::size_t bytes) {
+  const auto path = std::filesystem::temp_directory_path() / "petting_zoo_model_memory_test.gguf";
+  std::ofstream out(path, std::ios::binary);
+  const std::string chunk(4096, 'x');
+  for (std::size_t written = 0; written < bytes; written += chunk.size()) {
+    out.write(chunk.data(), static_cast<std::streamsize>(std::min(chunk.size(), bytes - written)));
+  }
+  return path.string();
+}
+
+}  // namespace
+
+void test_prefetch_mode_names_round_trip() {
+  for (const auto mode : {PrefetchMode::kNone, PrefetchMode::kRead, PrefetchMode::kMadvise}) {
+    assert(parse_prefetch_mode(prefetch_mode_name(mode)) == mode);
+  }
+  assert(!parse_prefetch_mode("mmap").has_value());
+}
+
+void test_prefetch_modes_report_every_byte() {
+  const std::size_t size = (8u << 20) + 12345;
+  const auto path = write_temp_file(size);
+
+  for (const auto mode : {PrefetchMode::kRead, PrefetchMode::kMadvise}) {
+    std::uintmax_t seen = 0;
+    std::string error;
+    assert(prefetch_model_file(path, mode, [&](std::uintmax_t bytes) {
+      seen = bytes;
+      return true;
+    }, error));
+    assert(seen == size);
+  }
+
+  std::uintmax_t calls = 0;
+  std::string error;
+  assert(prefetch_model_file(path, PrefetchMode::kNone, [&](std::uintmax_t) {
+    ++calls;
+    return true;
+  }, error));
+  assert(calls == 0);
+  std::remove(path.c_str());
+}
+
+void test_prefetch_stops_when_cancelled_or_missing() {
+  const auto path = write_temp_file(4096);
+  std::string error;
+  assert(!prefetch_model_file(path, PrefetchMode::kRead, [](std::uintmax_t) { return false; },
+                              error));
+  assert(error == "Model load cancelled");
+
+  std::remove(path.c_str());
+  error.clear();
+  assert(!prefetch_model_file(path, PrefetchMode::kMadvise, [](std::uintmax_t) { return true; },
+                              error));
+  assert(!error.empty());
+}
+
+void test_pin_maps_whole_file() {
+  const auto path = write_temp_file(64 * 1024);
+  std::string error;
+  // mlock may be refused by RLIMIT_MEMLOCK; either way the result is coherent.
+  auto pinned = PinnedMapping::pin(path, error);
+  if (pinned) {
+    assert(pinned->size() == 64 * 1024);
+  } else {
+    assert(!error.empty());
+  }
+  pinned.reset();
+  std::remove(path.c_str());
+}
+
+int main() {
+  test_prefetch_mode_names_round_trip();
+  test_prefetch_modes_report_every_byte();
+  test_prefetch_stops_when_cancelled_or_missing();
+  test_pin_maps_whole_file();
+  std::cout << "All model memory tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include "../../apps/server/src/model_watcher.hpp"
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class EventLog {
+ public:
+  void push(const ModelFileEvent &event) {
+    std::lock_guard<std::mutex> lock(mu_);
+    events_.push_back(event);
+    cv_.notify_all();
+  }
+
+  // Waits until `count` events have arrived.
+  std::vector<ModelFileEvent> wait_for(std::size_t count) {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait_for(lock, std::chrono::seconds(5), [&] { return events_.size() >= count; });
+    return events_;
+  }
+
+ private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::vector<ModelFileEvent> events_;
+};
+
+}  // namespace
+
+void test_reports_written_moved_and_removed_models() {
+  const auto dir = fs::temp_directory_path() / "petting_zoo_watch";
+  const auto staging = fs::temp_directory_path() / "petting_zoo_watch_staging.gguf";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  EventLog log;
+  std::string error;
+  auto watcher = ModelDirectoryWatcher::start(
+      {dir.string(), (dir / "missing").string()},
+      [&log](const ModelFileEvent &event) { log.push(event); }, error);
+  assert(watcher != nullptr);
+  assert(watcher->watched_count() == 1);
+
+  std::ofstream(dir / "notes.txt") << "ignored";
+  std::ofstream(dir / "copied.gguf") << "weights";
+  std::ofstream(staging) << "weights";
+  fs::rename(staging, dir / "moved.gguf");
+  fs::remove(dir / "copied.gguf");
+
+  const auto events = log.wait_for(3);
+  assert(events.size() == 3);
+  assert(events[0].kind == ModelFileEventKind::kWritten);
+  assert(events[0].path == (dir / "copied.gguf").string());
+  assert(events[1].kind == ModelFileEventKind::kWritten);
+  assert(events[1].path == (dir / "moved.gguf").string());
+  assert(events[2].kind == ModelFileEventKind::kRemoved);
+  assert(events[2].path == (dir / "copied.gguf").string());
+
+  watcher->stop();
+  watcher->stop();
+  fs::remove_all(dir);
+}
+
+int main() {
+  test_reports_written_moved_and_removed_models();
+  std::cout << "All model watcher tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include "../../apps/server/src/prefix_cache.hpp"
+#include <cassert>
+#include <iostream>
+
+void test_conversation_keys() {
+  assert(conversation_key("sys", "sess_a") == conversation_key("sys", "sess_a"));
+  assert(conversation_key("sys", "sess_a") != conversation_key("sys", "sess_b"));
+  assert(conversation_key("sys", "sess_a") != conversation_key("other", "sess_a"));
+  assert(conversation_key("ab", "c") != conversation_key("a", "bc"));
+}
+
+void test_hits_reuse_the_live_context() {
+  PrefixCache cache(4096);
+  const auto a = conversation_key("sys", "sess_a");
+  const auto b = conversation_key("sys", "sess_b");
+
+  auto usage = cache.lookup(a);  // Cold agent
+  assert(!usage.hit && usage.reused_tokens == 0);
+  cache.extend(a, 300);
+
+  usage = cache.lookup(a);
+  assert(usage.hit && usage.reused_tokens == 300);
+  cache.extend(a, 100);
+
+  usage = cache.lookup(b);  // Switching drops the cached conversation
+  assert(!usage.hit);
+  assert(!cache.key().has_value() && cache.tokens() == 0);
+  cache.extend(b, 50);
+
+  usage = cache.lookup(b);
+  assert(usage.hit && usage.reused_tokens == 50);
+  assert(usage.totals.lookups == 4 && usage.totals.hits == 2);
+  assert(usage.totals.prefill_tokens_saved == 350);
+  assert(usage.totals.hit_rate() == 0.5);
+}
+
+void test_invalidate_and_context_cap() {
+  PrefixCache cache(1000);
+  const auto key = conversation_key("", "");
+  cache.extend(key, 800);
+  cache.extend(key, 800);
+  assert(cache.tokens() == 1000);  // Capped at the context window
+
+  cache.invalidate();
+  assert(!cache.lookup(key).hit);
+  assert(PrefixCacheStats{}.hit_rate() == 0.0);
+}
+
+int main() {
+  test_conversation_keys();
+  test_hits_reuse_the_live_context();
+  test_invalidate_and_context_cap();
+  std::cout << "All prefix cache tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include "../../apps/server/src/session_store.hpp"
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+void test_create_list_and_erase() {
+  SessionStore store("");
+  const auto first = store.create("First", std::nullopt, "");
+  const auto second = store.create("Second", std::string("llama"), "Be brief.");
+  assert(first.id != second.id);
+  assert(first.id.rfind("sess_", 0) == 0);
+
+  // Most recently active first; a new turn moves a session to the front.
+  auto listed = store.list(10);
+  assert(listed.size() == 2 && listed[0].id == second.id);
+  assert(store.append_turn(first.id, "hi", "hello"));
+  listed = store.list(10);
+  assert(listed[0].id == first.id);
+  assert(listed[0].messages.size() == 2);
+  assert(listed[0].messages[1].role == "assistant");
+  assert(store.list(1).size() == 1);
+
+  assert(store.erase(first.id));
+  assert(!store.erase(first.id));
+  assert(!store.append_turn(first.id, "late", "reply"));
+  assert(store.size() == 1);
+  assert(store.get(second.id)->model_id == "llama");
+}
+
+void test_flush_and_load_round_trip() {
+  const auto dir = (fs::temp_directory_path() / "petting_zoo_sessions_test").string();
+  fs::remove_all(dir);
+  std::string error;
+  std::string newer_id;
+  {
+    SessionStore store(dir);
+    assert(store.load(error));  // Missing directory is fine
+    const auto older = store.create("Older", std::nullopt, "");
+    const auto newer = store.create("Newer", std::string("qwen"), "System");
+    newer_id = newer.id;
+    assert(store.append_turn(newer.id, "question", "answer"));
+    assert(store.pending() == 2);
+    assert(store.flush(error));
+    assert(store.pending() == 0);
+    assert(fs::exists(fs::path(dir) / (newer.id + ".jsonl")));
+
+    // Later turns are appended to the session's own log only.
+    const auto older_size = fs::file_size(fs::path(dir) / (older.id + ".jsonl"));
+    assert(store.append_turn(newer.id, "again", "reply"));
+    assert(store.pending() == 1);
+    assert(store.flush(error));
+    assert(fs::file_size(fs::path(dir) / (older.id + ".jsonl")) == older_size);
+  }
+
+  SessionStore reloaded(dir);
+  assert(reloaded.load(error));
+  const auto listed = reloaded.list(10);
+  assert(listed.size() == 2);
+  assert(listed[0].title == "Newer");
+  assert(listed[0].system_prompt == "System");
+  assert(listed[0].messages.size() == 4);
+  assert(listed[0].messages[0].content == "question");
+  assert(listed[0].messages[3].content == "reply");
+  assert(listed[1].title == "Older" && !listed[1].model_id.has_value());
+
+  // Deleting removes the log at the next flush.
+  assert(reloaded.erase(newer_id));
+  assert(reloaded.flush(error));
+  assert(!fs::exists(fs::path(dir) / (newer_id + ".jsonl")));
+  fs::remove_all(dir);
+}
+
+void test_torn_log_tail_is_dropped() {
+  const auto dir = (fs::temp_directory_path() / "petting_zoo_sessions_torn").string();
+  fs::remove_all(dir);
+  std::string error;
+  std::string id;
+  {
+    SessionStore store(dir);
+    id = store.create("Chat", std::nullopt, "").id;
+    assert(store.append_turn(id, "q", "a"));
+    assert(store.flush(error));
+  }
+  {
+    // A crash in the middle of an append.
+    std::ofstream out(fs::path(dir) / (id + ".jsonl"), std::ios::app);
+    out << "{\"role\":\"user\",\"con";
+  }
+  SessionStore reloaded(dir);
+  assert(reloaded.load(error));
+  const auto session = reloaded.get(id);
+  assert(session.has_value() && session->messages.size() == 2);
+  fs::remove_all(dir);
+}
+
+void test_writer_flushes_in_the_background() {
+  const auto dir = (fs::temp_directory_path() / "petting_zoo_sessions_writer").string();
+  fs::remove_all(dir);
+  SessionStore store(dir);
+  store.start_writer(std::chrono::milliseconds(10));
+  const auto id = store.create("Chat", std::nullopt, "").id;
+  assert(store.append_turn(id, "q", "a"));
+  for (int i = 0; i < 500 && store.pending() > 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(store.pending() == 0);
+  assert(fs::exists(fs::path(dir) / (id + ".jsonl")));
+
+  // Stopping writes what is still pending.
+  assert(store.append_turn(id, "q2", "a2"));
+  store.stop_writer();
+  assert(store.pending() == 0);
+  std::string error;
+  SessionStore reloaded(dir);
+  assert(reloaded.load(error) && reloaded.get(id)->messages.size() == 4);
+  fs::remove_all(dir);
+}
+
+void test_replay_prompt_keeps_latest_turns() {
+  ChatSession session;
+  session.system_prompt = "You are terse.";
+  for (int i = 0; i < 4; ++i) {
+    session.messages.push_back({"user", "q" + std::to_string(i)});
+    session.messages.push_back({"assistant", "a" + std::to_string(i)});
+  }
+
+  const auto full = session_replay_prompt(session, "next", 10000);
+  assert(full.rfind("You are terse.\n\n", 0) == 0);
+  assert(full.find("User: q0\nAssistant: a0\n") != std::string::npos);
+  assert(full.size() >= 4 && full.substr(full.size() - 4) == "next");
+
+  // Only the newest turn fits; older ones are dropped whole.
+  const auto trimmed = session_replay_prompt(session, "next", 50);
+  assert(trimmed.find("q3") != std::string::npos);
+  assert(trimmed.find("q2") == std::string::npos);
+
+  ChatSession fresh;
+  assert(session_replay_prompt(fresh, "hello", 100) == "hello");
+}
+
+int main() {
+  test_create_list_and_erase();
+  test_flush_and_load_round_trip();
+  test_torn_log_tail_is_dropped();
+  test_writer_flushes_in_the_background();
+  test_replay_prompt_keeps_latest_turns();
+  std::cout << "All session store tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include "../../apps/server/src/spsc_byte_ring.hpp"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+
+void test_rejects_writes_that_do_not_fit() {
+  SpscByteRing ring(8);
+  assert(ring.try_write("abcde"));
+  assert(!ring.try_write("fghi"));
+  assert(ring.size() == 5);
+  assert(ring.try_write("fgh"));
+  assert(ring.size() == ring.capacity());
+
+  std::string out;
+  assert(ring.read_into(out) == 8);
+  assert(out == "abcdefgh");
+  assert(ring.read_into(out) == 0);
+}
+
+void test_wraps_around_the_end() {
+  SpscByteRing ring(8);
+  std::string out;
+  assert(ring.try_write("123456"));
+  assert(ring.read_into(out) == 6);
+  // Starts at offset 6 and continues at the front of the buffer.
+  assert(ring.try_write("abcdefg"));
+  out.clear();
+  assert(ring.read_into(out) == 7);
+  assert(out == "abcdefg");
+}
+
+void test_concurrent_reader_sees_writes_in_order() {
+  constexpr int kMessages = 200000;
+  SpscByteRing ring(64);
+  std::thread writer([&ring] {
+    for (int i = 0; i < kMessages; ++i) {
+      const std::string message = std::to_string(i) + ",";
+      while (!ring.try_write(message)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::string received;
+  std::string expected;
+  for (int i = 0; i < kMessages; ++i) {
+    expected += std::to_string(i) + ",";
+  }
+  while (received.size() < expected.size()) {
+    if (ring.read_into(received) == 0) {
+      std::this_thread::yield();
+    }
+  }
+  writer.join();
+  assert(received == expected);
+}
+
+int main() {
+  test_rejects_writes_that_do_not_fit();
+  test_wraps_around_the_end();
+  test_concurrent_reader_sees_writes_in_order();
+  std::cout << "All SPSC byte ring tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "../../apps/server/src/sse_writer.hpp"
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+namespace {
+
+std::size_t g_allocations = 0;
+
+std::string encoded(std::string_view text) {
+  std::string out;
+  append_json_string(out, text);
+  return out;
+}
+
+}  // namespace
+
+void *operator new(std::size_t size) {
+  ++g_allocations;
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+void test_escapes_json_strings() {
+  assert(encoded("plain") == "\"plain\"");
+  assert(encoded("a\"b\\c") == "\"a\\\"b\\\\c\"");
+  assert(encoded("line\nnext\ttab\r") == "\"line\\nnext\\ttab\\r\"");
+  assert(encoded(std::string_view("\x01\x1f", 2)) == "\"\\u0001\\u001f\"");
+  // Valid UTF-8 passes through; stray or truncated bytes are replaced.
+  assert(encoded("caf\xC3\xA9 \xE2\x82\xAC") == "\"caf\xC3\xA9 \xE2\x82\xAC\"");
+  assert(encoded("bad\xFFx") == "\"bad\\ufffdx\"");
+  assert(encoded("cut\xE2\x82") == "\"cut\\ufffd\\ufffd\"");
+  assert(encoded("\xED\xA0\x80") == "\"\\ufffd\\ufffd\\ufffd\"");  // Surrogate
+}
+
+void test_encodes_events() {
+  SseEventWriter writer;
+  assert(writer.token("Hi \"there\"") ==
+         "{\"type\":\"token\",\"content\":\"Hi \\\"there\\\"\"}");
+  assert(writer.queued(3) == "{\"type\":\"queued\",\"position\":3}");
+  assert(writer.error("APP-UPSTREAM-001", "boom") ==
+         "{\"type\":\"error\",\"code\":\"APP-UPSTREAM-001\",\"message\":\"boom\"}");
+
+  Json::Value done(Json::objectValue);
+  done["text"] = "ok";
+  done["usage"]["total_tokens"] = 12;
+  done["metrics"]["tokens_per_second"] = 2.5;
+  done["metrics"]["prefix_cache_hit"] = false;
+  done["tags"].append(Json::Value());
+  const auto &event = writer.object("done", done);
+  assert(event.rfind("{\"type\":\"done\",", 0) == 0 && event.back() == '}');
+
+  Json::Value parsed;
+  Json::Reader reader;
+  assert(reader.parse(event, parsed));
+  assert(parsed["type"] == "done" && parsed["text"] == "ok");
+  assert(parsed["usage"]["total_tokens"].asInt() == 12);
+  assert(parsed["metrics"]["tokens_per_second"].asDouble() == 2.5);
+  assert(parsed["metrics"]["prefix_cache_hit"] == false);
+  assert(parsed["tags"][0].isNull());
+}
+
+void test_frames_sse_events() {
+  std::string out;
+  append_sse_event(out, 42, "{\"type\":\"queued\",\"position\":1}");
+  assert(out == "id: 42\ndata: {\"type\":\"queued\",\"position\":1}\n\n");
+}
+
+void test_token_events_do_not_allocate() {
+  SseEventWriter writer(256);
+  std::string frame;
+  frame.reserve(256);
+  writer.token("warm-up");
+  const auto before = g_allocations;
+  for (int i = 0; i < 1000; ++i) {
+    frame.clear();
+    append_sse_event(frame, static_cast<std::uint64_t>(i),
+                     writer.token(i % 2 == 0 ? " the" : " caf\xC3\xA9\n"));
+  }
+  assert(g_allocations == before);
+}
+
+int main() {
+  test_escapes_json_strings();
+  test_encodes_events();
+  test_frames_sse_events();
+  test_token_events_do_not_allocate();
+  std::cout << "All SSE writer tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,212 @@
+#include "../../apps/server/src/stream_hub.hpp"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+class FakeSubscriber : public StreamSubscriber {
+ public:
+  void replay(const std::vector<StreamEvent> &events) override {
+    for (const auto &event : events) {
+      replayed.emplace_back(event.seq, std::string(event.json));
+    }
+  }
+  bool deliver(const StreamEvent &event) override {
+    if (is_gone) {
+      return false;
+    }
+    live.emplace_back(event.seq, std::string(event.json));
+    return true;
+  }
+  void close() override { closed = true; }
+  bool gone() const override { return is_gone; }
+
+  std::vector<std::pair<std::uint64_t, std::string>> replayed;
+  std::vector<std::pair<std::uint64_t, std::string>> live;
+  bool closed = false;
+  bool is_gone = false;
+};
+
+using Events = std::vector<std::pair<std::uint64_t, std::string>>;
+
+}  // namespace
+
+void test_reconnect_replays_missed_events_then_continues_live() {
+  StreamHub hub("s", 1024, 30s);
+  std::string error_code;
+  std::string error_message;
+  auto first = std::make_shared<FakeSubscriber>();
+  assert(hub.attach(first, 0, error_code, error_message));
+  hub.publish("a");
+  first->is_gone = true;  // Connection dropped
+  hub.publish("b");
+  hub.publish("c");
+  assert(first->live == (Events{{1, "a"}}));
+  assert(first->closed);
+
+  auto second = std::make_shared<FakeSubscriber>();
+  assert(hub.attach(second, 1, error_code, error_message));
+  assert(second->replayed == (Events{{2, "b"}, {3, "c"}}));
+  hub.publish("d");
+  assert(second->live == (Events{{4, "d"}}));
+  assert(hub.last_seq() == 4);
+
+  hub.finish();
+  assert(second->closed);
+  hub.publish("ignored");
+  assert(hub.last_seq() == 4);
+
+  // A finished stream can still be replayed; the subscriber closes right away.
+  auto late = std::make_shared<FakeSubscriber>();
+  assert(hub.attach(late, 3, error_code, error_message));
+  assert(late->replayed == (Events{{4, "d"}}) && late->closed);
+}
+
+void test_log_drops_oldest_events() {
+  StreamHub hub("s", 10, 30s);
+  for (int i = 1; i <= 1000; ++i) {
+    hub.publish("e" + std::to_string(i % 10) + "_");  // 3 bytes each
+  }
+  assert(hub.last_seq() == 1000);
+  assert(!hub.can_resume(0));
+  assert(!hub.can_resume(996));
+  assert(hub.can_resume(997));
+
+  std::string error_code;
+  std::string error_message;
+  assert(!hub.attach(std::make_shared<FakeSubscriber>(), 10, error_code, error_message));
+  assert(error_code == "APP-STREAM-410");
+
+  auto subscriber = std::make_shared<FakeSubscriber>();
+  assert(hub.attach(subscriber, 997, error_code, error_message));
+  assert(subscriber->replayed == (Events{{998, "e8_"}, {999, "e9_"}, {1000, "e0_"}}));
+
+  // An event larger than the whole log is still kept.
+  hub.publish(std::string(64, 'x'));
+  assert(hub.can_resume(1000) && !hub.can_resume(999));
+}
+
+void test_plain_disconnect_stops_at_the_next_decode_step() {
+  StreamHub hub("s", 1024, 30s);
+  std::string error_code;
+  std::string error_message;
+  auto subscriber = std::make_shared<FakeSubscriber>();
+  assert(hub.attach(subscriber, 0, error_code, error_message));
+
+  // The generation polls stop_requested once per decode step; no time passes
+  // between the disconnect and that check, so the slot is released right away
+  // despite the 30s resume window.
+  const auto now = StreamHub::Clock::now();
+  hub.publish("a");
+  assert(!hub.stop_requested(now));
+  subscriber->is_gone = true;
+  assert(hub.stop_requested(now));
+  assert(subscriber->closed);
+
+  hub.finish();
+  assert(!hub.stop_requested(now));
+}
+
+void test_resumable_stops_once_unwatched_for_the_window() {
+  StreamHub hub("s", 1024, 10s, StreamLifetime::kResumable);
+  const auto start = StreamHub::Clock::now();
+
+  std::string error_code;
+  std::string error_message;
+  auto subscriber = std::make_shared<FakeSubscriber>();
+  assert(hub.attach(subscriber, 0, error_code, error_message));
+  subscriber->is_gone = true;
+  assert(!hub.stop_requested(start));
+  assert(subscriber->closed);
+
+  // A reconnect within the window keeps it going.
+  auto again = std::make_shared<FakeSubscriber>();
+  assert(hub.attach(again, 0, error_code, error_message));
+  assert(!hub.stop_requested(start + 1h));
+  again->is_gone = true;
+  assert(!hub.stop_requested(start + 1h));
+  assert(hub.stop_requested(start + 1h + 10s));
+
+  hub.finish();
+  assert(!hub.stop_requested(start + 2h));
+  assert(!hub.expired(StreamHub::Clock::now()));
+  assert(hub.expired(StreamHub::Clock::now() + 10s));
+}
+
+void test_fans_out_to_every_subscriber() {
+  StreamHub hub("s", 1024, 0s);
+  std::string error_code;
+  std::string error_message;
+  auto tab = std::make_shared<FakeSubscriber>();
+  auto dashboard = std::make_shared<FakeSubscriber>();
+  assert(hub.attach(tab, 0, error_code, error_message));
+  hub.publish("a");
+  // Joining late replays from the start, then shares the live stream.
+  assert(hub.attach(dashboard, 0, error_code, error_message));
+  assert(hub.subscriber_count() == 2);
+  hub.publish("b");
+  assert(tab->live == (Events{{1, "a"}, {2, "b"}}));
+  assert(dashboard->replayed == (Events{{1, "a"}}));
+  assert(dashboard->live == (Events{{2, "b"}}));
+
+  // One subscriber leaving does not affect the others.
+  tab->is_gone = true;
+  hub.publish("c");
+  assert(hub.subscriber_count() == 1);
+  assert(dashboard->live == (Events{{2, "b"}, {3, "c"}}));
+  assert(!hub.stop_requested(StreamHub::Clock::now() + 1s));
+
+  hub.finish();
+  assert(dashboard->closed && hub.subscriber_count() == 0);
+}
+
+void test_detached_streams_run_until_cancelled() {
+  StreamHub hub("s", 1024, 0s, StreamLifetime::kDetached);
+  const auto later = StreamHub::Clock::now() + 1h;
+  assert(hub.detached());
+  assert(!hub.stop_requested(later));  // Nobody watching is fine
+  assert(hub.cancel());
+  assert(hub.stop_requested(later));
+  hub.finish();
+  assert(!hub.cancel());
+}
+
+void test_registry_forgets_expired_streams() {
+  StreamHubRegistry short_lived(1024, 0s);
+  auto hub = short_lived.create();
+  assert(hub->id().rfind("stream_", 0) == 0);
+  assert(short_lived.find(hub->id()) == hub);
+  hub->finish();
+  assert(short_lived.find(hub->id()) == nullptr);
+  assert(short_lived.size() == 0);
+
+  StreamHubRegistry registry(1024, 30s);
+  auto kept = registry.create();
+  kept->finish();
+  assert(registry.find(kept->id()) == kept);
+  assert(registry.create()->id() != kept->id());
+  assert(registry.size() == 2);
+
+  bool created = false;
+  auto submitted = registry.find_or_create("client-key", StreamLifetime::kDetached, created);
+  assert(created && submitted->detached() && submitted->id() == "client-key");
+  assert(registry.find_or_create("client-key", StreamLifetime::kDetached, created) ==
+             submitted &&
+         !created);
+}
+
+int main() {
+  test_reconnect_replays_missed_events_then_continues_live();
+  test_log_drops_oldest_events();
+  test_plain_disconnect_stops_at_the_next_decode_step();
+  test_resumable_stops_once_unwatched_for_the_window();
+  test_fans_out_to_every_subscriber();
+  test_detached_streams_run_until_cancelled();
+  test_registry_forgets_expired_streams();
+  std::cout << "All stream hub tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "../../apps/server/src/token_coalescer.hpp"
+#include <cassert>
+#include <iostream>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+std::string take(TokenCoalescer &coalescer, bool final = false) {
+  std::string out(coalescer.ready(final));
+  coalescer.consume(out.size());
+  return out;
+}
+
+}  // namespace
+
+void test_zero_delay_sends_every_token() {
+  TokenCoalescer coalescer(StreamFlushPolicy{0ms, 256});
+  const auto now = TokenCoalescer::Clock::now();
+  assert(coalescer.append("Hello", now));
+  assert(take(coalescer) == "Hello");
+  assert(coalescer.empty());
+}
+
+void test_flushes_after_delay() {
+  TokenCoalescer coalescer(StreamFlushPolicy{25ms, 256});
+  const auto start = TokenCoalescer::Clock::now();
+  assert(!coalescer.append("Hel", start));
+  assert(!coalescer.append("lo", start + 10ms));
+  assert(!coalescer.due(start + 24ms));
+  // The delay counts from the oldest buffered token, not the latest.
+  assert(coalescer.due(start + 25ms));
+  assert(take(coalescer) == "Hello");
+  assert(!coalescer.due(start + 100ms));
+
+  assert(!coalescer.append(" world", start + 100ms));
+  assert(coalescer.append("!", start + 130ms));
+  assert(take(coalescer) == " world!");
+}
+
+void test_flushes_at_size_limit() {
+  TokenCoalescer coalescer(StreamFlushPolicy{1000ms, 8});
+  const auto now = TokenCoalescer::Clock::now();
+  assert(!coalescer.append("abcd", now));
+  assert(coalescer.append("efgh", now));
+  assert(take(coalescer) == "abcdefgh");
+  assert(take(coalescer).empty());
+}
+
+void test_holds_back_split_utf8() {
+  TokenCoalescer coalescer(StreamFlushPolicy{0ms, 256});
+  const auto now = TokenCoalescer::Clock::now();
+  // "€" is E2 82 AC; the tokenizer emitted it across two tokens.
+  assert(coalescer.append("price: \xE2\x82", now));
+  assert(take(coalescer) == "price: ");
+  assert(!coalescer.empty());
+  assert(coalescer.append("\xAC" "5", now));
+  assert(take(coalescer) == "\xE2\x82\xAC" "5");
+
+  coalescer.append("\xF0\x9F", now);
+  assert(take(coalescer).empty());
+  assert(take(coalescer, /*final=*/true) == "\xF0\x9F");
+  assert(coalescer.empty());
+}
+
+void test_flush_fits_the_stream_buffer() {
+  // Roomy buffers leave the policy alone.
+  assert(fit_flush_to_buffer(StreamFlushPolicy{25ms, 256}, 256 * 1024).max_bytes == 256);
+  // A 1 KiB buffer cannot take a 64 KiB flush, even before escaping.
+  const auto fitted = fit_flush_to_buffer(StreamFlushPolicy{25ms, 65536}, 1024);
+  assert(fitted.max_bytes >= 1 && fitted.max_bytes * 6 + 512 <= 1024);
+  assert(fitted.max_delay == 25ms);
+  // Still sends something when the buffer is tiny.
+  assert(fit_flush_to_buffer(StreamFlushPolicy{25ms, 256}, 16).max_bytes == 1);
+}
+
+int main() {
+  test_zero_delay_sends_every_token();
+  test_flush_fits_the_stream_buffer();
+  test_flushes_after_delay();
+  test_flushes_at_size_limit();
+  test_holds_back_split_utf8();
+  std::cout << "All token coalescer tests passed!" << std::endl;
+  return 0;
+}
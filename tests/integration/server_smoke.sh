@@ -29,7 +29,7 @@ trap cleanup EXIT
 SERVER_PID=$!
 
 for _ in {1..40}; do
-  if "${CURL_BIN}" -sS "${BASE_URL}/healthz" >/dev/null 2>&1; then
+  if "${CURL_BIN}" -fsS "${BASE_URL}/healthz" >/dev/null 2>&1; then
     break
   fi
   sleep 0.25